@@ -9,6 +9,8 @@ public:
   KeyT keybuf[bufsize];    // circular buffer
   ValueT valbuf[bufsize];  // circular buffer
   int m_i{ 0 };
+  std::size_t hits{ 0 };    // lookups that found their key
+  std::size_t misses{ 0 };  // lookups that did not
   Cache() { memset(keybuf, 666, sizeof(keybuf)); }
   void put(const KeyT& key, const ValueT& value)
   {
@@ -21,6 +23,7 @@ public:
   ValueT* get(const KeyT& key)
   {
     KeyT* it = std::find(&keybuf[0], &keybuf[0] + bufsize, key);
+    ++((it == &keybuf[0] + bufsize) ? misses : hits);
     return (it == &keybuf[0] + bufsize) ? nullptr : &valbuf[it - &keybuf[0]];
   }
 };
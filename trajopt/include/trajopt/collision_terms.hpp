@@ -527,6 +527,7 @@ public:
   double value(const DblVec&) override;
   void Plot(const tesseract_visualization::Visualization::Ptr& plotter, const DblVec& x) override;
   sco::VarVector getVars() override { return m_calc->GetVars(); }
+  sco::CacheStats getCacheStats() override { return { m_calc->m_cache.hits, m_calc->m_cache.misses }; }
 
 private:
   CollisionEvaluator::Ptr m_calc;
@@ -562,6 +563,7 @@ public:
   DblVec value(const DblVec&) override;
   void Plot(const DblVec& x);
   sco::VarVector getVars() override { return m_calc->GetVars(); }
+  sco::CacheStats getCacheStats() override { return { m_calc->m_cache.hits, m_calc->m_cache.misses }; }
 
 private:
   CollisionEvaluator::Ptr m_calc;
@@ -8,6 +8,7 @@ TRAJOPT_IGNORE_WARNINGS_POP
 #include <trajopt/common.hpp>
 #include <trajopt/json_marshal.hpp>
 #include <trajopt_sco/optimizers.hpp>
+#include <trajopt_sco/quasi_newton.hpp>
 
 namespace sco
 {
@@ -103,7 +104,7 @@ struct BasicInfo
   std::string manip;
   std::string robot;             // optional
   IntVec dofs_fixed;             // optional
-  sco::ModelType convex_solver;  // which convex solver to use
+  sco::ModelType convex_solver;  // which convex solver to use, AUTO_SOLVER chooses by the size of the first QP
 
   /** @brief If true, the last column in the optimization matrix will be 1/dt */
   bool use_time = false;
@@ -111,6 +112,12 @@ struct BasicInfo
   double dt_upper_lim = 1.0;
   /** @brief The lower limit of 1/dt values allowed in the optimization*/
   double dt_lower_lim = 1.0;
+  /**
+   * @brief If true, the fixed start, fixed dofs and other fixed variables are removed from every convex subproblem,
+   * which is then equilibrated before it is solved. Without presolve the subproblems are not equilibrated, and
+   * backends like OSQP only apply their own scaling.
+   */
+  bool presolve = false;
 };
 
 /**
@@ -290,6 +297,8 @@ struct DynamicCartPoseTermInfo : public TermInfo
   Eigen::Isometry3d tcp;
   /** @brief A Static tranform to be applied to target_ location */
   Eigen::Isometry3d target_tcp;
+  /** @brief Curvature estimate added to the cost, see sco::CostFromErrFunc::setQuasiNewton(). Unused by constraints. */
+  sco::QuasiNewtonType quasi_newton;
 
   DynamicCartPoseTermInfo();
 
@@ -323,6 +332,8 @@ struct CartPoseTermInfo : public TermInfo
   /** @brief The frame relative to which the target position is defined. If empty, frame is assumed to the root,
    * "world", frame */
   std::string target;
+  /** @brief Curvature estimate added to the cost, see sco::CostFromErrFunc::setQuasiNewton(). Unused by constraints. */
+  sco::QuasiNewtonType quasi_newton;
 
   CartPoseTermInfo();
 
@@ -5,6 +5,7 @@ Simple quadratic costs on trajectory
 */
 
 #include <trajopt/common.hpp>
+#include <trajopt_sco/compact_expr.hpp>
 #include <trajopt_sco/modeling.hpp>
 #include <trajopt_utils/macros.h>
 
@@ -32,6 +33,10 @@ private:
   Eigen::VectorXd coeffs_;
   /** @brief Stores the cost as an expression */
   sco::QuadExpr expr_;
+  /** @brief The errors that are squared and weighted by value(), in index form for fast evaluation */
+  std::vector<sco::CompactAffExpr> errs_;
+  /** @brief The coefficient of each entry of errs_ */
+  DblVec err_coeffs_;
   /** @brief Vector of velocity targets */
   Eigen::VectorXd targets_;
   /** @brief First time step to which the term is applied */
@@ -169,6 +174,10 @@ private:
   Eigen::VectorXd coeffs_;
   /** @brief Stores the cost as an expression */
   sco::QuadExpr expr_;
+  /** @brief The errors that are squared and weighted by value(), in index form for fast evaluation */
+  std::vector<sco::CompactAffExpr> errs_;
+  /** @brief The coefficient of each entry of errs_ */
+  DblVec err_coeffs_;
   /** @brief Vector of velocity targets */
   Eigen::VectorXd targets_;
   /** @brief First time step to which the term is applied */
@@ -302,6 +311,10 @@ private:
   Eigen::VectorXd coeffs_;
   /** @brief Stores the cost as an expression */
   sco::QuadExpr expr_;
+  /** @brief The errors that are squared and weighted by value(), in index form for fast evaluation */
+  std::vector<sco::CompactAffExpr> errs_;
+  /** @brief The coefficient of each entry of errs_ */
+  DblVec err_coeffs_;
   /** @brief Vector of velocity targets */
   Eigen::VectorXd targets_;
   /** @brief First time step to which the term is applied */
@@ -81,6 +81,20 @@ void checkParameterSize(trajopt::DblVec& parameter,
   }
 }
 
+/** Reads the optional quasi-Newton update of a cost term: "NONE", "DAMPED_BFGS" or "SR1" */
+sco::QuasiNewtonType quasiNewtonFromJson(const Json::Value& params)
+{
+  std::string type;
+  json_marshal::childFromJson(params, type, "quasi_newton", std::string("NONE"));
+  if (type == "NONE")
+    return sco::NO_QUASI_NEWTON;
+  if (type == "DAMPED_BFGS")
+    return sco::DAMPED_BFGS;
+  if (type == "SR1")
+    return sco::SR1;
+  PRINT_AND_THROW(boost::format("invalid quasi_newton type: %s") % type);
+}
+
 #if 0
 BoolVec toMask(const VectorXd& x) {
   BoolVec out(x.size());
@@ -119,6 +133,7 @@ void ProblemConstructionInfo::readBasicInfo(const Json::Value& v)
   json_marshal::childFromJson(v, basic_info.dt_lower_lim, "dt_lower_lim", 1.0);
   json_marshal::childFromJson(v, basic_info.dt_upper_lim, "dt_upper_lim", 1.0);
   json_marshal::childFromJson(v, basic_info.use_time, "use_time", false);
+  json_marshal::childFromJson(v, basic_info.presolve, "presolve", false);
 
   if (basic_info.dt_lower_lim <= 0 || basic_info.dt_upper_lim < basic_info.dt_lower_lim)
   {
@@ -151,6 +166,20 @@ void ProblemConstructionInfo::readOptInfo(const Json::Value& v)
                               "inflate_constraints_individually",
                               opt_info.inflate_constraints_individually);
   json_marshal::childFromJson(v, opt_info.trust_box_size, "trust_box_size", opt_info.trust_box_size);
+  json_marshal::childFromJson(v, opt_info.num_threads, "num_threads", opt_info.num_threads);
+  json_marshal::childFromJson(v, opt_info.num_eval_threads, "num_eval_threads", opt_info.num_eval_threads);
+  json_marshal::childFromJson(
+      v, opt_info.num_trust_box_candidates, "num_trust_box_candidates", opt_info.num_trust_box_candidates);
+  json_marshal::childFromJson(v, opt_info.use_filter, "use_filter", opt_info.use_filter);
+  json_marshal::childFromJson(v, opt_info.filter_max_violation, "filter_max_violation", opt_info.filter_max_violation);
+  json_marshal::childFromJson(
+      v, opt_info.filter_violation_ratio, "filter_violation_ratio", opt_info.filter_violation_ratio);
+  json_marshal::childFromJson(v, opt_info.inexact_qp, "inexact_qp", opt_info.inexact_qp);
+  json_marshal::childFromJson(v, opt_info.max_qp_tolerance, "max_qp_tolerance", opt_info.max_qp_tolerance);
+  json_marshal::childFromJson(v, opt_info.min_qp_tolerance, "min_qp_tolerance", opt_info.min_qp_tolerance);
+  json_marshal::childFromJson(v, opt_info.qp_tolerance_ratio, "qp_tolerance_ratio", opt_info.qp_tolerance_ratio);
+  json_marshal::childFromJson(v, opt_info.profile, "profile", opt_info.profile);
+  json_marshal::childFromJson(v, opt_info.qp_capture_file, "qp_capture_file", opt_info.qp_capture_file);
 }
 
 void ProblemConstructionInfo::readCosts(const Json::Value& v)
@@ -526,7 +555,9 @@ TrajOptProb::Ptr ConstructProblem(const Json::Value& root, const tesseract::Tess
 }
 
 TrajOptProb::TrajOptProb(int n_steps, const ProblemConstructionInfo& pci)
-  : OptProb(pci.basic_info.convex_solver), m_kin(pci.kin), m_env(pci.env)
+  : OptProb(pci.basic_info.convex_solver, pci.basic_info.presolve)
+  , m_kin(pci.kin)
+  , m_env(pci.env)
 {
   const Eigen::MatrixX2d& limits = m_kin->getLimits();
   auto n_dof = static_cast<int>(m_kin->numJoints());
@@ -647,6 +678,7 @@ DynamicCartPoseTermInfo::DynamicCartPoseTermInfo() : TermInfo(TT_COST | TT_CNT)
   rot_coeffs = Eigen::Vector3d::Ones();
   tcp.setIdentity();
   target_tcp.setIdentity();
+  quasi_newton = sco::NO_QUASI_NEWTON;
 }
 
 void DynamicCartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json::Value& v)
@@ -667,6 +699,7 @@ void DynamicCartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json:
   json_marshal::childFromJson(params, tcp_wxyz, "tcp_wxyz", Eigen::Vector4d(1, 0, 0, 0));
   json_marshal::childFromJson(params, target_tcp_xyz, "target_tcp_xyz", Eigen::Vector3d(0, 0, 0));
   json_marshal::childFromJson(params, target_tcp_wxyz, "target_tcp_wxyz", Eigen::Vector4d(1, 0, 0, 0));
+  quasi_newton = quasiNewtonFromJson(params);
 
   Eigen::Quaterniond q(tcp_wxyz(0), tcp_wxyz(1), tcp_wxyz(2), tcp_wxyz(3));
   tcp.linear() = q.matrix();
@@ -682,8 +715,8 @@ void DynamicCartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json:
     PRINT_AND_THROW(boost::format("invalid link name: %s") % link);
   }
 
-  const char* all_fields[] = { "timestep", "target",   "pos_coeffs",     "rot_coeffs",     "link",
-                               "tcp_xyz",  "tcp_wxyz", "target_tcp_xyz", "target_tcp_wxyz" };
+  const char* all_fields[] = { "timestep", "target",   "pos_coeffs",     "rot_coeffs",      "link",
+                               "tcp_xyz",  "tcp_wxyz", "target_tcp_xyz", "target_tcp_wxyz", "quasi_newton" };
   ensure_only_members(params, all_fields, sizeof(all_fields) / sizeof(char*));
 }
 
@@ -746,8 +779,10 @@ void DynamicCartPoseTermInfo::hatch(TrajOptProb& prob)
     // Apply error calculator as either cost or constraint
     if (term_type & TT_COST)
     {
-      prob.addCost(
-          sco::Cost::Ptr(new TrajOptCostFromErrFunc(f, prob.GetVarRow(timestep, 0, n_dof), coeff, sco::ABS, name)));
+      auto cost =
+          std::make_shared<TrajOptCostFromErrFunc>(f, prob.GetVarRow(timestep, 0, n_dof), coeff, sco::ABS, name);
+      cost->setQuasiNewton(quasi_newton);
+      prob.addCost(cost);
     }
     else if (term_type & TT_CNT)
     {
@@ -767,6 +802,7 @@ CartPoseTermInfo::CartPoseTermInfo() : TermInfo(TT_COST | TT_CNT)
   pos_coeffs = Eigen::Vector3d::Ones();
   rot_coeffs = Eigen::Vector3d::Ones();
   tcp.setIdentity();
+  quasi_newton = sco::NO_QUASI_NEWTON;
 }
 
 void CartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json::Value& v)
@@ -785,6 +821,7 @@ void CartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json::Value&
   json_marshal::childFromJson(params, tcp_xyz, "tcp_xyz", Eigen::Vector3d(0, 0, 0));
   json_marshal::childFromJson(params, tcp_wxyz, "tcp_wxyz", Eigen::Vector4d(1, 0, 0, 0));
   json_marshal::childFromJson(params, target, "target", std::string(""));
+  quasi_newton = quasiNewtonFromJson(params);
 
   Eigen::Quaterniond q(tcp_wxyz(0), tcp_wxyz(1), tcp_wxyz(2), tcp_wxyz(3));
   tcp.linear() = q.matrix();
@@ -810,7 +847,7 @@ void CartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json::Value&
   }
 
   const char* all_fields[] = { "timestep", "xyz",     "wxyz",     "pos_coeffs", "rot_coeffs",
-                               "link",     "tcp_xyz", "tcp_wxyz", "target" };
+                               "link",     "tcp_xyz", "tcp_wxyz", "target",     "quasi_newton" };
   ensure_only_members(params, all_fields, sizeof(all_fields) / sizeof(char*));
 }
 
@@ -892,8 +929,9 @@ void CartPoseTermInfo::hatch(TrajOptProb& prob)
     // This is currently not being used. There is an intermittent bug that needs to be tracked down it is not used.
     sco::MatrixOfVector::Ptr dfdx(
         new CartPoseJacCalculator(input_pose, prob.GetKin(), adjacency_map, world_to_base, link, tcp, indices));
-    prob.addCost(
-        sco::Cost::Ptr(new TrajOptCostFromErrFunc(f, prob.GetVarRow(timestep, 0, n_dof), coeff, sco::ABS, name)));
+    auto cost = std::make_shared<TrajOptCostFromErrFunc>(f, prob.GetVarRow(timestep, 0, n_dof), coeff, sco::ABS, name);
+    cost->setQuasiNewton(quasi_newton);
+    prob.addCost(cost);
   }
   else if ((term_type & TT_CNT) && ~(term_type | ~TT_USE_TIME))
   {
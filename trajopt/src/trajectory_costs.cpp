@@ -44,18 +44,21 @@ JointPosEqCost::JointPosEqCost(VarArray vars,
       sco::exprDec(pos, targets_[j]);
       // expr_ = coeff * vel^2
       sco::exprInc(expr_, sco::exprMult(sco::exprSquare(pos), coeffs_[j]));
+      errs_.emplace_back(pos);
+      err_coeffs_.push_back(coeffs_[j]);
     }
   }
 }
 double JointPosEqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = (getTraj(xvec, vars_));
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff =
-      (traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())).rowwise() - targets_.transpose();
-  // Element-wise square it, multiply it by a diagonal matrix of coefficients, and sums output
-  return (diff.array().square().matrix() * coeffs_.asDiagonal()).sum();
+  // Same as expr_.value(xvec), but without expanding the squares or dereferencing the variables
+  double out = 0;
+  for (std::size_t i = 0; i < errs_.size(); ++i)
+  {
+    const double err = errs_[i].value(xvec);
+    out += err_coeffs_[i] * err * err;
+  }
+  return out;
 }
 sco::ConvexObjective::Ptr JointPosEqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -272,18 +275,21 @@ JointVelEqCost::JointVelEqCost(VarArray vars,
       exprDec(vel, targets_[j]);
       // expr_ = coeff * vel^2
       exprInc(expr_, exprMult(exprSquare(vel), coeffs_[j]));
+      errs_.emplace_back(vel);
+      err_coeffs_.push_back(coeffs_[j]);
     }
   }
 }
 double JointVelEqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = (getTraj(xvec, vars_));
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff = (diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols()))).rowwise() -
-                         targets_.transpose();
-  // Element-wise square it, multiply it by a diagonal matrix of coefficients, and sums output
-  return (diff.array().square().matrix() * coeffs_.asDiagonal()).sum();
+  // Same as expr_.value(xvec), but without expanding the squares or dereferencing the variables
+  double out = 0;
+  for (std::size_t i = 0; i < errs_.size(); ++i)
+  {
+    const double err = errs_[i].value(xvec);
+    out += err_coeffs_[i] * err * err;
+  }
+  return out;
 }
 sco::ConvexObjective::Ptr JointVelEqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -507,19 +513,21 @@ JointAccEqCost::JointAccEqCost(VarArray vars,
       sco::exprDec(acc, targets_[j]);
       // expr_ = coeff * acc^2
       sco::exprInc(expr_, sco::exprMult(sco::exprSquare(acc), coeffs_[j]));
+      errs_.emplace_back(acc);
+      err_coeffs_.push_back(coeffs_[j]);
     }
   }
 }
 double JointAccEqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = (getTraj(xvec, vars_));
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff =
-      (diffAxis0(diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())))).rowwise() -
-      targets_.transpose();
-  // Element-wise square it, multiply it by a diagonal matrix of coefficients, and sums output
-  return (diff.array().square().matrix() * coeffs_.asDiagonal()).sum();
+  // Same as expr_.value(xvec), but without expanding the squares or dereferencing the variables
+  double out = 0;
+  for (std::size_t i = 0; i < errs_.size(); ++i)
+  {
+    const double err = errs_[i].value(xvec);
+    out += err_coeffs_[i] * err * err;
+  }
+  return out;
 }
 sco::ConvexObjective::Ptr JointAccEqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -122,6 +122,51 @@ TEST_F(PlanningTest, numerical_ik1)  // NOLINT
   CONSOLE_BRIDGE_logDebug("planning time: %.3f", GetClock() - tStart);
 }
 
+TEST_F(PlanningTest, numerical_ik1_quasi_newton)  // NOLINT
+{
+  CONSOLE_BRIDGE_logDebug("PlanningTest, numerical_ik1_quasi_newton");
+
+  // The pose cost with a quasi-Newton curvature estimate must reach the same pose as the linearized one
+  sco::OptResults results[2];
+  Eigen::Isometry3d final_poses[2];
+  const char* types[] = { "NONE", "DAMPED_BFGS" };
+  for (int k = 0; k < 2; ++k)
+  {
+    Json::Value root = readJsonFile(std::string(TRAJOPT_DIR) + "/test/data/config/numerical_ik1.json");
+    root["costs"][0]["params"]["quasi_newton"] = types[k];
+
+    ProblemConstructionInfo pci(tesseract_);
+    pci.fromJson(root);
+    pci.basic_info.convex_solver = sco::ModelType::BPMPD;
+    auto pose_info = std::dynamic_pointer_cast<CartPoseTermInfo>(pci.cost_infos[0]);
+    ASSERT_TRUE(pose_info != nullptr);
+    EXPECT_EQ(pose_info->quasi_newton, (k == 0) ? sco::NO_QUASI_NEWTON : sco::DAMPED_BFGS);
+    TrajOptProb::Ptr prob = ConstructProblem(pci);
+    ASSERT_TRUE(!!prob);
+
+    sco::BasicTrustRegionSQP opt(prob);
+    opt.initialize(DblVec(static_cast<size_t>(prob->GetNumDOF()), 0));
+    opt.optimize();
+    results[k] = opt.results();
+
+    Eigen::Isometry3d change_base = prob->GetEnv()->getLinkTransform(prob->GetKin()->getBaseLinkName());
+    prob->GetKin()->calcFwdKin(final_poses[k], toVectorXd(opt.x()));
+    final_poses[k] = change_base * final_poses[k];
+  }
+  CONSOLE_BRIDGE_logDebug("QP solves without and with quasi-Newton: %d %d",
+                          results[0].n_qp_solves,
+                          results[1].n_qp_solves);
+
+  EXPECT_EQ(results[0].status, results[1].status);
+  for (auto i = 0; i < 4; ++i)
+  {
+    for (auto j = 0; j < 4; ++j)
+    {
+      EXPECT_NEAR(final_poses[0](i, j), final_poses[1](i, j), 1e-5);
+    }
+  }
+}
+
 TEST_F(PlanningTest, arm_around_table)  // NOLINT
 {
   CONSOLE_BRIDGE_logDebug("PlanningTest, arm_around_table");
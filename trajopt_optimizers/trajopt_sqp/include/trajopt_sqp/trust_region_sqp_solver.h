@@ -31,6 +31,7 @@
 #ifndef TRAJOPT_SQP_INCLUDE_SIMPLE_SQP_SOLVER_H_
 #define TRAJOPT_SQP_INCLUDE_SIMPLE_SQP_SOLVER_H_
 
+#include <chrono>
 #include <ifopt/problem.h>
 #include <ifopt/solver.h>
 #include <trajopt_sqp/qp_problem.h>
@@ -66,6 +67,9 @@ public:
    */
   bool callCallbacks();
 
+  /** @brief Returns true if params.max_time seconds have passed since init() */
+  bool timeLimitReached() const;
+
   /** @brief Prints info about the current state of of the optimization */
   void printStepInfo() const;
 
@@ -93,6 +97,7 @@ protected:
   SQPStatus status_;
   SQPResults results_;
   std::vector<SQPCallback::Ptr> callbacks_;
+  std::chrono::steady_clock::time_point start_time_;
 
 private:
   ifopt::Problem* nlp_;
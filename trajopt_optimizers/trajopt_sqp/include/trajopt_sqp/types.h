@@ -62,7 +62,13 @@ struct SQPParameters
   double max_merit_coeff_increases = 5;
   /** @brief Constraints are scaled by this amount when inflated */
   double merit_coeff_increase_ratio = 10;
-  /** @brief Unused */
+  /**
+   * @brief Wall-clock time budget in seconds. When it runs out the best solution so far is returned.
+   *
+   * The time is checked around every QP solve and between the evaluations of the costs and of the constraints. ifopt
+   * evaluates all cost terms or all constraint sets at once and the QP solve has no time limit, so the budget can be
+   * exceeded by the longest of these steps.
+   */
   double max_time = static_cast<double>(INFINITY);
   /** @brief If true, only the constraints that are violated will be inflated */
   bool inflate_constraints_individually = true;
@@ -156,7 +162,9 @@ enum class SQPStatus
   NLP_CONVERGED,
   ITERATION_LIMIT,
   ERROR,
-  CALLBACK_STOPPED
+  CALLBACK_STOPPED,
+  /** @brief SQPParameters::max_time ran out, see there for how far it can be overrun */
+  TIME_LIMIT
 };
 
 }  // namespace trajopt_sqp
@@ -29,6 +29,7 @@
  * limitations under the License.
  */
 #include <trajopt_sqp/trust_region_sqp_solver.h>
+#include <cmath>
 #include <iostream>
 #include <console_bridge/console.h>
 
@@ -45,11 +46,14 @@ bool TrustRegionSQPSolver::init(ifopt::Problem& nlp)
 {
   console_bridge::setLogLevel(console_bridge::LogLevel::CONSOLE_BRIDGE_LOG_INFO);
   nlp_ = &nlp;
+  start_time_ = std::chrono::steady_clock::now();
+  status_ = SQPStatus::RUNNING;
 
   qp_problem->init(nlp);
 
   // Initialize optimization parameters
   results_ = SQPResults(nlp.GetNumberOfOptimizationVariables(), nlp.GetNumberOfConstraints());
+  results_.best_var_vals = nlp.GetVariableValues();
   results_.box_size = Eigen::VectorXd::Ones(nlp.GetNumberOfOptimizationVariables()) * params.initial_trust_box_size;
   qp_problem->setBoxSize(results_.box_size);
   return true;
@@ -70,7 +74,26 @@ void TrustRegionSQPSolver::Solve(ifopt::Problem& nlp)
     // ---------------------------
     for (int convex_iteration = 0; convex_iteration < 100; convex_iteration++)
     {
-      qp_problem->convexify();
+      if (timeLimitReached())
+      {
+        nlp.SetVariables(results_.best_var_vals.data());
+        status_ = SQPStatus::TIME_LIMIT;
+        return;
+      }
+
+      // The costs and the constraints are linearized by one Jacobian evaluation each, the time is checked in between
+      qp_problem->updateHessian();
+      qp_problem->updateGradient();
+      if (timeLimitReached())
+      {
+        nlp.SetVariables(results_.best_var_vals.data());
+        status_ = SQPStatus::TIME_LIMIT;
+        return;
+      }
+      qp_problem->linearizeConstraints();
+      qp_problem->updateNLPConstraintBounds();
+      qp_problem->updateNLPVariableBounds();
+      qp_problem->updateSlackVariableBounds();
 
       // TODO: Look into not clearing and reinitializing the workspace each iteration. It should be as simple as
       // removing this
@@ -101,7 +124,8 @@ void TrustRegionSQPSolver::Solve(ifopt::Problem& nlp)
         if (!stepOptimization(nlp))
         {
           nlp.SetVariables(results_.best_var_vals.data());
-          status_ = SQPStatus::CALLBACK_STOPPED;
+          if (status_ != SQPStatus::TIME_LIMIT)
+            status_ = SQPStatus::CALLBACK_STOPPED;
           return;
         }
 
@@ -220,7 +244,20 @@ bool TrustRegionSQPSolver::stepOptimization(ifopt::Problem& nlp)
   nlp_ = &nlp;
 
   // Solve the QP
+  if (timeLimitReached())
+  {
+    status_ = SQPStatus::TIME_LIMIT;
+    return false;
+  }
   bool succeed = qp_solver->solve();
+
+  // Do not start the expensive exact evaluation once the time is up
+  if (timeLimitReached())
+  {
+    status_ = SQPStatus::TIME_LIMIT;
+    return false;
+  }
+
   if (succeed)
   {
     results_.new_var_vals = qp_solver->getSolution();
@@ -232,6 +269,11 @@ bool TrustRegionSQPSolver::stepOptimization(ifopt::Problem& nlp)
 
     // Evaluate exact constraint violations (expensive)
     results_.new_constraint_violations = qp_problem->getExactConstraintViolations();
+    if (timeLimitReached())
+    {
+      status_ = SQPStatus::TIME_LIMIT;
+      return false;
+    }
 
     // Calculate exact NLP merits (expensive) - TODO: Look into caching for qp_solver->Convexify()
     results_.new_exact_merit = nlp.EvaluateCostFunction(results_.new_var_vals.data()) +
@@ -274,6 +316,16 @@ bool TrustRegionSQPSolver::callCallbacks()
   return success;
 }
 
+bool TrustRegionSQPSolver::timeLimitReached() const
+{
+  if (!std::isfinite(params.max_time))
+    return false;
+  if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count() < params.max_time)
+    return false;
+  CONSOLE_BRIDGE_logInform("Time limit of %.3f seconds reached", params.max_time);
+  return true;
+}
+
 void TrustRegionSQPSolver::printStepInfo() const
 {
   // Print Header
@@ -0,0 +1,87 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <unordered_map>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/solver_interface.hpp>
+#include <trajopt_sco/solver_selection.hpp>
+
+namespace sco
+{
+/**
+ * @brief A model for AUTO_SOLVER that chooses its backend on the first optimize()
+ *
+ * Until then it only records the problem. The first optimize() chooses the backend by the size of the QP, see
+ * resolveModelType(), and hands the problem over to it once. From then on every call is forwarded to the backend, so
+ * its bounds-only updates and warm starts work as if it had been created directly.
+ *
+ * The variables and constraints added before the choice keep their handles. The backend numbers its variables in the
+ * same order, and backends look up the variables of an expression by index only, so expressions on these handles are
+ * passed on as they are. Use a PresolveModel with AUTO_SOLVER to choose by the size of the reduced QP instead.
+ */
+class AutoSolverModel : public Model
+{
+public:
+  AutoSolverModel();
+  ~AutoSolverModel() override = default;
+  AutoSolverModel(const AutoSolverModel&) = delete;
+  AutoSolverModel& operator=(const AutoSolverModel&) = delete;
+  AutoSolverModel(AutoSolverModel&&) = default;
+  AutoSolverModel& operator=(AutoSolverModel&&) = default;
+
+  Var addVar(const std::string& name) override;
+  Cnt addEqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const QuadExpr&, const std::string& name) override;
+  void removeVars(const VarVector& vars) override;
+  void removeCnts(const CntVector& cnts) override;
+
+  void update() override;
+  void setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper) override;
+  DblVec getVarValues(const VarVector& vars) const override;
+  CvxOptStatus optimize() override;
+  void setTimeLimit(double time_limit) override;
+  void setToleranceHint(double tolerance) override;
+  void setWarmStart(const DblVec& primal, const DblVec& dual) override;
+  DblVec getDualValues() const override;
+  void setObjective(const AffExpr&) override;
+  void setObjective(const QuadExpr&) override;
+  void writeToFile(const std::string& fname) const override;
+  VarVector getVars() const override;
+  Model::Ptr clone() const override;
+  ModelSize getSize() const override;
+  bool exportQP(QPData& qp) const override;
+
+  /** @brief The backend, null until the first optimize() chooses it */
+  const Model* backend() const { return inner_.get(); }
+  /** @brief The type of the backend, AUTO_SOLVER until the first optimize() chooses it */
+  ModelType backendType() const { return inner_type_; }
+
+private:
+  ModelType inner_type_;           /**< type of the backend, AUTO_SOLVER until it is chosen */
+  Model::Ptr inner_;               /**< the backend, null until it is chosen */
+  VarVector vars_;                 /**< variables added before the backend was chosen */
+  CntVector cnts_;                 /**< constraints added before the backend was chosen */
+  DblVec lbs_, ubs_;               /**< recorded variable bounds */
+  AffExprVector cnt_exprs_;        /**< recorded constraint expressions */
+  ConstraintTypeVector cnt_types_; /**< recorded constraint types */
+  QuadExpr objective_;             /**< recorded objective */
+  bool removed_{ false };          /**< whether anything was removed since the last update() */
+  VarVector inner_vars_;           /**< counterpart of each recorded variable in the backend */
+  /** Position of each recorded variable in vars_ and inner_vars_. Their indices follow the backend once it exists. */
+  std::unordered_map<const VarRep*, std::size_t> recorded_pos_;
+  CntVector inner_cnts_;           /**< counterpart of each recorded constraint in the backend */
+  double time_limit_;              /**< passed on to the backend */
+  double tolerance_hint_{ 0 };     /**< passed on to the backend */
+  DblVec warm_primal_, warm_dual_; /**< starting point for the first optimize() */
+
+  /** Chooses the backend and hands the recorded problem over to it */
+  void resolve();
+  /** The counterpart of var in the backend */
+  Var innerVar(const Var& var) const;
+  /** The recorded problem as the backend gets it, without removed constraints */
+  void recordedQP(QPData& qp) const;
+};
+}  // namespace sco
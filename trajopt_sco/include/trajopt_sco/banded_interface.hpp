@@ -0,0 +1,67 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstddef>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/banded_qp.hpp>
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+/**
+ * @brief A QP solved by the interior point method of solveBandedQP()
+ *
+ * The QPs of a trajectory couple each time step only to its neighbours. In the order TrajOptProb creates the
+ * variables, step by step, their KKT system is banded and every iteration costs time linear in the number of steps.
+ * Other problems are solved as well, but as fast as their bandwidth allows.
+ */
+class BandedQPModel : public Model
+{
+public:
+  BandedQPModel() = default;
+  ~BandedQPModel() override = default;
+  BandedQPModel(const BandedQPModel&) = delete;
+  BandedQPModel& operator=(const BandedQPModel&) = delete;
+  BandedQPModel(BandedQPModel&&) = default;
+  BandedQPModel& operator=(BandedQPModel&&) = default;
+
+  Var addVar(const std::string& name) override;
+  Cnt addEqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const QuadExpr&, const std::string& name) override;
+  void removeVars(const VarVector& vars) override;
+  void removeCnts(const CntVector& cnts) override;
+
+  void update() override;
+  void setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper) override;
+  DblVec getVarValues(const VarVector& vars) const override;
+  CvxOptStatus optimize() override;
+  /** @brief Relaxes settings.tolerance to the tolerance for the following solves */
+  void setToleranceHint(double tolerance) override { tolerance_hint_ = tolerance; }
+  void setObjective(const AffExpr&) override;
+  void setObjective(const QuadExpr&) override;
+  void writeToFile(const std::string& fname) const override;
+  VarVector getVars() const override;
+  Model::Ptr clone() const override;
+  ModelSize getSize() const override;
+  bool exportQP(QPData& qp) const override;
+
+  BandedQPSettings settings;
+  /** @brief How the last optimize() went */
+  const BandedQPResult& lastResult() const { return result_; }
+
+private:
+  VarVector vars_;                 /**< model variables */
+  CntVector cnts_;                 /**< model constraints */
+  DblVec lbs_, ubs_;               /**< variable bounds */
+  AffExprVector cnt_exprs_;        /**< constraint expressions */
+  ConstraintTypeVector cnt_types_; /**< constraint types */
+  QuadExpr objective_;             /**< objective expression */
+  BandedQPResult result_;          /**< the solution of the last optimize() and its statistics */
+  double tolerance_hint_{ 0 };     /**< set by setToleranceHint() */
+
+  /** Adds a constraint, reusing the place of a removed one if there is any */
+  Cnt addCnt(const AffExpr& expr, ConstraintType type);
+};
+}  // namespace sco
@@ -0,0 +1,87 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cassert>
+#include <cstddef>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/sco_common.hpp>
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+struct QPData;
+
+/**
+ * @brief LDL' factorization of a symmetric matrix that is zero outside a band around the diagonal
+ *
+ * Factorizing costs O(n * bandwidth^2) and solving O(n * bandwidth), so a trajectory whose time steps only couple to
+ * their neighbours is solved in time linear in its length. There is no pivoting. The matrix must be quasi-definite,
+ * its diagonal blocks of positive and negative nodes regularized, then any order of the nodes can be factorized.
+ */
+class BandedLDLT
+{
+public:
+  /** @brief Set the size and bandwidth and zero the matrix */
+  void reset(std::size_t n, std::size_t bandwidth);
+  /** @brief Add v to entries (i, j) and (j, i), which must lie in the band */
+  void add(std::size_t i, std::size_t j, double v);
+  /**
+   * @brief Factorize in place
+   * @param positive Whether each pivot should be positive. Pivots of the wrong sign or smaller than min_pivot are
+   * replaced by +-min_pivot.
+   * @return The number of pivots that were replaced
+   */
+  std::size_t factorize(const std::vector<bool>& positive, double min_pivot);
+  /** @brief Overwrite x with the solution of the factorized system */
+  void solve(DblVec& x) const;
+
+  std::size_t size() const { return n_; }
+  std::size_t bandwidth() const { return bandwidth_; }
+
+private:
+  std::size_t n_{ 0 };
+  std::size_t bandwidth_{ 0 };
+  /** Row i holds columns i - bandwidth_ ... i of the lower triangle, then of L */
+  DblVec band_;
+  DblVec d_;
+
+  double& at(std::size_t i, std::size_t j) { return band_[i * (bandwidth_ + 1) + bandwidth_ + j - i]; }
+  double at(std::size_t i, std::size_t j) const { return band_[i * (bandwidth_ + 1) + bandwidth_ + j - i]; }
+};
+
+struct BandedQPSettings
+{
+  /** @brief Relative tolerance of the residuals and of the duality gap */
+  double tolerance{ 1e-8 };
+  int max_iterations{ 100 };
+  /** @brief Regularization of the KKT system, removed again by iterative refinement */
+  double regularization{ 1e-9 };
+  int refinement_steps{ 2 };
+};
+
+struct BandedQPResult
+{
+  DblVec x;
+  int iterations{ 0 };
+  /** @brief Size and bandwidth of the KKT system in the order that was chosen */
+  std::size_t kkt_size{ 0 };
+  std::size_t bandwidth{ 0 };
+};
+
+/**
+ * @brief Solve a QP with a primal-dual interior point method on its banded KKT system
+ *
+ * Inequality rows are eliminated into the Hessian block, equality rows stay in the system next to the variables they
+ * constrain. The variables keep the order they were created in when that gives a small bandwidth, which is the case
+ * for the time steps of a trajectory. Otherwise, e.g. when auxiliary variables were appended at the end, the nodes
+ * are reordered by reverse Cuthill-McKee.
+ *
+ * @return CVX_INFEASIBLE only once the multipliers give a certificate of primal infeasibility, CVX_FAILED if the
+ * iterations run out without a solution or a certificate
+ */
+CvxOptStatus solveBandedQP(const QPData& qp,
+                           BandedQPResult& result,
+                           const BandedQPSettings& settings = BandedQPSettings());
+}  // namespace sco
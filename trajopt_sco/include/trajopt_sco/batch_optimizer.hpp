@@ -0,0 +1,78 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <memory>
+#include <string>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/optimizers.hpp>
+#include <trajopt_sco/thread_pool.hpp>
+#include <trajopt_utils/logging.hpp>
+
+namespace sco
+{
+/** @brief Outcome of one problem of a BatchOptimizer run */
+struct BatchOptResults
+{
+  /** @brief The results of the BasicTrustRegionSQP that optimized the problem */
+  OptResults results;
+  /** @brief Seconds from the start of the batch until the problem was picked up by a thread */
+  double wait_time{ 0 };
+  /** @brief Seconds spent optimizing the problem */
+  double solve_time{ 0 };
+  /** @brief Message of the exception the optimization threw, empty if there was none. The status is OPT_FAILED then. */
+  std::string error;
+};
+
+/**
+ * @brief Optimizes many independent problems concurrently
+ *
+ * Every problem is optimized by its own BasicTrustRegionSQP on one thread at a time, at the log level it was added
+ * with. Threads pick up the next problem as soon as they are done with the previous one, so a few long problems do
+ * not hold up the others. The problems must not share costs, constraints or models.
+ */
+class BatchOptimizer
+{
+public:
+  using Ptr = std::shared_ptr<BatchOptimizer>;
+
+  /** @brief Create an optimizer that runs up to num_threads problems at once */
+  explicit BatchOptimizer(int num_threads);
+
+  /**
+   * @brief Add a problem to the batch
+   * @param prob The problem, it must not be part of any other batch entry
+   * @param x The initial values of the problem variables
+   * @param param The parameters of the BasicTrustRegionSQP. If several problems of the batch have the same
+   * qp_capture_file, each of them captures its QPs to that name followed by its index, e.g. qps.bin.3. The same goes
+   * for the iteration log of problems that log to the same log_dir and log_file.
+   * @param log_level The log level of the optimization, independent of later changes of util::gLogLevel
+   * @return The index of the problem in the results of optimize()
+   */
+  std::size_t addProblem(OptProb::Ptr prob,
+                         DblVec x,
+                         const BasicTrustRegionSQPParameters& param = BasicTrustRegionSQPParameters(),
+                         util::LogLevel log_level = util::GetLogLevel());
+
+  /** @brief The number of problems in the batch */
+  std::size_t size() const { return problems_.size(); }
+  /** @brief Remove all problems */
+  void clear() { problems_.clear(); }
+
+  /** @brief Optimize all problems and return their results in the order they were added */
+  std::vector<BatchOptResults> optimize();
+
+private:
+  struct Problem
+  {
+    OptProb::Ptr prob;
+    DblVec x;
+    BasicTrustRegionSQPParameters param;
+    util::LogLevel log_level;
+  };
+
+  std::vector<Problem> problems_;
+  ThreadPool pool_;
+};
+}  // namespace sco
@@ -1,9 +1,20 @@
 #pragma once
-#include <trajopt_sco/solver_interface.hpp>
 #include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/solver_interface.hpp>
 
 namespace sco
 {
+/**
+ * @brief A QP solved by BPMPD
+ *
+ * BPMPD is not reentrant, so it runs in bpmpd_caller worker processes. The problem goes to them through POSIX shared
+ * memory. Each solve checks a worker out of a shared pool, so models can be solved from several threads at once.
+ * Workers that die are replaced.
+ */
 class BPMPDModel : public Model
 {
 public:
@@ -16,14 +27,10 @@ public:
 
   QuadExpr m_objective;
 
-  int m_pipeIn{ 0 };
-  int m_pipeOut{ 0 };
-  int m_pid{ 0 };
-
   BPMPDModel();
   ~BPMPDModel() override = default;
-  BPMPDModel(const BPMPDModel&) = default;
-  BPMPDModel& operator=(const BPMPDModel&) = default;
+  BPMPDModel(const BPMPDModel&) = delete;
+  BPMPDModel& operator=(const BPMPDModel&) = delete;
   BPMPDModel(BPMPDModel&&) = default;
   BPMPDModel& operator=(BPMPDModel&&) = default;
 
@@ -42,5 +49,15 @@ public:
   void setObjective(const QuadExpr&) override;
   void writeToFile(const std::string& fname) const override;
   VarVector getVars() const override;
+  Model::Ptr clone() const override;
+  ModelSize getSize() const override;
+  bool exportQP(QPData& qp) const override;
+
+private:
+  /** Adds a constraint, reusing the place of a removed one if there is any */
+  Cnt addCnt(const AffExpr& expr, ConstraintType type);
 };
+
+/** @brief The process ids of the BPMPD workers that are not solving right now */
+std::vector<int> idleBPMPDWorkers();
 }  // namespace sco
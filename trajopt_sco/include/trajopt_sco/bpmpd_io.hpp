@@ -1,168 +1,108 @@
 #pragma once
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
-#include <string>
-#include <vector>
-#include <cassert>
-#include <iostream>
-#include <cstdlib>
-#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/types.h>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+/**
+ * The protocol between BPMPDModel and its bpmpd_caller worker processes.
+ *
+ * Each worker is started with the name of a POSIX shared memory segment, opens it and sends READY_CHAR on its
+ * standard output, which like its standard input is a socket to the model side. To solve a problem, the model side
+ * writes it to the segment as laid out by Segment and sends the size of the segment as a std::uint64_t. The worker
+ * maps the segment again if its size changed, solves, writes the solution to the segment and sends DONE_CHAR.
+ * A size of EXIT_REQUEST makes the worker exit.
+ */
 namespace bpmpd_io
 {
-enum SerMode
+const char READY_CHAR = 'r';
+const char DONE_CHAR = 'd';
+const std::uint64_t EXIT_REQUEST = 0;
+
+/** @brief Start of the segment, the sizes of the problem followed by the result of the solve */
+struct SegmentHeader
 {
-  DESER,
-  SER
+  int m, n, nz, qn, qnz;
+  int code;
+  double opt;
 };
 
-template <typename T>
-void ser(int fp, T& x, SerMode mode)
+/**
+ * @brief The arrays of one BPMPD call in a shared memory segment
+ *
+ * The segment holds a SegmentHeader, then the double arrays and then the int arrays, each in the order of the members
+ * below. Both processes find them from the sizes in the header.
+ */
+struct Segment
 {
-  switch (mode)
-  {
-    case SER:
-    {
-      T xcopy = x;
-      ssize_t n = write(fp, &xcopy, sizeof(T));
-      assert(n == sizeof(T));
-      UNUSED(n);
-      break;
-    }
-    case DESER:
-    {
-      ssize_t n = read(fp, &x, sizeof(T));
-      assert(n == sizeof(T));
-      UNUSED(n);
-      break;
-    }
-  }
-}
+  SegmentHeader* header;
+  double *acolnzs, *qcolnzs, *rhs, *obj, *lbound, *ubound, *primal, *dual;
+  int *acolcnt, *acolidx, *qcolcnt, *qcolidx, *status;
 
-template <typename T>
-void ser(int fp, std::vector<T>& x, SerMode mode)
-{
-  unsigned long size = x.size();
-  ser(fp, size, mode);
-  switch (mode)
+  /** @brief Point into a segment whose header holds the sizes of the problem */
+  explicit Segment(void* data) : header(static_cast<SegmentHeader*>(data))
   {
-    case SER:
-    {
-      long n = write(fp, x.data(), sizeof(T) * size);
-      assert(static_cast<unsigned long>(n) == sizeof(T) * size);
-      UNUSED(n);
-      break;
-    }
-    case DESER:
-    {
-      x.resize(size);
-      long n = read(fp, x.data(), sizeof(T) * size);
-      assert(static_cast<unsigned>(n) == sizeof(T) * size);
-      UNUSED(n);
-      break;
-    }
+    const auto m = static_cast<std::size_t>(header->m);
+    const auto n = static_cast<std::size_t>(header->n);
+    acolnzs = reinterpret_cast<double*>(header + 1);
+    qcolnzs = acolnzs + header->nz;
+    rhs = qcolnzs + header->qnz;
+    obj = rhs + m;
+    lbound = obj + n;
+    ubound = lbound + n + m;
+    primal = ubound + n + m;
+    dual = primal + n + m;
+    acolcnt = reinterpret_cast<int*>(dual + n + m);
+    acolidx = acolcnt + n;
+    qcolcnt = acolidx + header->nz;
+    qcolidx = qcolcnt + n;
+    status = qcolidx + header->qnz;
   }
-}
 
-struct bpmpd_input
-{
-  int m, n, nz, qn, qnz;
-  std::vector<int> acolcnt, acolidx;
-  std::vector<double> acolnzs;
-  std::vector<int> qcolcnt, qcolidx;
-  std::vector<double> qcolnzs;
-  std::vector<double> rhs, obj, lbound, ubound;
-
-  bpmpd_input() = default;
-  bpmpd_input(int m,
-              int n,
-              int nz,
-              int qn,
-              int qnz,
-              std::vector<int> acolcnt,
-              std::vector<int> acolidx,
-              std::vector<double> acolnzs,
-              std::vector<int> qcolcnt,
-              std::vector<int> qcolidx,
-              std::vector<double> qcolnzs,
-              std::vector<double> rhs,
-              std::vector<double> obj,
-              std::vector<double> lbound,
-              std::vector<double> ubound)
-    : m(m)
-    , n(n)
-    , nz(nz)
-    , qn(qn)
-    , qnz(qnz)
-    , acolcnt(std::move(acolcnt))
-    , acolidx(std::move(acolidx))
-    , acolnzs(std::move(acolnzs))
-    , qcolcnt(std::move(qcolcnt))
-    , qcolidx(std::move(qcolidx))
-    , qcolnzs(std::move(qcolnzs))
-    , rhs(std::move(rhs))
-    , obj(std::move(obj))
-    , lbound(std::move(lbound))
-    , ubound(std::move(ubound))
+  /** @brief The bytes a segment needs for a problem of the given size */
+  static std::size_t size(std::size_t m, std::size_t n, std::size_t nz, std::size_t qnz)
   {
+    return sizeof(SegmentHeader) + sizeof(double) * (nz + qnz + m + n + 4 * (n + m)) +
+           sizeof(int) * (2 * n + nz + qnz + n + m);
   }
 };
 
-const char EXIT_CHAR = 123;
-const char CHECK_CHAR = 111;
-
-inline void ser(int fp, bpmpd_input& bi, SerMode mode)
+/** @brief Send all of size bytes over a socket. False if the other side is gone. */
+inline bool sendAll(int fd, const void* data, std::size_t size)
 {
-  char scorrect = 'z', s = (mode == SER) ? scorrect : 0;
-  ser(fp, s, mode);
-  if (s == EXIT_CHAR)
+  const auto* bytes = static_cast<const char*>(data);
+  while (size > 0)
   {
-    exit(0);
+    // MSG_NOSIGNAL reports a closed socket as an error instead of raising SIGPIPE
+    const ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    bytes += n;
+    size -= static_cast<std::size_t>(n);
   }
-
-  ser(fp, bi.m, mode);
-  ser(fp, bi.n, mode);
-  ser(fp, bi.nz, mode);
-  ser(fp, bi.qn, mode);
-  ser(fp, bi.qnz, mode);
-  ser(fp, bi.acolcnt, mode);
-  ser(fp, bi.acolidx, mode);
-  ser(fp, bi.acolnzs, mode);
-  ser(fp, bi.qcolcnt, mode);
-  ser(fp, bi.qcolidx, mode);
-  ser(fp, bi.qcolnzs, mode);
-  ser(fp, bi.rhs, mode);
-  ser(fp, bi.obj, mode);
-  ser(fp, bi.lbound, mode);
-  ser(fp, bi.ubound, mode);
+  return true;
 }
 
-struct bpmpd_output
-{
-  std::vector<double> primal, dual;
-  std::vector<int> status;
-  int code;
-  double opt;
-  bpmpd_output() = default;
-  bpmpd_output(std::vector<double> primal, std::vector<double> dual, std::vector<int> status, int code, double opt)
-    : primal(std::move(primal)), dual(std::move(dual)), status(std::move(status)), code(code), opt(opt)
-  {
-  }
-};
-
-inline void ser(int fp, bpmpd_output& bo, SerMode mode)
+/** @brief Receive exactly size bytes from a socket. False if the other side is gone. */
+inline bool recvAll(int fd, void* data, std::size_t size)
 {
-  char scorrect = CHECK_CHAR, s = (mode == SER) ? scorrect : 0;
-  ser(fp, s, mode);
-  if (s == EXIT_CHAR)
+  auto* bytes = static_cast<char*>(data);
+  while (size > 0)
   {
-    exit(0);
+    const ssize_t n = recv(fd, bytes, size, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    bytes += n;
+    size -= static_cast<std::size_t>(n);
   }
-  ser(fp, bo.primal, mode);
-  ser(fp, bo.dual, mode);
-  ser(fp, bo.status, mode);
-  ser(fp, bo.code, mode);
-  ser(fp, bo.opt, mode);
+  return true;
 }
 }  // namespace bpmpd_io
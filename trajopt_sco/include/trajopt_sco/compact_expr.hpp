@@ -0,0 +1,76 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstdint>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+using IndexVec = std::vector<std::uint32_t>;
+
+/**
+ * @brief Affine expression that refers to variables by their index in the model.
+ *
+ * The indices and coefficients are stored in contiguous arrays, so evaluating the expression is a gather and dot
+ * product without dereferencing the VarRep of every term. The indices are those of the variables at the time the
+ * expression was built, so it is only valid as long as the model does not renumber them, which is the case for
+ * the problem variables of an OptProb.
+ */
+struct CompactAffExpr
+{
+  double constant{ 0 };
+  IndexVec inds;
+  DblVec coeffs;
+
+  CompactAffExpr() = default;
+  explicit CompactAffExpr(double a) : constant(a) {}
+  /** @brief Convert from an AffExpr, using the current indices of its variables */
+  explicit CompactAffExpr(const AffExpr& expr);
+
+  size_t size() const { return coeffs.size(); }
+  double value(const double* x) const;
+  double value(const DblVec& x) const;
+};
+
+/** @brief Quadratic expression that refers to variables by their index in the model, see CompactAffExpr */
+struct CompactQuadExpr
+{
+  CompactAffExpr affexpr;
+  IndexVec inds1;
+  IndexVec inds2;
+  DblVec coeffs;
+
+  CompactQuadExpr() = default;
+  explicit CompactQuadExpr(double a) : affexpr(a) {}
+  explicit CompactQuadExpr(CompactAffExpr aff) : affexpr(std::move(aff)) {}
+  /** @brief Convert from a QuadExpr, using the current indices of its variables */
+  explicit CompactQuadExpr(const QuadExpr& expr);
+
+  size_t size() const { return coeffs.size(); }
+  double value(const double* x) const;
+  double value(const DblVec& x) const;
+};
+
+/**
+ * @brief Convert back to an AffExpr
+ * @param expr The expression to convert
+ * @param vars The variables of the model, such that vars[i] is the variable with index i
+ */
+AffExpr toAffExpr(const CompactAffExpr& expr, const VarVector& vars);
+/**
+ * @brief Convert back to a QuadExpr
+ * @param expr The expression to convert
+ * @param vars The variables of the model, such that vars[i] is the variable with index i
+ */
+QuadExpr toQuadExpr(const CompactQuadExpr& expr, const VarVector& vars);
+
+/** @brief Add b to a. The terms are appended as in exprInc */
+void exprInc(CompactAffExpr& a, const CompactAffExpr& b);
+/** @brief Add b to a. The terms are appended as in exprInc */
+void exprInc(CompactQuadExpr& a, const CompactQuadExpr& b);
+
+std::ostream& operator<<(std::ostream&, const CompactAffExpr&);
+}  // namespace sco
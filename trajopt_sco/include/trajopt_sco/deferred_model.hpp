@@ -0,0 +1,58 @@
+#pragma once
+#include <trajopt_sco/modeling.hpp>
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+/**
+ * DeferredModel is a stand-in for the real model while costs and constraints are convexified
+ * concurrently. Terms may only create auxiliary variables (and set their bounds) in it.
+ *
+ * The recorded variables are taken from the auxiliary variables of the real model by commit(), which
+ * also rewrites the convexified term to reference them. Committing the terms in a fixed order
+ * therefore produces exactly the same model as convexifying them serially against the real model.
+ */
+class DeferredModel : public Model
+{
+public:
+  DeferredModel() = default;
+  ~DeferredModel() override;
+  DeferredModel(const DeferredModel&) = delete;
+  DeferredModel& operator=(const DeferredModel&) = delete;
+  DeferredModel(DeferredModel&&) = delete;
+  DeferredModel& operator=(DeferredModel&&) = delete;
+
+  Var addVar(const std::string& name) override;
+  Cnt addEqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const QuadExpr&, const std::string& name) override;
+  void removeVars(const VarVector& vars) override;
+  void removeCnts(const CntVector& cnts) override;
+
+  void update() override;
+  void setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper) override;
+  DblVec getVarValues(const VarVector& vars) const override;
+  CvxOptStatus optimize() override;
+  void setObjective(const AffExpr&) override;
+  void setObjective(const QuadExpr&) override;
+  void writeToFile(const std::string& fname) const override;
+  VarVector getVars() const override;
+  Var addAuxVar(const std::string& name, double lb, double ub) override;
+  void releaseAuxVars(const VarVector& vars) override;
+
+  /** @brief Create the recorded variables in model and move cost over to it */
+  void commit(Model* model, ConvexObjective& cost);
+  /** @brief Create the recorded variables in model and move cnt over to it */
+  void commit(Model* model, ConvexConstraints& cnt);
+
+private:
+  void createVars(Model* model);
+  void translate(Var& var) const;
+  void translate(AffExpr& expr) const;
+  void translate(QuadExpr& expr) const;
+
+  VarVector vars_;       /**< recorded variables, owned by this model */
+  DblVec lbs_, ubs_;     /**< recorded variable bounds */
+  VarVector committed_;  /**< counterparts of vars_ in the real model */
+};
+}  // namespace sco
@@ -0,0 +1,46 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstdint>
+#include <unordered_map>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+/**
+ * ExprAccumulator sums expressions into a single QuadExpr, merging the terms that act on the same variables.
+ *
+ * Unlike exprInc, which appends the terms of the summands, every variable (and every unordered pair of variables)
+ * appears at most once in the result, so the QP handed to the solver is no larger than its sparsity pattern.
+ * Terms keep the order in which their variables first appear, and clear() keeps the allocated memory, so
+ * accumulating the same structure again produces the same layout without reallocating.
+ *
+ * Variables are identified by their index in the model, which must not change while accumulating.
+ */
+class ExprAccumulator
+{
+public:
+  /** @brief Remove all terms, keeping the allocated memory */
+  void clear();
+
+  /** @brief Add an affine expression */
+  void add(const AffExpr& expr);
+  /** @brief Add a quadratic expression */
+  void add(const QuadExpr& expr);
+
+  /** @brief The accumulated expression, valid until the next call to add() or clear() */
+  const QuadExpr& expr() const { return expr_; }
+
+private:
+  void addLinear(const Var& var, double coeff);
+  void addQuadratic(const Var& var1, const Var& var2, double coeff);
+
+  QuadExpr expr_;
+  /** Position in expr_.affexpr of the term of each variable index */
+  std::unordered_map<std::size_t, std::size_t> linear_terms_;
+  /** Position in expr_ of the term of each pair of variable indices */
+  std::unordered_map<std::uint64_t, std::size_t> quadratic_terms_;
+};
+}  // namespace sco
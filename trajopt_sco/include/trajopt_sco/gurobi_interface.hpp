@@ -40,6 +40,7 @@ public:
   DblVec getVarValues(const VarVector&) const override;
 
   CvxOptStatus optimize() override;
+  void setTimeLimit(double time_limit) override;
   /** Don't use this function, because it adds constraints that aren't tracked
    */
   CvxOptStatus optimizeFeasRelax();
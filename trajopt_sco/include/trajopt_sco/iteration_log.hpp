@@ -0,0 +1,112 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/optimizers.hpp>
+
+namespace sco
+{
+/**
+ * @brief Writes the iteration results of a BasicTrustRegionSQP to a binary file on a background thread
+ *
+ * The file starts with a header holding the variable, cost and constraint names, followed by one fixed size record
+ * of native doubles per logged iteration. push() only copies the record into a preallocated lock-free ring buffer,
+ * so the optimizer thread never waits for the disk. If the writer thread falls behind far enough for the ring to be
+ * full, records are dropped and counted instead. An idle writer thread sleeps on a condition variable, push() only
+ * takes its mutex to wake it.
+ *
+ * Use IterationLogReader or the trajopt_iteration_log_to_csv tool to read the file.
+ */
+class IterationLogWriter
+{
+public:
+  /**
+   * @brief Create the log file and start the writer thread. Throws if the file can not be created.
+   * @param capacity The number of records that can be queued before push() starts dropping them
+   */
+  IterationLogWriter(const std::string& path,
+                     const std::vector<std::string>& var_names,
+                     const std::vector<std::string>& cost_names,
+                     const std::vector<std::string>& cnt_names,
+                     std::size_t capacity = 1024);
+  /** @brief Writes all queued records and closes the file */
+  ~IterationLogWriter();
+  IterationLogWriter(const IterationLogWriter&) = delete;
+  IterationLogWriter& operator=(const IterationLogWriter&) = delete;
+  IterationLogWriter(IterationLogWriter&&) = delete;
+  IterationLogWriter& operator=(IterationLogWriter&&) = delete;
+
+  /**
+   * @brief Queue a record of results. Must always be called from the same thread.
+   * @return False if the queue was full and the record was dropped
+   */
+  bool push(const BasicTrustRegionSQPResults& results);
+
+  /** @brief The number of records push() dropped so far */
+  std::size_t dropped() const { return dropped_; }
+
+private:
+  void run();
+
+  std::FILE* file_;
+  std::size_t record_size_;        // in doubles
+  std::size_t capacity_;           // in records
+  std::vector<double> ring_;       // capacity_ records
+  std::atomic<std::size_t> head_;  // next record to write, only advanced by the writer thread
+  std::atomic<std::size_t> tail_;  // next free record, only advanced by push()
+  std::atomic<bool> closing_;
+  std::atomic<bool> waiting_;      // set while the writer thread is about to sleep or sleeping
+  std::mutex mutex_;               // only taken to sleep and to wake the writer thread
+  std::condition_variable wakeup_;
+  std::size_t dropped_;
+  std::thread thread_;
+};
+
+/** @brief Reads the files written by IterationLogWriter */
+class IterationLogReader
+{
+public:
+  /** @brief Open a log and read its header. Throws if it is not an iteration log. */
+  explicit IterationLogReader(const std::string& path);
+  ~IterationLogReader();
+  IterationLogReader(const IterationLogReader&) = delete;
+  IterationLogReader& operator=(const IterationLogReader&) = delete;
+  IterationLogReader(IterationLogReader&&) = delete;
+  IterationLogReader& operator=(IterationLogReader&&) = delete;
+
+  const std::vector<std::string>& varNames() const { return var_names_; }
+  const std::vector<std::string>& costNames() const { return cost_names_; }
+  const std::vector<std::string>& cntNames() const { return cnt_names_; }
+
+  /**
+   * @brief Read the next record into results, which must have been created with the names of this log
+   * @return False at the end of the file. A record that was cut short, e.g. by a crash, counts as the end.
+   */
+  bool next(BasicTrustRegionSQPResults& results);
+
+private:
+  std::FILE* file_;
+  std::vector<std::string> var_names_;
+  std::vector<std::string> cost_names_;
+  std::vector<std::string> cnt_names_;
+  std::vector<double> record_;
+};
+
+/**
+ * @brief Convert an iteration log to the CSV files BasicTrustRegionSQPResults::writeSolver, writeVars, writeCosts and
+ * writeConstraints produce
+ *
+ * The files are called trajopt_solver.log, trajopt_vars.log, trajopt_costs.log and trajopt_constraints.log.
+ * @return The number of records converted
+ */
+std::size_t iterationLogToCsv(const std::string& log_path, const std::string& csv_dir);
+}  // namespace sco
@@ -14,6 +14,7 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 TRAJOPT_IGNORE_WARNINGS_POP
 
 #include <trajopt_sco/solver_interface.hpp>
+#include <trajopt_sco/solver_selection.hpp>
 
 namespace sco
 {
@@ -21,8 +22,8 @@ namespace sco
 Stores convex terms in a objective
 For non-quadratic terms like hinge(x) and abs(x), it needs to add auxilliary
 variables and linear constraints to the model
-Note: When this object is deleted, the constraints and variables it added to the
-model are removed
+Note: When this object is deleted, the constraints it added to the model are
+removed and its auxilliary variables are released to the model for reuse
  */
 class ConvexObjective
 {
@@ -79,9 +80,10 @@ public:
   void addEqCnt(const AffExpr&);
   /** Expression that should <= 0 */
   void addIneqCnt(const AffExpr&);
+  /** Set the model the constraints are added to. Only valid before addConstraintsToModel() */
   void setModel(Model* model)
   {
-    assert(!inModel());
+    assert(cnts_.empty());
     model_ = model;
   }
   bool inModel() { return model_ != nullptr; }
@@ -105,6 +107,13 @@ private:
   ConvexConstraints& operator=(ConvexConstraints&&) = default;
 };
 
+/** Lookup counts of a cache a cost or constraint keeps, e.g. of collision checks */
+struct CacheStats
+{
+  std::size_t hits{ 0 };
+  std::size_t misses{ 0 };
+};
+
 /**
 Non-convex cost function, which knows how to calculate its convex approximation
 (convexify() method)
@@ -120,6 +129,8 @@ public:
   virtual ConvexObjective::Ptr convex(const DblVec& x, Model* model) = 0;
   /** Get problem variables associated with this cost */
   virtual VarVector getVars() = 0;
+  /** Lookup counts of the cache of the cost since it was created, zero if it has none */
+  virtual CacheStats getCacheStats() { return CacheStats(); }
   std::string name() { return name_; }
   void setName(const std::string& name) { name_ = name; }
 
@@ -157,6 +168,8 @@ public:
   double violation(const DblVec& x);
   /** Get problem variables associated with this constraint */
   virtual VarVector getVars() = 0;
+  /** Lookup counts of the cache of the constraint since it was created, zero if it has none */
+  virtual CacheStats getCacheStats() { return CacheStats(); }
   std::string name() { return name_; }
   void setName(const std::string& name) { name_ = name; }
 
@@ -201,6 +214,19 @@ public:
   using Ptr = std::shared_ptr<OptProb>;
 
   OptProb(ModelType convex_solver = ModelType::AUTO_SOLVER);
+  /**
+   * @brief With AUTO_SOLVER, choose the backend by the expected features of the convex subproblems
+   * @param presolve Remove fixed variables from every convex subproblem and equilibrate it before it is solved, see
+   * PresolveModel
+   */
+  OptProb(ModelType convex_solver, const QPFeatures& features, bool presolve = false);
+  /**
+   * @brief With AUTO_SOLVER, choose the backend on the first optimize() by the size of the convex subproblem, for
+   * problems whose constraints are not known up front. The model is an AutoSolverModel then, or a PresolveModel with
+   * presolve.
+   * @param presolve Remove fixed variables from every convex subproblem and equilibrate it before it is solved
+   */
+  OptProb(ModelType convex_solver, bool presolve);
   virtual ~OptProb() = default;
   OptProb(const OptProb&) = default;
   OptProb& operator=(const OptProb&) = default;
@@ -1,6 +1,7 @@
 #pragma once
 #include <trajopt_sco/modeling.hpp>
 #include <trajopt_sco/num_diff.hpp>
+#include <trajopt_sco/quasi_newton.hpp>
 #include <trajopt_sco/sco_common.hpp>
 /**
 @file modeling_utils.hpp
@@ -42,11 +43,21 @@ public:
   ConvexObjective::Ptr convex(const DblVec& x, Model* model) override;
   VarVector getVars() override { return vars_; }
 
+  /**
+   * @brief Estimate the Hessian from the gradients at the points the cost is convexified at, instead of computing it
+   * numerically. Until there is an estimate the cost is convexified as without.
+   */
+  void setQuasiNewton(QuasiNewtonType type) { quasi_newton_ = QuasiNewtonHessian(type); }
+
 protected:
   ScalarOfVector::Ptr f_;
   VarVector vars_;
   bool full_hessian_;
   double epsilon_;
+  QuasiNewtonHessian quasi_newton_;
+  /** The point the cost was last convexified at and the gradient there */
+  Eigen::VectorXd prev_x_;
+  Eigen::VectorXd prev_grad_;
 };
 
 class CostFromErrFunc : public Cost
@@ -69,6 +80,13 @@ public:
   ConvexObjective::Ptr convex(const DblVec& x, Model* model) override;
   VarVector getVars() override { return vars_; }
 
+  /**
+   * @brief Add the curvature of the error function, which the linearization drops, to the convexification. It is
+   * estimated from the Jacobians at the points the cost is convexified at, weighted with the derivative of the penalty
+   * at the current point.
+   */
+  void setQuasiNewton(QuasiNewtonType type) { quasi_newton_ = QuasiNewtonHessian(type); }
+
 protected:
   VectorOfVector::Ptr f_;
   MatrixOfVector::Ptr dfdx_;
@@ -76,6 +94,10 @@ protected:
   Eigen::VectorXd coeffs_;
   PenaltyType pen_type_;
   double epsilon_;
+  QuasiNewtonHessian quasi_newton_;
+  /** The point the cost was last convexified at and the Jacobian there */
+  Eigen::VectorXd prev_x_;
+  Eigen::MatrixXd prev_jac_;
 };
 
 class ConstraintFromErrFunc : public Constraint
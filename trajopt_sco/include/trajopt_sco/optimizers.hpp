@@ -1,11 +1,15 @@
 #pragma once
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <chrono>
 #include <functional>
+#include <map>
+#include <stdexcept>
 #include <string>
 TRAJOPT_IGNORE_WARNINGS_POP
 
 #include <trajopt_sco/modeling.hpp>
+#include <trajopt_sco/thread_pool.hpp>
 /*
  * Algorithms for non-convex, constrained optimization
  */
@@ -18,14 +22,99 @@ enum OptStatus
   OPT_SCO_ITERATION_LIMIT,  // hit iteration limit before convergence
   OPT_PENALTY_ITERATION_LIMIT,
   OPT_FAILED,
-  INVALID
+  INVALID,
+  OPT_TIME_LIMIT  // hit max_time, returning the best iterate found so far
 };
 static const char* OptStatus_strings[] = { "CONVERGED",
                                            "SCO_ITERATION_LIMIT",
                                            "PENALTY_ITERATION_LIMIT",
                                            "FAILED",
-                                           "INVALID" };
+                                           "INVALID",
+                                           "TIME_LIMIT" };
 inline std::string statusToString(OptStatus status) { return OptStatus_strings[status]; }
+/** @brief Thrown by Deadline::check() once the time budget of an optimization is used up */
+class TimeLimitExceeded : public std::runtime_error
+{
+public:
+  TimeLimitExceeded() : std::runtime_error("optimization time limit exceeded") {}
+};
+
+/**
+ * @brief Wall-clock deadline of an optimization, measured from construction
+ *
+ * A time budget that is not finite never expires.
+ */
+class Deadline
+{
+public:
+  /** @brief Create a deadline max_time seconds from now */
+  explicit Deadline(double max_time);
+
+  /** @brief True if the deadline has passed */
+  bool expired() const;
+  /** @brief Seconds left until the deadline (zero once expired, infinity if there is no deadline) */
+  double remaining() const;
+  /** @brief Throw TimeLimitExceeded if the deadline has passed */
+  void check() const;
+
+private:
+  bool unlimited_;
+  std::chrono::steady_clock::time_point end_;
+};
+
+/**
+ * @brief Where an optimization spent its time, filled in if BasicTrustRegionSQPParameters::profile is set
+ *
+ * Times are wall-clock seconds. Work done concurrently for several trust region candidates is added up.
+ */
+struct OptProfile
+{
+  /** @brief Time spent in the phases of the SQP */
+  struct PhaseTimes
+  {
+    /** @brief Convexifying the costs and constraints */
+    double convexify{ 0 };
+    /** @brief Adding the convexification to the model, setting the objective and the trust region */
+    double model_build{ 0 };
+    /** @brief Solving the QPs */
+    double qp_solve{ 0 };
+    /** @brief Evaluating the exact costs and constraints, and their convexification, at the QP solutions */
+    double evaluate{ 0 };
+    /** @brief Running the callbacks */
+    double callbacks{ 0 };
+
+    PhaseTimes& operator+=(const PhaseTimes& other);
+    double sum() const { return convexify + model_build + qp_solve + evaluate + callbacks; }
+  };
+
+  /** @brief Time spent in and cache lookups of the costs or constraints with the same name */
+  struct TermProfile
+  {
+    double convexify_time{ 0 };
+    /** @brief Evaluation time, without the evaluations for trust region candidates */
+    double evaluate_time{ 0 };
+    CacheStats cache;
+  };
+
+  /** @brief Time of the whole optimization */
+  PhaseTimes total;
+  /** @brief Time of each SQP iteration. The final callbacks are only in total. */
+  std::vector<PhaseTimes> iterations;
+  std::map<std::string, TermProfile> terms;
+  /** @brief The largest dimensions of the QPs that were solved, each maximized separately */
+  ModelSize peak_qp_size;
+
+  /** @brief The fraction of the cache lookups of all terms that were hits, 0 if there were none */
+  double cacheHitRate() const;
+  void clear()
+  {
+    total = PhaseTimes();
+    iterations.clear();
+    terms.clear();
+    peak_qp_size = ModelSize();
+  }
+};
+
 struct OptResults
 {
   DblVec x;  // solution estimate
@@ -34,6 +123,7 @@ struct OptResults
   DblVec cost_vals;
   DblVec cnt_viols;
   int n_func_evals, n_qp_solves;
+  OptProfile profile;
   void clear()
   {
     x.clear();
@@ -42,6 +132,7 @@ struct OptResults
     cnt_viols.clear();
     n_func_evals = 0;
     n_qp_solves = 0;
+    profile.clear();
   }
   OptResults() { clear(); }
 };
@@ -99,7 +190,9 @@ struct BasicTrustRegionSQPParameters
   double max_merit_coeff_increases;
 
   double merit_coeff_increase_ratio;  // ratio that we increate coeff each time
-  double max_time;                    // not yet implemented
+  /** @brief Wall-clock time budget in seconds. Once it is exceeded the best iterate found so far is returned
+   * with status OPT_TIME_LIMIT. Infinite by default. */
+  double max_time;
   /** @brief Initial coefficient that is used to scale the constraints. The total constaint cost is constaint_value *
    * coeff * merit_coeff */
   double initial_merit_error_coeff;
@@ -108,8 +201,60 @@ struct BasicTrustRegionSQPParameters
   bool inflate_constraints_individually;
   double trust_box_size;  // current size of trust region (component-wise)
 
-  bool log_results;     // Log results to file
-  std::string log_dir;  // Directory to store log results (Default: /tmp)
+  /** @brief Number of threads used to convexify the costs and constraints. If less than 2 they are convexified
+   * serially. The terms must be safe to convexify concurrently with each other. */
+  int num_threads;
+  /** @brief Number of threads used to evaluate the exact costs and constraints. If less than 2 they are evaluated
+   * serially. The results are identical to the serial evaluation, but the terms must be safe to evaluate
+   * concurrently with each other. */
+  int num_eval_threads;
+  /**
+   * @brief Number of trust region sizes tried at once. If greater than 1, the QP is solved concurrently for the
+   * current size and the next ones it would shrink to, on copies of the model. The steps are then evaluated exactly
+   * from the largest box down, one at a time, so the costs and constraints do not have to be re-entrant. The first
+   * accepted step is taken, as without candidates, so only rejected steps cost extra evaluations. Ignored if the
+   * convex solver can not copy its model (see Model::clone()).
+   */
+  int num_trust_box_candidates;
+  /**
+   * @brief If true, a step the merit function rejects is still accepted by a filter if it decreases the cost or the
+   * penalized constraint violation enough compared to the current iterate and to the past iterates in the filter.
+   * The required decrease is improve_ratio_threshold times the approximate merit improvement, as for the merit test.
+   * Steps whose constraint violation leaves the envelope max(filter_max_violation, filter_violation_ratio * lowest
+   * violation of the iterates so far) are never accepted by the filter, so it can not trade feasibility for cost.
+   */
+  bool use_filter;
+  /** @brief The sum of the constraint violations every step may have without being rejected by the envelope of the
+   * filter (Default: 1e-2) */
+  double filter_max_violation;
+  /** @brief How many times the lowest constraint violation so far a step may have without being rejected by the
+   * envelope of the filter (Default: 2) */
+  double filter_violation_ratio;
+  /** @brief If true, the time spent in each phase and term, the QP sizes and the cache statistics of the terms are
+   * recorded in OptResults::profile. Off by default, it then costs nothing. */
+  bool profile;
+
+  /** @brief Log the results of every iteration to log_dir/log_file. The file is written on a background thread,
+   * trajopt_iteration_log_to_csv converts it to CSV. Also on with debug logging. */
+  bool log_results;
+  std::string log_dir;   // Directory to store log results (Default: /tmp)
+  std::string log_file;  // Name of the iteration log in log_dir (Default: trajopt_iterations.bin)
+  /** @brief If not empty, every QP the optimizer solves is written to this file for replay as it is handed to the
+   * solver, see QPCaptureWriter. Backends that can not export their QP are skipped. A BatchOptimizer gives problems
+   * that share the file one each, as it does for the iteration log. */
+  std::string qp_capture_file;
+
+  /**
+   * @brief If true, the QPs are only solved as accurately as the progress of the SQP needs (inexact SQP). The
+   * tolerance passed to Model::setToleranceHint() starts at max_qp_tolerance in every round of penalty coefficients
+   * and tightens to qp_tolerance_ratio times the relative approximate merit improvement of the last QP, down to
+   * min_qp_tolerance. Convergence is only declared on a QP that was solved with min_qp_tolerance.
+   */
+  bool inexact_qp;
+  double max_qp_tolerance;
+  /** @brief The tolerance near convergence. The default of 0 has the backends solve with their default settings. */
+  double min_qp_tolerance;
+  double qp_tolerance_ratio;
 
   BasicTrustRegionSQPParameters();
 };
@@ -187,6 +332,9 @@ struct BasicTrustRegionSQPResults
    * @param constraints The current exact constraints
    * @param costs The current exact costs
    * @param merit_error_coeff The iteration penalty to apply to constraints
+   * @param pool If not null, the exact costs and constraints are evaluated on this thread pool
+   * @param deadline If not null, the evaluation throws TimeLimitExceeded once it has expired
+   * @param term_eval_times If not null, the time each cost and then each constraint took to evaluate is added to it
    */
   void update(const OptResults& prev_opt_results,
               const Model& model,
@@ -195,7 +343,10 @@ struct BasicTrustRegionSQPResults
               const std::vector<ConvexObjective::Ptr>& cnt_cost_models,
               const std::vector<Constraint::Ptr>& constraints,
               const std::vector<Cost::Ptr>& costs,
-              std::vector<double> merit_error_coeffs);
+              std::vector<double> merit_error_coeffs,
+              ThreadPool* pool = nullptr,
+              const Deadline* deadline = nullptr,
+              double* term_eval_times = nullptr);
 
   /** @brief Print current results to the terminal */
   void print() const;
@@ -236,9 +387,19 @@ public:
   OptStatus optimize() override;
 
 protected:
+  /** @brief Create, resize or release pool so that it runs num_threads work items concurrently */
+  static void updateThreadPool(ThreadPool::Ptr& pool, int num_threads);
   void adjustTrustRegion(double ratio);
   void setTrustBoxConstraints(const DblVec& x);
+  /** @brief Set the bounds of the problem variables in model, which is model_ or a copy of it */
+  void setTrustBoxConstraints(const DblVec& x, Model& model, double trust_box_size) const;
   Model::Ptr model_;
   BasicTrustRegionSQPParameters param_;
+  /** @brief Worker threads used when param_.num_threads > 1 */
+  ThreadPool::Ptr thread_pool_;
+  /** @brief Worker threads used when param_.num_eval_threads > 1 */
+  ThreadPool::Ptr eval_thread_pool_;
+  /** @brief Worker threads used when param_.num_trust_box_candidates > 1 */
+  ThreadPool::Ptr trust_box_thread_pool_;
 };
 }  // namespace sco
@@ -32,35 +32,77 @@ class OSQPModel : public Model
   OSQPWorkspace* osqp_workspace_{ nullptr };
 
   /** Updates OSQP quadratic cost matrix from QuadExpr expression.
-   *  Transforms QuadExpr objective_ into the OSQP CSC matrix P_ */
-  void updateObjective();
+   *  Transforms QuadExpr objective_ into the OSQP CSC matrix P_. The sparsity pattern is only rebuilt if the
+   *  variables of objective_ differ from the ones it was built for, otherwise only the values are refreshed.
+   *  @returns true if the sparsity pattern of P_ changed */
+  bool updateObjective();
+
+  /** Accumulates the coefficients of objective_ into P_csc_data_ through the cached scatter map
+   *  @returns false if objective_ does not match the cached pattern */
+  bool scatterObjective();
+
+  /** Rebuilds the sparsity pattern of P_ and its scatter map from objective_
+   *  @returns true if the sparsity pattern of P_ changed */
+  bool buildObjectivePattern();
 
   /** Updates qpOASES constraints from AffExpr expression.
    *  Transforms AffExpr cntr_exprs_ and box bounds lbs_ and ubs_ into the
-   *  OSQP CSC matrix A_, and vectors lbA_ and ubA_ */
-  void updateConstraints();
+   *  OSQP CSC matrix A_, and vectors l_ and u_. As for P_, the sparsity pattern is cached.
+   *  @returns true if the sparsity pattern of A_ changed */
+  bool updateConstraints();
+
+  /** Accumulates the coefficients of cnt_exprs_ into A_csc_data_ through the cached scatter map
+   *  @returns false if cnt_exprs_ does not match the cached pattern */
+  bool scatterConstraints();
+
+  /** Rebuilds the sparsity pattern of A_ and its scatter map from cnt_exprs_
+   *  @returns true if the sparsity pattern of A_ changed */
+  bool buildConstraintPattern();
 
-  /** Creates or updates the solver and its workspace */
+  /** Updates the vectors l_ and u_ from the constraint constants and box bounds */
+  void updateBounds();
+
+  /** Creates the solver and its workspace, or updates the parts of the workspace that changed */
   void createOrUpdateSolver();
 
+  /** Adds a constraint, reusing the place of a removed one if there is any */
+  Cnt addCnt(const AffExpr& expr, ConstraintType type);
+
+  /** Changes since the workspace was last created or updated */
+  bool vars_dirty_{ true };         /**< variables were added or removed */
+  bool objective_dirty_{ true };    /**< the objective was set */
+  bool constraints_dirty_{ true };  /**< constraints were added or removed */
+  bool bounds_dirty_{ true };       /**< variable bounds were set */
+
   VarVector vars_;                 /**< model variables */
   CntVector cnts_;                 /**< model's constraints sizes */
   DblVec lbs_, ubs_;               /**< variables bounds */
   AffExprVector cnt_exprs_;        /**< constraints expressions */
   ConstraintTypeVector cnt_types_; /**< constraints types */
   DblVec solution_;                /**< optimizizer's solution for current model */
+  DblVec dual_solution_;           /**< multipliers of solution_, one per row of A_ */
+  DblVec warm_primal_;             /**< primal starting point for the next solve */
+  DblVec warm_dual_;               /**< dual starting point for the next solve */
 
-  std::unique_ptr<csc> P_;               /**< Takes ownership of OSQPData.P to avoid having to deallocate manually */
-  std::unique_ptr<csc> A_;               /**< Takes ownership of OSQPData.A to avoid having to deallocate manually */
-  std::vector<c_int> P_row_indices_;     /**< row indices for P, CSC format */
-  std::vector<c_int> P_column_pointers_; /**< column pointers for P, CSC format */
-  DblVec P_csc_data_;                    /**< P values in CSC format */
-  Eigen::VectorXd q_;                    /**< linear part of the objective */
+  std::unique_ptr<csc> P_;                /**< Takes ownership of OSQPData.P to avoid having to deallocate manually */
+  std::unique_ptr<csc> A_;                /**< Takes ownership of OSQPData.A to avoid having to deallocate manually */
+  std::vector<c_int> P_row_indices_;      /**< row indices for P, CSC format */
+  std::vector<c_int> P_column_pointers_;  /**< column pointers for P, CSC format */
+  DblVec P_csc_data_;                     /**< P values in CSC format */
+  DblVec P_csc_data_old_;                 /**< P values the workspace was last updated with */
+  std::vector<c_int> P_term_rows_;        /**< upper triangular row of each objective_ term */
+  std::vector<c_int> P_term_cols_;        /**< upper triangular column of each objective_ term */
+  std::vector<std::size_t> P_term_slots_; /**< index in P_csc_data_ of each objective_ term */
+  Eigen::VectorXd q_;                     /**< linear part of the objective */
 
-  std::vector<c_int> A_row_indices_;     /**< row indices for constraint matrix, CSC format */
-  std::vector<c_int> A_column_pointers_; /**< column pointers for constraint matrix, CSC format */
-  DblVec A_csc_data_;                    /**< constraint matrix values in CSC format */
-  DblVec l_, u_;                         /**< linear constraints upper and lower limits */
+  std::vector<c_int> A_row_indices_;      /**< row indices for constraint matrix, CSC format */
+  std::vector<c_int> A_column_pointers_;  /**< column pointers for constraint matrix, CSC format */
+  DblVec A_csc_data_;                     /**< constraint matrix values in CSC format */
+  DblVec A_csc_data_old_;                 /**< constraint matrix values the workspace was last updated with */
+  std::vector<std::size_t> A_row_starts_; /**< index of the first term of each constraint, then of the bounds */
+  std::vector<c_int> A_term_cols_;        /**< column of each constraint term, followed by the bounds */
+  std::vector<std::size_t> A_term_slots_; /**< index in A_csc_data_ of each term, followed by the bounds */
+  DblVec l_, u_;                          /**< linear constraints upper and lower limits */
 
   QuadExpr objective_; /**< objective QuadExpr expression */
 
@@ -83,9 +125,25 @@ public:
   void setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper) override;
   DblVec getVarValues(const VarVector& vars) const override;
   CvxOptStatus optimize() override;
+  void setTimeLimit(double time_limit) override;
+  /**
+   * @brief Relaxes eps_rel to the tolerance. eps_abs, which is in the units of the residuals, keeps its default, so
+   * it bounds the accuracy of problems whose residuals are small. Solutions are only polished at the default accuracy.
+   */
+  void setToleranceHint(double tolerance) override;
+  /** @brief Turns off the Ruiz scaling of OSQP for prescaled problems. A change takes effect with a new workspace. */
+  void setPrescaled(bool prescaled) override;
+  void setWarmStart(const DblVec& primal, const DblVec& dual) override;
+  DblVec getDualValues() const override;
   void setObjective(const AffExpr&) override;
   void setObjective(const QuadExpr&) override;
   VarVector getVars() const override;
+  Model::Ptr clone() const override;
+  ModelSize getSize() const override;
+  bool exportQP(QPData& qp) const override;
   void writeToFile(const std::string& fname) const override;
+
+  /** @brief The settings the next optimize() solves with */
+  const OSQPSettings& osqpSettings() const { return osqp_settings_; }
 };
 }  // namespace sco
@@ -0,0 +1,153 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cassert>
+#include <cstddef>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/solver_interface.hpp>
+#include <trajopt_sco/solver_selection.hpp>
+
+namespace sco
+{
+/** @brief What the last PresolveModel::optimize() removed from the problem */
+struct PresolveStats
+{
+  /** @brief Variables with equal bounds or fixed by an equality constraint on them alone */
+  std::size_t num_fixed_vars{ 0 };
+  /** @brief Constraints that were left without variables, including the ones that fixed a variable */
+  std::size_t num_dropped_cnts{ 0 };
+  /** @brief Factor of the objective of the reduced QP after equilibration */
+  double cost_scale{ 1 };
+  /** @brief Range of the factors the variables of the reduced QP were divided by */
+  double min_col_scale{ 1 };
+  double max_col_scale{ 1 };
+  /** @brief Only the bounds of free variables changed, so the reduced QP of the previous optimize() was kept */
+  bool reused{ false };
+};
+
+struct PresolveSettings
+{
+  /** @brief Substitute fixed variables. Without it the backend gets all of them and is only equilibrated. */
+  bool remove_fixed_vars{ true };
+  /**
+   * @brief Iterations of Ruiz equilibration of the reduced QP, see ruizEquilibration(). Its rows, columns and
+   * objective are scaled to similar magnitudes before it is handed to the backend, 0 leaves it as it is.
+   */
+  int scaling_iterations{ 10 };
+};
+
+/**
+ * @brief A model that removes fixed variables before the QP is handed to a backend
+ *
+ * Variables whose bounds are equal, e.g. auxiliary variables that were released or joints whose limits pin them, and
+ * variables constrained by an equality on them alone, like a fixed start state or fixed dofs, are substituted into
+ * the objective and the constraints. Constraints that are left without variables are dropped, so the backend solves
+ * a smaller QP. The solution is mapped back to all variables of this model.
+ *
+ * The reduced QP is then equilibrated, so terms whose coefficients differ by orders of magnitude, e.g. collision rows
+ * and joint velocity costs, do not slow down the backend. The scaling is undone on the solution, so getVarValues()
+ * and the constraints and objective of this model are in the original units.
+ *
+ * The backend model is kept from one optimize() to the next, so it can reuse its factorizations and warm start from
+ * its previous solution as long as the same variables are fixed. If only the bounds of free variables changed, the
+ * reduced QP is kept as well and the backend only gets the new bounds. With AUTO_SOLVER it is created by the first
+ * optimize(), which chooses it by the size of the reduced QP, see resolveModelType().
+ */
+class PresolveModel : public Model
+{
+public:
+  /** @brief Presolve for a backend of the given type, or for one chosen on the first optimize() with AUTO_SOLVER */
+  explicit PresolveModel(ModelType inner_type);
+  ~PresolveModel() override = default;
+  PresolveModel(const PresolveModel&) = delete;
+  PresolveModel& operator=(const PresolveModel&) = delete;
+  PresolveModel(PresolveModel&&) = default;
+  PresolveModel& operator=(PresolveModel&&) = default;
+
+  Var addVar(const std::string& name) override;
+  Cnt addEqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const QuadExpr&, const std::string& name) override;
+  void removeVars(const VarVector& vars) override;
+  void removeCnts(const CntVector& cnts) override;
+
+  void update() override;
+  void setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper) override;
+  DblVec getVarValues(const VarVector& vars) const override;
+  CvxOptStatus optimize() override;
+  void setTimeLimit(double time_limit) override;
+  void setToleranceHint(double tolerance) override;
+  void setWarmStart(const DblVec& primal, const DblVec& dual) override;
+  /**
+   * @brief The multipliers of the backend for the reduced problem, in its layout but in the original units.
+   * setWarmStart() scales them for the equilibration of the next optimize().
+   */
+  DblVec getDualValues() const override;
+  void setObjective(const AffExpr&) override;
+  void setObjective(const QuadExpr&) override;
+  void writeToFile(const std::string& fname) const override;
+  VarVector getVars() const override;
+  Model::Ptr clone() const override;
+  ModelSize getSize() const override;
+  bool exportQP(QPData& qp) const override;
+
+  PresolveSettings settings;
+  /**
+   * @brief The backend model, which holds the reduced and scaled problem of the last optimize(). With AUTO_SOLVER it
+   * only exists after the first optimize().
+   */
+  const Model& innerModel() const
+  {
+    assert(inner_ != nullptr);
+    return *inner_;
+  }
+  /** @brief What the last optimize() removed */
+  const PresolveStats& lastPresolve() const { return stats_; }
+
+private:
+  ModelType inner_type_;           /**< type of the backend, AUTO_SOLVER until the first optimize() chooses it */
+  Model::Ptr inner_;               /**< the backend, holding the reduced problem */
+  VarVector vars_;                 /**< model variables */
+  CntVector cnts_;                 /**< model constraints */
+  DblVec lbs_, ubs_;               /**< variable bounds */
+  AffExprVector cnt_exprs_;        /**< constraint expressions */
+  ConstraintTypeVector cnt_types_; /**< constraint types */
+  QuadExpr objective_;             /**< objective expression */
+  VarVector inner_vars_;           /**< counterpart of each variable in the backend, null if it is fixed */
+  CntVector inner_cnts_;           /**< constraints of the reduced problem in the backend */
+  DblVec solution_;                /**< values of all variables after the last optimize() */
+  DblVec warm_primal_;             /**< starting point for the next optimize(), all variables */
+  DblVec warm_dual_;               /**< multipliers of the starting point, in the layout of the backend */
+  DblVec inner_row_scale_;         /**< factor of each constraint of the backend, 1 for free slots */
+  DblVec row_scale_;               /**< factor of each constraint in inner_cnts_ */
+  DblVec inner_col_scale_;         /**< factor each variable of the backend was divided by */
+  double time_limit_;              /**< passed on to the backend */
+  double tolerance_hint_{ 0 };     /**< passed on to the backend */
+  PresolveStats stats_;            /**< what the last optimize() removed */
+  bool infeasible_{ false };       /**< whether the reduced QP has a violated constraint without variables */
+  bool structure_dirty_{ true };   /**< whether constraints or objective changed since the reduced QP was built */
+  std::vector<bool> built_fixed_;  /**< variables that were fixed when the reduced QP was built */
+  DblVec built_values_;            /**< their values */
+  PresolveSettings built_with_;    /**< settings the reduced QP was built with */
+
+  /** Adds a constraint, reusing the place of a removed one if there is any */
+  Cnt addCnt(const AffExpr& expr, ConstraintType type);
+  /** Finds the fixed variables and their values. Constraints that fix a variable are marked in dropped. */
+  void findFixedVars(std::vector<bool>& fixed, DblVec& values, std::vector<bool>& dropped) const;
+  /** The size of the problem the backend is given, before it is equilibrated */
+  QPFeatures reducedFeatures(const std::vector<bool>& fixed, const std::vector<bool>& dropped) const;
+  /** Hands the reduced and equilibrated QP over to the backend, except for the bounds of the free variables */
+  void buildInner(const std::vector<bool>& fixed, const DblVec& values, const std::vector<bool>& dropped);
+  /** Looks up the row scales by the current indices of the rows in the backend */
+  void assignRowScale();
+  /** Converts multipliers in the layout of the backend from the original units to its scaled problem, or back */
+  void scaleDuals(DblVec& dual, bool to_backend) const;
+  /** Writes expr in the variables of the backend, adding the terms of fixed variables to its constant */
+  AffExpr substitute(const AffExpr& expr, const std::vector<bool>& fixed, const DblVec& values) const;
+};
+
+/** @brief Create a PresolveModel, choosing the backend of AUTO_SOLVER as createModel(model_type, features) does */
+Model::Ptr createPresolveModel(ModelType model_type, const QPFeatures& features = QPFeatures());
+}  // namespace sco
@@ -0,0 +1,121 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/sco_common.hpp>
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+/**
+ * @brief A QP as exported by Model::exportQP(), in the form
+ * ```
+ * min   1/2 x'Px + q'x + objective_constant
+ * s.t.  l <= Ax <= u
+ *       lb <= x <= ub
+ * ```
+ * P holds the upper triangle only. Both matrices are stored as triplets, duplicate entries are summed.
+ * Equality constraints have l == u, the others l == -inf.
+ */
+struct QPData
+{
+  DblVec lb, ub; /**< variable bounds */
+  DblVec q;      /**< linear objective */
+  double objective_constant{ 0 };
+  IntVec P_rows, P_cols; /**< upper triangle of the quadratic objective */
+  DblVec P_vals;
+  IntVec A_rows, A_cols; /**< constraint matrix */
+  DblVec A_vals;
+  DblVec l, u; /**< constraint bounds, one per row of A */
+
+  /** @brief The warm start the model had for its next solve, empty if none */
+  DblVec warm_primal;
+  /** @brief The multipliers of the warm start, in the layout of the backend dual_layout */
+  DblVec warm_dual;
+  ModelType dual_layout;
+
+  std::size_t numVars() const { return lb.size(); }
+  std::size_t numCnts() const { return l.size(); }
+};
+
+/**
+ * @brief Fill qp with the problem of a model that keeps its constraints as AffExprs, as the backends do
+ * @param free_cnt_slots Indices of removed constraints that are kept in place, they are skipped
+ * @param warm_dual The multipliers of the warm start, one per variable and one per constraint slot. The ones of the
+ * free slots are skipped like the rows. Left out of qp if it has another size.
+ * @param dual_cnt_offset Index of the multiplier of the first constraint in warm_dual
+ */
+void toQPData(const VarVector& vars,
+              const DblVec& lbs,
+              const DblVec& ubs,
+              const QuadExpr& objective,
+              const AffExprVector& cnt_exprs,
+              const ConstraintTypeVector& cnt_types,
+              const SizeTVec& free_cnt_slots,
+              QPData& qp,
+              const DblVec& warm_dual = DblVec(),
+              std::size_t dual_cnt_offset = 0);
+
+/**
+ * @brief Create a model of the given type that holds the problem of qp, with its warm start
+ *
+ * The variables are called x_0, x_1, ..., in the order of qp. The multipliers of the warm start are only passed on if
+ * model_type matches qp.dual_layout.
+ */
+Model::Ptr createModel(const QPData& qp, ModelType model_type);
+
+/**
+ * @brief Appends QPs to a capture file
+ *
+ * The file is a 16 byte header followed by one record per QP. Records are a fixed header of 8 byte counts and then
+ * the arrays of QPData, all 8 byte wide, so a mapping of the file can be read in place. Every record is flushed
+ * when it is written, so the file is complete up to the last QP if the process dies.
+ */
+class QPCaptureWriter
+{
+public:
+  /** @brief Create the capture file. Throws if it can not be created. */
+  explicit QPCaptureWriter(const std::string& path);
+  ~QPCaptureWriter();
+  QPCaptureWriter(const QPCaptureWriter&) = delete;
+  QPCaptureWriter& operator=(const QPCaptureWriter&) = delete;
+  QPCaptureWriter(QPCaptureWriter&&) = delete;
+  QPCaptureWriter& operator=(QPCaptureWriter&&) = delete;
+
+  void write(const QPData& qp);
+  /** @brief The number of QPs written */
+  std::size_t size() const { return size_; }
+
+private:
+  std::FILE* file_;
+  std::size_t size_{ 0 };
+};
+
+/** @brief Reads a capture file written by QPCaptureWriter through a read-only memory mapping */
+class QPCaptureReader
+{
+public:
+  /** @brief Map a capture file and index its records. Throws if it is not a capture file. */
+  explicit QPCaptureReader(const std::string& path);
+  ~QPCaptureReader();
+  QPCaptureReader(const QPCaptureReader&) = delete;
+  QPCaptureReader& operator=(const QPCaptureReader&) = delete;
+  QPCaptureReader(QPCaptureReader&&) = delete;
+  QPCaptureReader& operator=(QPCaptureReader&&) = delete;
+
+  /** @brief The number of complete QPs in the file */
+  std::size_t size() const { return records_.size(); }
+  /** @brief Copy QP i out of the mapping */
+  QPData get(std::size_t i) const;
+
+private:
+  const unsigned char* data_{ nullptr };
+  std::size_t data_size_{ 0 };
+  std::vector<std::size_t> records_; /**< offset of each record */
+};
+}  // namespace sco
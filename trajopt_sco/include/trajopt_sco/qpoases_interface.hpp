@@ -53,12 +53,18 @@ class qpOASESModel : public Model
    */
   void createSolver();
 
+  /** Adds a constraint, reusing the place of a removed one if there is any */
+  Cnt addCnt(const AffExpr& expr, ConstraintType type);
+
   VarVector vars_;                 /**< model variables */
   CntVector cnts_;                 /**< model's constraints sizes */
   DblVec lb_, ub_;                 /**< variables bounds */
   AffExprVector cnt_exprs_;        /**< constraints expressions */
   ConstraintTypeVector cnt_types_; /**< constraints types */
   DblVec solution_;                /**< optimizizer's solution for current model */
+  DblVec dual_solution_;           /**< multipliers of solution_, bounds followed by constraints */
+  DblVec warm_primal_;             /**< primal starting point for the next cold start */
+  DblVec warm_dual_;               /**< dual starting point for the next cold start */
 
   IntVec H_row_indices_;     /**< row indices for Hessian, CSC format */
   IntVec H_column_pointers_; /**< column pointers for Hessian, CSC format */
@@ -71,6 +77,7 @@ class qpOASESModel : public Model
   DblVec lbA_, ubA_;         /**< linear constraints upper and lower limits */
 
   QuadExpr objective_; /**< objective QuadExpr expression */
+  double time_limit_;   /**< maximum solve time in seconds, infinite if not limited */
 
 public:
   qpOASESModel();
@@ -87,9 +94,15 @@ public:
   void setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper) override;
   DblVec getVarValues(const VarVector& vars) const override;
   virtual CvxOptStatus optimize() override;
+  void setTimeLimit(double time_limit) override;
+  void setWarmStart(const DblVec& primal, const DblVec& dual) override;
+  DblVec getDualValues() const override;
   virtual void setObjective(const AffExpr&) override;
   virtual void setObjective(const QuadExpr&) override;
   virtual void writeToFile(const std::string& fname) const override;
   virtual VarVector getVars() const override;
+  Model::Ptr clone() const override;
+  ModelSize getSize() const override;
+  bool exportQP(QPData& qp) const override;
 };
 }  // namespace sco
@@ -0,0 +1,55 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <Eigen/Core>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+/** Update rule of a QuasiNewtonHessian */
+enum QuasiNewtonType
+{
+  NO_QUASI_NEWTON,
+  DAMPED_BFGS,  // Powell-damped BFGS, stays positive definite
+  SR1           // symmetric rank one, may become indefinite
+};
+
+/**
+ * QuasiNewtonHessian estimates the Hessian of a function from the changes of its gradient between the points it is
+ * evaluated at, so a cost can add curvature to its convexification that it can not afford to compute.
+ *
+ * There is no estimate until the first update with a step that carries curvature information. The first update of
+ * DAMPED_BFGS starts from a scaled identity, the one of SR1 from zero.
+ */
+class QuasiNewtonHessian
+{
+public:
+  explicit QuasiNewtonHessian(QuasiNewtonType type = NO_QUASI_NEWTON) : type_(type) {}
+
+  QuasiNewtonType type() const { return type_; }
+  /** @brief Whether there is an estimate yet */
+  bool empty() const { return hessian_.size() == 0; }
+  /** @brief The current estimate, empty until the first update */
+  const Eigen::MatrixXd& hessian() const { return hessian_; }
+
+  /**
+   * @brief Update the estimate with a step and the change of the gradient along it
+   * @param s The step x_new - x_old
+   * @param y The gradient change grad(x_new) - grad(x_old)
+   * @return Whether the estimate changed. Steps that would make the update unstable are skipped.
+   */
+  bool update(const Eigen::VectorXd& s, const Eigen::VectorXd& y);
+
+  /**
+   * @brief The quadratic 0.5 (vars - x)^T H (vars - x), where H is the positive semidefinite part of the estimate
+   * @return An empty expression if there is no estimate yet
+   */
+  QuadExpr quadExpr(const Eigen::VectorXd& x, const VarVector& vars) const;
+
+private:
+  QuasiNewtonType type_;
+  Eigen::MatrixXd hessian_;
+};
+}  // namespace sco
@@ -0,0 +1,92 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+namespace sco
+{
+/**
+ * @brief Slab allocator for the VarRep and CntRep objects of a model
+ *
+ * Reps are constructed in slabs that grow geometrically, so adding many variables or constraints takes few heap
+ * allocations. Released reps are kept on a free list and recycled by the next create(), so a Var or Cnt that outlived
+ * the removal of its variable or constraint refers to whatever took its place and must not be used. All reps, live or
+ * released, are destroyed with the arena.
+ */
+template <typename Rep>
+class RepArena
+{
+public:
+  RepArena() = default;
+  ~RepArena()
+  {
+    for (std::size_t i = 0; i < slabs_.size(); ++i)
+    {
+      Rep* reps = reinterpret_cast<Rep*>(slabs_[i].get());
+      const std::size_t n = (i + 1 == slabs_.size()) ? used_ : slabSize(i);
+      for (std::size_t j = 0; j < n; ++j)
+        reps[j].~Rep();
+    }
+  }
+  RepArena(const RepArena&) = delete;
+  RepArena& operator=(const RepArena&) = delete;
+  RepArena(RepArena&&) noexcept = default;
+  RepArena& operator=(RepArena&& other) noexcept
+  {
+    // The reps of this arena are destroyed with other
+    std::swap(slabs_, other.slabs_);
+    std::swap(used_, other.used_);
+    std::swap(free_, other.free_);
+    std::swap(created_, other.created_);
+    return *this;
+  }
+
+  /** @brief Construct a rep, recycling a released one if there is any */
+  template <typename... Args>
+  Rep* create(Args&&... args)
+  {
+    ++created_;
+    if (!free_.empty())
+    {
+      Rep* rep = free_.back();
+      free_.pop_back();
+      rep->~Rep();
+      return new (rep) Rep(std::forward<Args>(args)...);
+    }
+
+    if (slabs_.empty() || used_ == slabSize(slabs_.size() - 1))
+    {
+      slabs_.emplace_back(new Storage[slabSize(slabs_.size())]);
+      used_ = 0;
+    }
+    return new (&slabs_.back()[used_++]) Rep(std::forward<Args>(args)...);
+  }
+
+  /** @brief Hand a rep back for recycling. It must have been created by this arena and not be used anymore. */
+  void release(Rep* rep) { free_.push_back(rep); }
+
+  /** @brief The number of reps created without a heap allocation of their own */
+  std::size_t numAllocationsAvoided() const { return created_ - slabs_.size(); }
+
+private:
+  using Storage = typename std::aligned_storage<sizeof(Rep), alignof(Rep)>::type;
+
+  static constexpr std::size_t FIRST_SLAB_SIZE = 16;
+  static constexpr std::size_t MAX_SLAB_SIZE = 4096;
+  static std::size_t slabSize(std::size_t slab)
+  {
+    return std::min(FIRST_SLAB_SIZE << std::min<std::size_t>(slab, 8), MAX_SLAB_SIZE);
+  }
+
+  std::vector<std::unique_ptr<Storage[]>> slabs_;
+  std::size_t used_{ 0 }; /**< number of reps constructed in the last slab */
+  std::vector<Rep*> free_;
+  std::size_t created_{ 0 };
+};
+}  // namespace sco
@@ -9,6 +9,7 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <vector>
 #include <memory>
 TRAJOPT_IGNORE_WARNINGS_POP
+#include <trajopt_sco/rep_arena.hpp>
 #include <trajopt_sco/sco_common.hpp>
 
 /**
@@ -38,6 +39,51 @@ enum CvxOptStatus
   CVX_FAILED
 };
 
+/** @brief Dimensions of the QP held by a model */
+struct ModelSize
+{
+  std::size_t num_vars{ 0 };
+  std::size_t num_cnts{ 0 };
+  /** @brief Number of coefficients in the constraint rows */
+  std::size_t cnt_nonzeros{ 0 };
+  /** @brief Number of quadratic terms in the objective */
+  std::size_t objective_nonzeros{ 0 };
+};
+
+struct VarRep
+{
+  using Ptr = std::shared_ptr<VarRep>;
+
+  VarRep(std::size_t _index, std::string _name, void* _creator)
+    : index(_index), name(std::move(_name)), removed(false), creator(_creator)
+  {
+  }
+  std::size_t index;
+  std::string name;
+  bool removed;
+  void* creator;
+};
+
+struct CntRep
+{
+  using Ptr = std::shared_ptr<CntRep>;
+
+  CntRep(std::size_t _index, void* _creator) : index(_index), removed(false), creator(_creator) {}
+  CntRep(const CntRep&) = default;
+  CntRep& operator=(const CntRep&) = default;
+  CntRep(CntRep&&) = default;
+  CntRep& operator=(CntRep&&) = default;
+  ~CntRep() = default;
+
+  std::size_t index;
+  bool removed;
+  void* creator;
+  ConstraintType type{ INEQ };
+  std::string expr;  // todo placeholder
+};
+
+struct QPData;
+
 /** @brief Convex optimization problem
 
 Gotchas:
@@ -53,8 +99,8 @@ public:
 
   Model() = default;
   virtual ~Model() = default;
-  Model(const Model&) = default;
-  Model& operator=(const Model&) = default;
+  Model(const Model&) = delete;
+  Model& operator=(const Model&) = delete;
   Model(Model&&) = default;
   Model& operator=(Model&&) = default;
 
@@ -76,26 +122,148 @@ public:
   virtual double getVarValue(const Var& var) const;
   virtual DblVec getVarValues(const VarVector& vars) const = 0;
   virtual CvxOptStatus optimize() = 0;
+  /**
+   * @brief Limit the wall time in seconds that subsequent calls to optimize() may take. A limit that is not finite
+   * removes it. Backends that can not interrupt a solve ignore it.
+   */
+  virtual void setTimeLimit(double /*time_limit*/) {}
+  /**
+   * @brief Hint how accurately subsequent calls to optimize() need to solve, as a relative tolerance. Backends relax
+   * their stopping criteria to it, but never tighten them beyond their defaults, so 0 restores the defaults. Backends
+   * whose accuracy can not be adjusted ignore it.
+   */
+  virtual void setToleranceHint(double /*tolerance*/) {}
+  /**
+   * @brief Tell the backend whether the problem it is given is already equilibrated, so it can skip its own scaling.
+   * Backends that do not scale ignore it.
+   */
+  virtual void setPrescaled(bool /*prescaled*/) {}
+  /**
+   * @brief Set a starting point for the next call to optimize(). Backends that can not warm start ignore it, and so
+   * do the others if the sizes do not match the current model.
+   * @param primal Values of all variables, in the order of getVars()
+   * @param dual Multipliers in the backend specific layout returned by getDualValues(), may be empty
+   */
+  virtual void setWarmStart(const DblVec& /*primal*/, const DblVec& /*dual*/) {}
+  /** @brief Multipliers of the last solution in a backend specific layout, empty if not available */
+  virtual DblVec getDualValues() const { return DblVec(); }
 
   virtual void setObjective(const AffExpr&) = 0;
   virtual void setObjective(const QuadExpr&) = 0;
   virtual void writeToFile(const std::string& fname) const = 0;
 
   virtual VarVector getVars() const = 0;
-};
 
-struct VarRep
-{
-  using Ptr = std::shared_ptr<VarRep>;
+  /**
+   * @brief Create an independent copy of the model that can be changed and solved concurrently with this one
+   *
+   * The copy has its own variables and constraints, with the same indices as in this model, so its solution can be
+   * evaluated with expressions built on this model. Backends that can not be copied return nullptr.
+   */
+  virtual Model::Ptr clone() const { return nullptr; }
+
+  /**
+   * @brief The dimensions of the model as of the last update(), without removed constraints. Backends that do not
+   * keep track of their constraints only report the number of variables.
+   */
+  virtual ModelSize getSize() const;
+
+  /**
+   * @brief Export the problem as of the last update() for capture and replay, see QPCaptureWriter
+   * @return False if the backend can not export its problem
+   */
+  virtual bool exportQP(QPData& /*qp*/) const { return false; }
+
+  /**
+   * @brief Add an auxiliary variable, e.g. the slack of a convexified hinge or abs penalty
+   *
+   * Variables handed back with releaseAuxVars() are reused before new ones are added, lowest index first, so the
+   * variable layout of the model stays the same from one SQP iteration to the next.
+   */
+  virtual Var addAuxVar(const std::string& name, double lb, double ub);
+  /** @brief Return auxiliary variables for reuse. They stay in the model, fixed to zero, until they are reused. */
+  virtual void releaseAuxVars(const VarVector& vars);
+  /** @brief The number of released auxiliary variables that are waiting to be reused */
+  std::size_t numFreeAuxVars() const { return free_aux_vars_.size(); }
+  /** @brief The number of times optimize() dropped the removed constraints and renumbered the others */
+  std::size_t numCompactions() const { return num_compactions_; }
+  /** @brief The number of constraint rows the last optimize() handed to the solver */
+  std::size_t numSolvedCnts() const { return num_solved_cnts_; }
+  /** @brief The number of VarReps and CntReps the model created without a heap allocation of their own */
+  std::size_t numRepAllocationsAvoided() const
+  {
+    return var_arena_.numAllocationsAvoided() + cnt_arena_.numAllocationsAvoided();
+  }
 
-  VarRep(std::size_t _index, std::string _name, void* _creator)
-    : index(_index), name(std::move(_name)), removed(false), creator(_creator)
+protected:
+  /** @brief Mark variables as removed. The next commitVarRemovals() drops them. */
+  void queueRemovals(const VarVector& vars);
+  /** @brief Mark constraints as removed. The next commitCntRemovals() frees their places. */
+  void queueRemovals(const CntVector& cnts);
+  /**
+   * @brief Add a constraint in the place of a removed one, so the size of the problem does not change
+   *
+   * A removal that commitCntRemovals() has not committed yet is taken over directly and never becomes a free place.
+   * Without a removed constraint the new one is appended.
+   */
+  Cnt addCntSlot(CntVector& cnts,
+                 AffExprVector& cnt_exprs,
+                 ConstraintTypeVector& cnt_types,
+                 const AffExpr& expr,
+                 ConstraintType type);
+  /**
+   * @brief Drop the variables removed since the last update() and renumber the others
+   *
+   * Variables are renumbered right away, since values returned for getVars() are looked up by variable index.
+   * @param kept Set to the old index of each variable that is kept. Apply it to per-variable data with keepEntries().
+   * @return Whether any variable was removed
+   */
+  bool commitVarRemovals(VarVector& vars, SizeTVec& kept);
+  /**
+   * @brief Free the places of the constraints removed since the last update()
+   *
+   * They stay in place as 0 <= 0 until they are reused or compactCnts() drops them before a solve.
+   * @return Whether any constraint was removed
+   */
+  bool commitCntRemovals(AffExprVector& cnt_exprs, ConstraintTypeVector& cnt_types);
+  /**
+   * @brief Whether a backend has to compact its constraints with compactCnts() before it solves
+   *
+   * Removed constraints are left in place and reused by later additions, which keeps update() proportional to the
+   * number of changes. The places that are still free when the model is solved are dropped and the rest renumbered,
+   * so the solver never sees them.
+   */
+  bool needsCompaction() const { return !free_cnt_slots_.empty(); }
+  /** @brief Drop the free constraint places and renumber the others. Counted in numCompactions(). */
+  void compactCnts(CntVector& cnts, AffExprVector& cnt_exprs, ConstraintTypeVector& cnt_types);
+  /** @brief Keep the entries of per-variable data at the indices commitVarRemovals() kept. Shorter data is cut. */
+  template <typename T>
+  static void keepEntries(std::vector<T>& data, const SizeTVec& kept)
   {
+    std::size_t inew = 0;
+    for (; inew < kept.size() && kept[inew] < data.size(); ++inew)
+    {
+      if (inew != kept[inew])
+        data[inew] = std::move(data[kept[inew]]);
+    }
+    data.resize(inew);
   }
-  std::size_t index;
-  std::string name;
-  bool removed;
-  void* creator;
+
+  /** @brief Take over the released auxiliary variables of other for clone(). vars[i] is the variable with index i. */
+  void copyFreeAuxVars(const Model& other, const VarVector& vars);
+
+  /** @brief Storage of the VarReps of the model. Reps removed by update() are released to it. */
+  RepArena<VarRep> var_arena_;
+  /** @brief Storage of the CntReps of the model. Reps removed by update() are released to it. */
+  RepArena<CntRep> cnt_arena_;
+  /** @brief Released auxiliary variables. If free_aux_vars_sorted_, they are sorted by decreasing index. */
+  VarVector free_aux_vars_;
+  bool free_aux_vars_sorted_{ true };
+  VarVector removed_vars_;  /**< variables removed since the last update() */
+  CntVector removed_cnts_;  /**< constraints removed since the last update() */
+  SizeTVec free_cnt_slots_; /**< indices of removed constraints, reused by the next additions */
+  std::size_t num_compactions_{ 0 };
+  std::size_t num_solved_cnts_{ 0 };
 };
 
 struct Var
@@ -119,24 +287,6 @@ struct Var
   }
 };
 
-struct CntRep
-{
-  using Ptr = std::shared_ptr<CntRep>;
-
-  CntRep(std::size_t _index, void* _creator) : index(_index), removed(false), creator(_creator) {}
-  CntRep(const CntRep&) = default;
-  CntRep& operator=(const CntRep&) = default;
-  CntRep(CntRep&&) = default;
-  CntRep& operator=(CntRep&&) = default;
-  ~CntRep() = default;
-
-  std::size_t index;
-  bool removed;
-  void* creator;
-  ConstraintType type;
-  std::string expr;  // todo placeholder
-};
-
 struct Cnt
 {
   using Ptr = std::shared_ptr<Cnt>;
@@ -206,7 +356,8 @@ public:
     OSQP,
     QPOASES,
     BPMPD,
-    AUTO_SOLVER
+    AUTO_SOLVER,
+    BANDED
   };
 
   static const std::vector<std::string> MODEL_NAMES_;
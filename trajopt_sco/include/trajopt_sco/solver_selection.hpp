@@ -0,0 +1,88 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstddef>
+#include <jsoncpp/json/json.h>
+#include <string>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+struct QPData;
+
+/** @brief The features of a QP that ModelType::AUTO_SOLVER chooses a backend by. Counts that are unknown are 0. */
+struct QPFeatures
+{
+  std::size_t num_vars{ 0 };
+  std::size_t num_eq_cnts{ 0 };
+  std::size_t num_ineq_cnts{ 0 };
+  /** @brief Number of nonzeros of the constraint matrix */
+  std::size_t cnt_nonzeros{ 0 };
+
+  std::size_t numCnts() const { return num_eq_cnts + num_ineq_cnts; }
+  /** @brief The fraction of the constraint matrix that is nonzero, 0 if unknown */
+  double density() const;
+  /** @brief The fraction of the constraints that are equalities, 1 if there are none */
+  double eqFraction() const;
+};
+
+/** @brief The features of a captured QP */
+QPFeatures qpFeatures(const QPData& qp);
+
+/**
+ * @brief The thresholds selectModelType() chooses by
+ *
+ * The defaults are a starting point. trajopt_calibrate_solver_selection measures the backends on this machine and
+ * writes a config file with thresholds that fit it, see loadSolverSelectionThresholds().
+ */
+struct SolverSelectionThresholds
+{
+  /** @brief Problems with at most this many variables go to the active set solver qpOASES... */
+  std::size_t active_set_max_vars{ 150 };
+  /** @brief ...if at least this fraction of their constraints are equalities, which never leave the active set */
+  double active_set_min_eq_fraction{ 0 };
+  /** @brief Problems with at least this many variables go to OSQP if they are sparse, or else to BPMPD */
+  std::size_t large_min_vars{ 500 };
+  /** @brief The highest constraint matrix density that counts as sparse */
+  double sparse_max_density{ 0.05 };
+
+  /** @brief Read the thresholds that are set in v, the others keep their value */
+  void fromJson(const Json::Value& v);
+  Json::Value toJson() const;
+};
+
+/**
+ * @brief The thresholds used by AUTO_SOLVER
+ *
+ * On first use they are read from the JSON file named by the environment variable TRAJOPT_SOLVER_SELECTION, if it
+ * is set, and are the defaults otherwise.
+ */
+SolverSelectionThresholds solverSelectionThresholds();
+/** @brief Replace the thresholds used by AUTO_SOLVER */
+void setSolverSelectionThresholds(const SolverSelectionThresholds& thresholds);
+/** @brief Read thresholds from a JSON config file. Throws if it can not be read. */
+SolverSelectionThresholds loadSolverSelectionThresholds(const std::string& path);
+/** @brief Write thresholds to a JSON config file. Throws if it can not be written. */
+void saveSolverSelectionThresholds(const std::string& path, const SolverSelectionThresholds& thresholds);
+
+/**
+ * @brief Choose an available backend for a QP with the given features
+ *
+ * Small problems go to qpOASES, large sparse ones to OSQP and large dense ones to BPMPD. Everything else, and
+ * problems whose backend is not available, goes to the first of availableSolvers().
+ */
+ModelType selectModelType(const QPFeatures& features,
+                          const SolverSelectionThresholds& thresholds = solverSelectionThresholds());
+
+/**
+ * @brief The backend createModel(model_type, features) creates. Other types than AUTO_SOLVER are returned unchanged.
+ *
+ * The TRAJOPT_CONVEX_SOLVER environment variable still takes precedence over the features.
+ */
+ModelType resolveModelType(ModelType model_type, const QPFeatures& features);
+
+/** @brief Create a model, choosing the backend of AUTO_SOLVER by the features of the problem it will hold */
+Model::Ptr createModel(ModelType model_type, const QPFeatures& features);
+}  // namespace sco
@@ -93,6 +93,29 @@ void eigenToTriplets(const Eigen::SparseMatrix<double>& sparse_matrix,
                      IntVec& cols_j,
                      DblVec& values_ij);
 
+/**
+ * @brief Ruiz equilibration of the QP `min 1/2 x'Px + q'x` subject to constraints on the rows of `Ax`
+ *
+ * Finds a column scaling `D`, a row scaling `E` and a cost scaling `c` such that the columns of `c D P D` and
+ * `E A D` and the rows of `E A D` have an infinity norm close to 1. The scaled problem is solved for `y = D^-1 x`.
+ * Norms that are close to 0 or very large are only scaled partially, as OSQP does.
+ *
+ * @param [in] P the full, symmetric quadratic objective
+ * @param [in] q the linear objective
+ * @param [in] A the constraint matrix
+ * @param [in] iterations the number of Ruiz iterations, each halves the logarithm of the spread of the norms
+ * @param [out] col_scale the diagonal of `D`
+ * @param [out] row_scale the diagonal of `E`
+ * @param [out] cost_scale `c`
+ */
+void ruizEquilibration(Eigen::SparseMatrix<double> P,
+                       Eigen::VectorXd q,
+                       Eigen::SparseMatrix<double> A,
+                       int iterations,
+                       Eigen::VectorXd& col_scale,
+                       Eigen::VectorXd& row_scale,
+                       double& cost_scale);
+
 /**
  * @brief converts a sparse matrix into compressed
  *        sparse column representation (CSC).
@@ -0,0 +1,69 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+namespace sco
+{
+/**
+ * @brief A fixed size pool of worker threads used to run independent work items
+ *
+ * The calling thread takes part in the work, so a pool of size n uses n - 1 worker threads.
+ * Work items are handed out dynamically, but results are expected to be written into
+ * slots addressed by the item index so that the outcome does not depend on scheduling.
+ */
+class ThreadPool
+{
+public:
+  using Ptr = std::shared_ptr<ThreadPool>;
+
+  /** @brief Create a pool that runs at most num_threads items concurrently (including the caller) */
+  explicit ThreadPool(std::size_t num_threads);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  /** @brief The number of items that may run concurrently */
+  std::size_t size() const { return workers_.size() + 1; }
+
+  /**
+   * @brief Calls func(i) for every i in [0, n) and blocks until all calls have returned
+   *
+   * If one or more calls throw, the exception thrown by the lowest index is rethrown
+   * after all other items have finished. Must not be called from within a work item.
+   * The items log at the level of the calling thread (see util::ScopedLogLevel).
+   */
+  void parallelFor(std::size_t n, const std::function<void(std::size_t)>& func);
+
+private:
+  void workerLoop();
+  void runItems();
+
+  std::vector<std::thread> workers_;
+  std::mutex call_mutex_;  // serializes concurrent callers of parallelFor
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stop_{ false };
+  std::size_t generation_{ 0 };  // incremented every time a new job is posted
+
+  /** Current job */
+  const std::function<void(std::size_t)>* func_{ nullptr };
+  std::size_t n_items_{ 0 };
+  std::size_t next_item_{ 0 };
+  std::size_t finished_items_{ 0 };
+  std::size_t error_index_{ 0 };
+  int log_level_{ -1 };  // util::gThreadLogLevel of the caller
+  std::exception_ptr error_;
+};
+}  // namespace sco
@@ -0,0 +1,362 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <fstream>
+#include <limits>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/auto_solver_model.hpp>
+#include <trajopt_sco/compact_expr.hpp>
+#include <trajopt_sco/qp_capture.hpp>
+
+namespace sco
+{
+const double AUTO_SOLVER_INFINITY = std::numeric_limits<double>::infinity();
+
+AutoSolverModel::AutoSolverModel() : inner_type_(ModelType::AUTO_SOLVER), time_limit_(AUTO_SOLVER_INFINITY) {}
+
+Var AutoSolverModel::addVar(const std::string& name)
+{
+  if (inner_ != nullptr)
+    return inner_->addVar(name);
+  vars_.push_back(var_arena_.create(vars_.size(), name, this));
+  lbs_.push_back(-AUTO_SOLVER_INFINITY);
+  ubs_.push_back(AUTO_SOLVER_INFINITY);
+  return vars_.back();
+}
+
+Cnt AutoSolverModel::addEqCnt(const AffExpr& expr, const std::string& name)
+{
+  if (inner_ != nullptr)
+    return inner_->addEqCnt(expr, name);
+  cnts_.push_back(cnt_arena_.create(cnts_.size(), this));
+  cnt_exprs_.push_back(expr);
+  cnt_types_.push_back(EQ);
+  return cnts_.back();
+}
+
+Cnt AutoSolverModel::addIneqCnt(const AffExpr& expr, const std::string& name)
+{
+  if (inner_ != nullptr)
+    return inner_->addIneqCnt(expr, name);
+  cnts_.push_back(cnt_arena_.create(cnts_.size(), this));
+  cnt_exprs_.push_back(expr);
+  cnt_types_.push_back(INEQ);
+  return cnts_.back();
+}
+
+Cnt AutoSolverModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
+{
+  throw std::runtime_error("NOT IMPLEMENTED");
+}
+
+Var AutoSolverModel::innerVar(const Var& var) const
+{
+  // The index of a recorded variable follows the backend, its counterpart is found by its recorded position
+  if (var.var_rep->creator != this || inner_ == nullptr)
+    return var;
+  return inner_vars_[recorded_pos_.at(var.var_rep)];
+}
+
+void AutoSolverModel::removeVars(const VarVector& vars)
+{
+  VarVector inner_vars;
+  for (const Var& var : vars)
+  {
+    if (var.var_rep->creator != this)
+      inner_vars.push_back(var);
+    else if (!var.var_rep->removed)
+    {
+      if (inner_ != nullptr)
+        inner_vars.push_back(innerVar(var));
+      var.var_rep->removed = true;
+      removed_ = true;
+    }
+  }
+  if (inner_ != nullptr)
+    inner_->removeVars(inner_vars);
+}
+
+void AutoSolverModel::removeCnts(const CntVector& cnts)
+{
+  CntVector inner_cnts;
+  for (const Cnt& cnt : cnts)
+  {
+    if (cnt.cnt_rep->creator != this)
+      inner_cnts.push_back(cnt);
+    else if (!cnt.cnt_rep->removed)
+    {
+      if (inner_ != nullptr)
+        inner_cnts.push_back(inner_cnts_[cnt.cnt_rep->index]);
+      cnt.cnt_rep->removed = true;
+    }
+  }
+  if (inner_ != nullptr)
+    inner_->removeCnts(inner_cnts);
+}
+
+void AutoSolverModel::update()
+{
+  if (inner_ != nullptr)
+  {
+    inner_->update();
+    // The backend renumbers its variables when any of them are removed, the recorded ones follow their counterparts
+    for (std::size_t i = 0; i < vars_.size(); ++i)
+    {
+      if (!vars_[i].var_rep->removed)
+        vars_[i].var_rep->index = inner_vars_[i].var_rep->index;
+    }
+    removed_ = false;
+    return;
+  }
+  if (!removed_)
+    return;
+
+  // Nothing is solved yet, so the recorded problem is simply compacted
+  std::size_t inew = 0;
+  for (std::size_t iold = 0; iold < vars_.size(); ++iold)
+  {
+    const Var& var = vars_[iold];
+    if (!var.var_rep->removed)
+    {
+      vars_[inew] = var;
+      lbs_[inew] = lbs_[iold];
+      ubs_[inew] = ubs_[iold];
+      var.var_rep->index = inew;
+      ++inew;
+    }
+  }
+  vars_.resize(inew);
+  lbs_.resize(inew);
+  ubs_.resize(inew);
+  removed_ = false;
+}
+
+void AutoSolverModel::setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper)
+{
+  if (inner_ != nullptr)
+  {
+    VarVector inner_vars;
+    inner_vars.reserve(vars.size());
+    for (const Var& var : vars)
+      inner_vars.push_back(innerVar(var));
+    inner_->setVarBounds(inner_vars, lower, upper);
+    return;
+  }
+  for (std::size_t i = 0; i < vars.size(); ++i)
+  {
+    lbs_[vars[i].var_rep->index] = lower[i];
+    ubs_[vars[i].var_rep->index] = upper[i];
+  }
+}
+
+DblVec AutoSolverModel::getVarValues(const VarVector& vars) const
+{
+  if (inner_ == nullptr)
+    return DblVec(vars.size(), 0);
+  VarVector inner_vars;
+  inner_vars.reserve(vars.size());
+  for (const Var& var : vars)
+    inner_vars.push_back(innerVar(var));
+  return inner_->getVarValues(inner_vars);
+}
+
+void AutoSolverModel::recordedQP(QPData& qp) const
+{
+  SizeTVec removed_cnts;
+  for (std::size_t i = 0; i < cnts_.size(); ++i)
+  {
+    if (cnts_[i].cnt_rep->removed)
+      removed_cnts.push_back(i);
+  }
+  toQPData(vars_, lbs_, ubs_, objective_, cnt_exprs_, cnt_types_, removed_cnts, qp);
+  qp.warm_primal = warm_primal_;
+  qp.warm_dual = warm_dual_;
+  qp.dual_layout = ModelType::AUTO_SOLVER;
+}
+
+void AutoSolverModel::resolve()
+{
+  update();
+  QPData qp;
+  recordedQP(qp);
+  inner_type_ = resolveModelType(ModelType::AUTO_SOLVER, qpFeatures(qp));
+  inner_ = createModel(inner_type_);
+
+  // A new backend numbers the variables in the order they are added, like the recorded ones
+  inner_vars_.reserve(vars_.size());
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+  {
+    inner_vars_.push_back(inner_->addVar(vars_[i].var_rep->name, lbs_[i], ubs_[i]));
+    recorded_pos_[vars_[i].var_rep] = i;
+  }
+  inner_cnts_.resize(cnts_.size());
+  for (std::size_t i = 0; i < cnts_.size(); ++i)
+  {
+    if (cnts_[i].cnt_rep->removed)
+      continue;
+    inner_cnts_[i] =
+        (cnt_types_[i] == EQ) ? inner_->addEqCnt(cnt_exprs_[i], "") : inner_->addIneqCnt(cnt_exprs_[i], "");
+  }
+  inner_->setObjective(objective_);
+  inner_->setTimeLimit(time_limit_);
+  inner_->setToleranceHint(tolerance_hint_);
+  if (!warm_primal_.empty())
+    inner_->setWarmStart(warm_primal_, warm_dual_);
+  inner_->update();
+
+  // The backend holds the problem now
+  lbs_ = DblVec();
+  ubs_ = DblVec();
+  cnt_exprs_ = AffExprVector();
+  cnt_types_ = ConstraintTypeVector();
+  objective_ = QuadExpr();
+  warm_primal_ = DblVec();
+  warm_dual_ = DblVec();
+}
+
+CvxOptStatus AutoSolverModel::optimize()
+{
+  if (inner_ == nullptr)
+    resolve();
+  // Renumbers the recorded variables before the backend reads the indices of the expressions
+  update();
+  return inner_->optimize();
+}
+
+void AutoSolverModel::setTimeLimit(double time_limit)
+{
+  time_limit_ = time_limit;
+  if (inner_ != nullptr)
+    inner_->setTimeLimit(time_limit);
+}
+
+void AutoSolverModel::setToleranceHint(double tolerance)
+{
+  tolerance_hint_ = tolerance;
+  if (inner_ != nullptr)
+    inner_->setToleranceHint(tolerance);
+}
+
+void AutoSolverModel::setWarmStart(const DblVec& primal, const DblVec& dual)
+{
+  if (inner_ != nullptr)
+  {
+    inner_->setWarmStart(primal, dual);
+    return;
+  }
+  warm_primal_ = primal;
+  warm_dual_ = dual;
+}
+
+DblVec AutoSolverModel::getDualValues() const { return (inner_ != nullptr) ? inner_->getDualValues() : DblVec(); }
+
+void AutoSolverModel::setObjective(const AffExpr& expr) { setObjective(QuadExpr(expr)); }
+
+void AutoSolverModel::setObjective(const QuadExpr& expr)
+{
+  if (inner_ != nullptr)
+    inner_->setObjective(expr);
+  else
+    objective_ = expr;
+}
+
+void AutoSolverModel::writeToFile(const std::string& fname) const
+{
+  if (inner_ != nullptr)
+  {
+    inner_->writeToFile(fname);
+    return;
+  }
+  std::ofstream outStream(fname);
+  outStream << "\\ Generated by trajopt_sco before AUTO_SOLVER chose a backend\n";
+  outStream << "Minimize\n";
+  outStream << objective_;
+  outStream << "Subject To\n";
+  for (std::size_t i = 0; i < cnt_exprs_.size(); ++i)
+  {
+    if (cnts_[i].cnt_rep->removed)
+      continue;
+    std::string op = (cnt_types_[i] == INEQ) ? " <= " : " = ";
+    outStream << cnt_exprs_[i] << op << 0 << "\n";
+  }
+
+  outStream << "Bounds\n";
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+  {
+    outStream << lbs_[i] << " <= " << vars_[i] << " <= " << ubs_[i] << "\n";
+  }
+  outStream << "End";
+}
+
+VarVector AutoSolverModel::getVars() const
+{
+  if (inner_ == nullptr)
+    return vars_;
+  // The recorded variables are handed out with their own handles, as when they were added
+  VarVector out = inner_->getVars();
+  for (const Var& var : vars_)
+  {
+    if (!var.var_rep->removed)
+      out[var.var_rep->index] = var;
+  }
+  return out;
+}
+
+Model::Ptr AutoSolverModel::clone() const
+{
+  if (inner_ != nullptr)
+    return inner_->clone();
+
+  auto out = std::make_shared<AutoSolverModel>();
+  out->vars_.reserve(vars_.size());
+  for (const Var& var : vars_)
+  {
+    out->vars_.push_back(out->var_arena_.create(var.var_rep->index, var.var_rep->name, out.get()));
+    out->vars_.back().var_rep->removed = var.var_rep->removed;
+  }
+  out->cnts_.reserve(cnts_.size());
+  out->cnt_exprs_.reserve(cnts_.size());
+  for (std::size_t i = 0; i < cnts_.size(); ++i)
+  {
+    out->cnts_.push_back(out->cnt_arena_.create(i, out.get()));
+    out->cnts_.back().cnt_rep->removed = cnts_[i].cnt_rep->removed;
+    out->cnt_exprs_.push_back(toAffExpr(CompactAffExpr(cnt_exprs_[i]), out->vars_));
+  }
+  out->copyFreeAuxVars(*this, out->vars_);
+  out->lbs_ = lbs_;
+  out->ubs_ = ubs_;
+  out->cnt_types_ = cnt_types_;
+  out->objective_ = toQuadExpr(CompactQuadExpr(objective_), out->vars_);
+  out->removed_ = removed_;
+  out->time_limit_ = time_limit_;
+  out->tolerance_hint_ = tolerance_hint_;
+  out->warm_primal_ = warm_primal_;
+  out->warm_dual_ = warm_dual_;
+  return out;
+}
+
+ModelSize AutoSolverModel::getSize() const
+{
+  if (inner_ != nullptr)
+    return inner_->getSize();
+  ModelSize size;
+  size.num_vars = vars_.size();
+  for (std::size_t i = 0; i < cnts_.size(); ++i)
+  {
+    if (cnts_[i].cnt_rep->removed)
+      continue;
+    ++size.num_cnts;
+    size.cnt_nonzeros += cnt_exprs_[i].size();
+  }
+  size.objective_nonzeros = objective_.size();
+  return size;
+}
+
+bool AutoSolverModel::exportQP(QPData& qp) const
+{
+  if (inner_ != nullptr)
+    return inner_->exportQP(qp);
+  recordedQP(qp);
+  return true;
+}
+}  // namespace sco
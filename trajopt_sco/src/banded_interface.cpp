@@ -0,0 +1,170 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cmath>
+#include <fstream>
+#include <limits>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/banded_interface.hpp>
+#include <trajopt_sco/compact_expr.hpp>
+#include <trajopt_sco/qp_capture.hpp>
+#include <trajopt_utils/logging.hpp>
+
+namespace sco
+{
+const double BANDED_QP_INFINITY = std::numeric_limits<double>::infinity();
+
+Model::Ptr createBandedQPModel()
+{
+  Model::Ptr out(new BandedQPModel());
+  return out;
+}
+
+Var BandedQPModel::addVar(const std::string& name)
+{
+  vars_.push_back(var_arena_.create(vars_.size(), name, this));
+  lbs_.push_back(-BANDED_QP_INFINITY);
+  ubs_.push_back(BANDED_QP_INFINITY);
+  return vars_.back();
+}
+
+Cnt BandedQPModel::addCnt(const AffExpr& expr, ConstraintType type)
+{
+  return addCntSlot(cnts_, cnt_exprs_, cnt_types_, expr, type);
+}
+
+Cnt BandedQPModel::addEqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, EQ); }
+
+Cnt BandedQPModel::addIneqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, INEQ); }
+
+Cnt BandedQPModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
+{
+  throw std::runtime_error("NOT IMPLEMENTED");
+}
+
+void BandedQPModel::removeVars(const VarVector& vars) { queueRemovals(vars); }
+
+void BandedQPModel::removeCnts(const CntVector& cnts) { queueRemovals(cnts); }
+
+void BandedQPModel::update()
+{
+  SizeTVec kept;
+  if (commitVarRemovals(vars_, kept))
+  {
+    keepEntries(lbs_, kept);
+    keepEntries(ubs_, kept);
+    keepEntries(result_.x, kept);
+  }
+  commitCntRemovals(cnt_exprs_, cnt_types_);
+}
+
+void BandedQPModel::setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper)
+{
+  for (std::size_t i = 0; i < vars.size(); ++i)
+  {
+    const std::size_t varind = vars[i].var_rep->index;
+    lbs_[varind] = lower[i];
+    ubs_[varind] = upper[i];
+  }
+}
+
+DblVec BandedQPModel::getVarValues(const VarVector& vars) const
+{
+  DblVec out(vars.size());
+  for (std::size_t i = 0; i < vars.size(); ++i)
+    out[i] = result_.x[vars[i].var_rep->index];
+  return out;
+}
+
+CvxOptStatus BandedQPModel::optimize()
+{
+  update();
+  if (needsCompaction())
+    compactCnts(cnts_, cnt_exprs_, cnt_types_);
+  num_solved_cnts_ = cnts_.size();
+  QPData qp;
+  toQPData(vars_, lbs_, ubs_, objective_, cnt_exprs_, cnt_types_, free_cnt_slots_, qp);
+  BandedQPSettings solve_settings = settings;
+  solve_settings.tolerance = std::fmax(settings.tolerance, tolerance_hint_);
+  return solveBandedQP(qp, result_, solve_settings);
+}
+
+void BandedQPModel::setObjective(const AffExpr& expr) { objective_ = QuadExpr(expr); }
+
+void BandedQPModel::setObjective(const QuadExpr& expr) { objective_ = expr; }
+
+void BandedQPModel::writeToFile(const std::string& fname) const
+{
+  std::ofstream outStream(fname);
+  outStream << "\\ Generated by trajopt_sco with backend BANDED\n";
+  outStream << "Minimize\n";
+  outStream << objective_;
+  outStream << "Subject To\n";
+  for (std::size_t i = 0; i < cnt_exprs_.size(); ++i)
+  {
+    std::string op = (cnt_types_[i] == INEQ) ? " <= " : " = ";
+    outStream << cnt_exprs_[i] << op << 0 << "\n";
+  }
+
+  outStream << "Bounds\n";
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+  {
+    outStream << lbs_[i] << " <= " << vars_[i] << " <= " << ubs_[i] << "\n";
+  }
+  outStream << "End";
+}
+
+VarVector BandedQPModel::getVars() const { return vars_; }
+
+ModelSize BandedQPModel::getSize() const
+{
+  ModelSize size;
+  size.num_vars = vars_.size();
+  size.num_cnts = cnts_.size() - free_cnt_slots_.size();
+  for (const AffExpr& expr : cnt_exprs_)
+    size.cnt_nonzeros += expr.size();
+  size.objective_nonzeros = objective_.size();
+  return size;
+}
+
+bool BandedQPModel::exportQP(QPData& qp) const
+{
+  toQPData(vars_, lbs_, ubs_, objective_, cnt_exprs_, cnt_types_, free_cnt_slots_, qp);
+  qp.dual_layout = ModelType::BANDED;
+  return true;
+}
+
+Model::Ptr BandedQPModel::clone() const
+{
+  auto out = std::make_shared<BandedQPModel>();
+  out->vars_.reserve(vars_.size());
+  for (const Var& var : vars_)
+  {
+    out->vars_.push_back(out->var_arena_.create(var.var_rep->index, var.var_rep->name, out.get()));
+    out->vars_.back().var_rep->removed = var.var_rep->removed;
+  }
+  out->cnts_.reserve(cnts_.size());
+  out->cnt_exprs_.reserve(cnts_.size());
+  for (std::size_t i = 0; i < cnts_.size(); ++i)
+  {
+    out->cnts_.push_back(out->cnt_arena_.create(i, out.get()));
+    out->cnts_.back().cnt_rep->removed = cnts_[i].cnt_rep->removed;
+    out->cnt_exprs_.push_back(toAffExpr(CompactAffExpr(cnt_exprs_[i]), out->vars_));
+  }
+  for (const Var& var : removed_vars_)
+    out->removed_vars_.push_back(out->vars_[var.var_rep->index]);
+  for (const Cnt& cnt : removed_cnts_)
+    out->removed_cnts_.push_back(out->cnts_[cnt.cnt_rep->index]);
+  out->copyFreeAuxVars(*this, out->vars_);
+
+  out->cnt_types_ = cnt_types_;
+  out->lbs_ = lbs_;
+  out->ubs_ = ubs_;
+  out->free_cnt_slots_ = free_cnt_slots_;
+  out->objective_ = toQuadExpr(CompactQuadExpr(objective_), out->vars_);
+  out->settings = settings;
+  out->tolerance_hint_ = tolerance_hint_;
+  out->result_ = result_;
+  return out;
+}
+}  // namespace sco
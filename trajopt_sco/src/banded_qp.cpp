@@ -0,0 +1,602 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/banded_qp.hpp>
+#include <trajopt_sco/qp_capture.hpp>
+#include <trajopt_utils/logging.hpp>
+
+namespace sco
+{
+void BandedLDLT::reset(std::size_t n, std::size_t bandwidth)
+{
+  n_ = n;
+  bandwidth_ = bandwidth;
+  band_.assign(n * (bandwidth + 1), 0);
+  d_.assign(n, 0);
+}
+
+void BandedLDLT::add(std::size_t i, std::size_t j, double v)
+{
+  if (i < j)
+    std::swap(i, j);
+  assert(i - j <= bandwidth_);
+  at(i, j) += v;
+}
+
+std::size_t BandedLDLT::factorize(const std::vector<bool>& positive, double min_pivot)
+{
+  std::size_t n_replaced = 0;
+  DblVec ld(bandwidth_);  // L(i, k) * d(k) of the current row
+  for (std::size_t i = 0; i < n_; ++i)
+  {
+    const std::size_t first = (i > bandwidth_) ? i - bandwidth_ : 0;
+    for (std::size_t j = first; j < i; ++j)
+    {
+      // Columns of row j start at j - bandwidth_, which is no later than first
+      double v = at(i, j);
+      for (std::size_t k = first; k < j; ++k)
+        v -= ld[k - first] * at(j, k);
+      at(i, j) = v / d_[j];
+      ld[j - first] = v;
+    }
+    double pivot = at(i, i);
+    for (std::size_t k = first; k < i; ++k)
+      pivot -= ld[k - first] * at(i, k);
+
+    if (positive[i] ? pivot < min_pivot : pivot > -min_pivot)
+    {
+      pivot = positive[i] ? min_pivot : -min_pivot;
+      ++n_replaced;
+    }
+    d_[i] = pivot;
+    at(i, i) = 1;
+  }
+  return n_replaced;
+}
+
+void BandedLDLT::solve(DblVec& x) const
+{
+  for (std::size_t i = 0; i < n_; ++i)
+  {
+    const std::size_t first = (i > bandwidth_) ? i - bandwidth_ : 0;
+    for (std::size_t k = first; k < i; ++k)
+      x[i] -= at(i, k) * x[k];
+  }
+  for (std::size_t i = 0; i < n_; ++i)
+    x[i] /= d_[i];
+  for (std::size_t i = n_; i-- > 0;)
+  {
+    const std::size_t first = (i > bandwidth_) ? i - bandwidth_ : 0;
+    for (std::size_t k = first; k < i; ++k)
+      x[k] -= at(i, k) * x[i];
+  }
+}
+
+namespace
+{
+/** Bounds beyond this are infinite */
+const double BANDED_INF = 1e20;
+
+struct SparseRow
+{
+  SizeTVec cols;
+  DblVec vals;
+};
+
+double dot(const SparseRow& row, const DblVec& x)
+{
+  double out = 0;
+  for (std::size_t k = 0; k < row.cols.size(); ++k)
+    out += row.vals[k] * x[row.cols[k]];
+  return out;
+}
+
+/** y += a * row' */
+void axpy(const SparseRow& row, double a, DblVec& y)
+{
+  for (std::size_t k = 0; k < row.cols.size(); ++k)
+    y[row.cols[k]] += a * row.vals[k];
+}
+
+double infNorm(const DblVec& v)
+{
+  double out = 0;
+  for (double x : v)
+    out = std::max(out, std::abs(x));
+  return out;
+}
+
+/** The QP as min 1/2 x'Px + q'x s.t. Ax = b, Gx <= h, with the variable bounds as rows of A and G */
+struct IPMProblem
+{
+  std::size_t n{ 0 };
+  SizeTVec P_rows, P_cols; /**< upper triangle */
+  DblVec P_vals;
+  DblVec q;
+  std::vector<SparseRow> A;
+  DblVec b;
+  std::vector<SparseRow> G;
+  DblVec h;
+
+  explicit IPMProblem(const QPData& qp) : n(qp.numVars()), P_vals(qp.P_vals), q(qp.q)
+  {
+    P_rows.assign(qp.P_rows.begin(), qp.P_rows.end());
+    P_cols.assign(qp.P_cols.begin(), qp.P_cols.end());
+
+    std::vector<SparseRow> rows(qp.numCnts());
+    for (std::size_t k = 0; k < qp.A_vals.size(); ++k)
+    {
+      SparseRow& row = rows[static_cast<std::size_t>(qp.A_rows[k])];
+      row.cols.push_back(static_cast<std::size_t>(qp.A_cols[k]));
+      row.vals.push_back(qp.A_vals[k]);
+    }
+    std::vector<bool> used(n, false);
+    for (std::size_t i = 0; i < rows.size(); ++i)
+    {
+      addRow(rows[i], qp.l[i], qp.u[i]);
+      for (std::size_t col : rows[i].cols)
+        used[col] = true;
+    }
+    for (std::size_t k = 0; k < P_vals.size(); ++k)
+      used[P_rows[k]] = used[P_cols[k]] = true;
+
+    // Fixed variables become equalities, an interior point can not lie between equal bounds
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      double lower = qp.lb[i];
+      double upper = qp.ub[i];
+      // A variable that only has a linear cost goes to the bound the cost points to, as BPMPD's presolve does,
+      // instead of the middle of its bounds
+      if (!used[i])
+      {
+        const double bound = (q[i] < 0 || (q[i] == 0 && lower <= -BANDED_INF)) ? upper : lower;
+        if (std::abs(bound) < BANDED_INF)
+          lower = upper = bound;
+      }
+      addRow(SparseRow{ { i }, { 1 } }, lower, upper);
+    }
+  }
+
+  void addRow(const SparseRow& row, double lower, double upper)
+  {
+    if (lower == upper)
+    {
+      A.push_back(row);
+      b.push_back(upper);
+      return;
+    }
+    if (upper < BANDED_INF)
+    {
+      G.push_back(row);
+      h.push_back(upper);
+    }
+    if (lower > -BANDED_INF)
+    {
+      G.push_back(row);
+      for (double& v : G.back().vals)
+        v = -v;
+      h.push_back(-lower);
+    }
+  }
+
+  /** y = Px */
+  void multiplyP(const DblVec& x, DblVec& y) const
+  {
+    y.assign(n, 0);
+    for (std::size_t k = 0; k < P_vals.size(); ++k)
+    {
+      y[P_rows[k]] += P_vals[k] * x[P_cols[k]];
+      if (P_rows[k] != P_cols[k])
+        y[P_cols[k]] += P_vals[k] * x[P_rows[k]];
+    }
+  }
+};
+
+/** The KKT nodes are the variables followed by the equality rows. Returns the bandwidth for the positions pos. */
+std::size_t kktBandwidth(const IPMProblem& p, const SizeTVec& pos)
+{
+  auto distance = [](std::size_t i, std::size_t j) { return (i > j) ? i - j : j - i; };
+  std::size_t bandwidth = 0;
+  for (std::size_t k = 0; k < p.P_vals.size(); ++k)
+    bandwidth = std::max(bandwidth, distance(pos[p.P_rows[k]], pos[p.P_cols[k]]));
+  for (std::size_t e = 0; e < p.A.size(); ++e)
+    for (std::size_t col : p.A[e].cols)
+      bandwidth = std::max(bandwidth, distance(pos[p.n + e], pos[col]));
+  for (const SparseRow& row : p.G)
+  {
+    if (row.cols.empty())
+      continue;
+    auto range = std::minmax_element(
+        row.cols.begin(), row.cols.end(), [&](std::size_t i, std::size_t j) { return pos[i] < pos[j]; });
+    bandwidth = std::max(bandwidth, pos[*range.second] - pos[*range.first]);
+  }
+  return bandwidth;
+}
+
+/** The variables in the order they were created, each equality row after the last variable it constrains */
+SizeTVec naturalOrder(const IPMProblem& p)
+{
+  std::vector<std::pair<std::size_t, std::size_t>> keys;  // (sort key, node)
+  for (std::size_t i = 0; i < p.n; ++i)
+    keys.emplace_back(2 * i, i);
+  for (std::size_t e = 0; e < p.A.size(); ++e)
+  {
+    const SizeTVec& cols = p.A[e].cols;
+    const std::size_t last = cols.empty() ? 0 : *std::max_element(cols.begin(), cols.end());
+    keys.emplace_back(2 * last + 1, p.n + e);
+  }
+  std::stable_sort(keys.begin(), keys.end(), [](const std::pair<std::size_t, std::size_t>& a,
+                                                const std::pair<std::size_t, std::size_t>& b) {
+    return a.first < b.first;
+  });
+
+  SizeTVec pos(keys.size());
+  for (std::size_t k = 0; k < keys.size(); ++k)
+    pos[keys[k].second] = k;
+  return pos;
+}
+
+/** Reverse Cuthill-McKee order of the KKT nodes. Inequality rows are chained through their variables. */
+SizeTVec rcmOrder(const IPMProblem& p)
+{
+  const std::size_t n_nodes = p.n + p.A.size();
+  std::vector<SizeTVec> adjacent(n_nodes);
+  auto connect = [&](std::size_t i, std::size_t j) {
+    if (i == j)
+      return;
+    adjacent[i].push_back(j);
+    adjacent[j].push_back(i);
+  };
+  for (std::size_t k = 0; k < p.P_vals.size(); ++k)
+    connect(p.P_rows[k], p.P_cols[k]);
+  for (std::size_t e = 0; e < p.A.size(); ++e)
+    for (std::size_t col : p.A[e].cols)
+      connect(p.n + e, col);
+  for (const SparseRow& row : p.G)
+  {
+    SizeTVec cols = row.cols;
+    std::sort(cols.begin(), cols.end());
+    for (std::size_t k = 1; k < cols.size(); ++k)
+      connect(cols[k - 1], cols[k]);
+  }
+  for (SizeTVec& nodes : adjacent)
+  {
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+  }
+  auto byDegree = [&](std::size_t i, std::size_t j) { return adjacent[i].size() < adjacent[j].size(); };
+  for (SizeTVec& nodes : adjacent)
+    std::stable_sort(nodes.begin(), nodes.end(), byDegree);
+
+  SizeTVec by_degree(n_nodes);
+  std::iota(by_degree.begin(), by_degree.end(), 0);
+  std::stable_sort(by_degree.begin(), by_degree.end(), byDegree);
+
+  // Breadth first search from start, appending the nodes to order. Returns a node of the last level.
+  std::vector<bool> visited(n_nodes, false);
+  auto search = [&](std::size_t start, std::vector<bool>& seen, SizeTVec& order) {
+    const std::size_t begin = order.size();
+    order.push_back(start);
+    seen[start] = true;
+    for (std::size_t k = begin; k < order.size(); ++k)
+      for (std::size_t next : adjacent[order[k]])
+        if (!seen[next])
+        {
+          seen[next] = true;
+          order.push_back(next);
+        }
+    return order.back();
+  };
+
+  SizeTVec order;
+  order.reserve(n_nodes);
+  for (std::size_t start : by_degree)
+  {
+    if (visited[start])
+      continue;
+    // Start from the far end of the component, so the levels become the time steps of a trajectory
+    std::vector<bool> probe_seen = visited;
+    SizeTVec probe;
+    start = search(start, probe_seen, probe);
+    search(start, visited, order);
+  }
+
+  SizeTVec pos(n_nodes);
+  for (std::size_t k = 0; k < n_nodes; ++k)
+    pos[order[n_nodes - 1 - k]] = k;
+  return pos;
+}
+
+/**
+ * The Newton system of an interior point iteration with the inequality multipliers and slacks eliminated,
+ * ```
+ * [P + G'WG  A'] [dx]   [rx]
+ * [A         0 ] [dy] = [ry]
+ * ```
+ * factorized with a regularization that iterative refinement removes again.
+ */
+class KKTSystem
+{
+public:
+  KKTSystem(const IPMProblem& p, const SizeTVec& pos, std::size_t bandwidth, const BandedQPSettings& settings)
+    : p_(p), pos_(pos), bandwidth_(bandwidth), settings_(settings), positive_(pos.size(), false)
+  {
+    for (std::size_t i = 0; i < p.n; ++i)
+      positive_[pos[i]] = true;
+  }
+
+  void factorize(const DblVec& w)
+  {
+    w_ = w;
+    const double reg = settings_.regularization;
+    ldlt_.reset(pos_.size(), bandwidth_);
+    for (std::size_t k = 0; k < p_.P_vals.size(); ++k)
+      ldlt_.add(pos_[p_.P_rows[k]], pos_[p_.P_cols[k]], p_.P_vals[k]);
+    for (std::size_t i = 0; i < p_.n; ++i)
+      ldlt_.add(pos_[i], pos_[i], reg);
+    for (std::size_t e = 0; e < p_.A.size(); ++e)
+    {
+      const SparseRow& row = p_.A[e];
+      for (std::size_t k = 0; k < row.cols.size(); ++k)
+        ldlt_.add(pos_[p_.n + e], pos_[row.cols[k]], row.vals[k]);
+      ldlt_.add(pos_[p_.n + e], pos_[p_.n + e], -reg);
+    }
+    for (std::size_t r = 0; r < p_.G.size(); ++r)
+    {
+      const SparseRow& row = p_.G[r];
+      for (std::size_t a = 0; a < row.cols.size(); ++a)
+      {
+        const std::size_t pa = pos_[row.cols[a]];
+        ldlt_.add(pa, pa, w[r] * row.vals[a] * row.vals[a]);
+        for (std::size_t c = a + 1; c < row.cols.size(); ++c)
+        {
+          const std::size_t pc = pos_[row.cols[c]];
+          // A repeated column is one entry of both triangles
+          ldlt_.add(pa, pc, ((pa == pc) ? 2 : 1) * w[r] * row.vals[a] * row.vals[c]);
+        }
+      }
+    }
+    ldlt_.factorize(positive_, reg);
+  }
+
+  void solve(const DblVec& rx, const DblVec& ry, DblVec& dx, DblVec& dy) const
+  {
+    dx.assign(p_.n, 0);
+    dy.assign(p_.A.size(), 0);
+    DblVec ex = rx, ey = ry;
+    for (int step = 0; step <= settings_.refinement_steps; ++step)
+    {
+      DblVec v(pos_.size());
+      for (std::size_t i = 0; i < p_.n; ++i)
+        v[pos_[i]] = ex[i];
+      for (std::size_t e = 0; e < p_.A.size(); ++e)
+        v[pos_[p_.n + e]] = ey[e];
+      ldlt_.solve(v);
+      for (std::size_t i = 0; i < p_.n; ++i)
+        dx[i] += v[pos_[i]];
+      for (std::size_t e = 0; e < p_.A.size(); ++e)
+        dy[e] += v[pos_[p_.n + e]];
+
+      if (step == settings_.refinement_steps)
+        break;
+      // Residual of the unregularized system
+      multiply(dx, dy, ex, ey);
+      for (std::size_t i = 0; i < p_.n; ++i)
+        ex[i] = rx[i] - ex[i];
+      for (std::size_t e = 0; e < p_.A.size(); ++e)
+        ey[e] = ry[e] - ey[e];
+    }
+  }
+
+private:
+  const IPMProblem& p_;
+  const SizeTVec& pos_;
+  std::size_t bandwidth_;
+  const BandedQPSettings& settings_;
+  std::vector<bool> positive_;
+  DblVec w_;
+  BandedLDLT ldlt_;
+
+  void multiply(const DblVec& x, const DblVec& y, DblVec& out_x, DblVec& out_y) const
+  {
+    p_.multiplyP(x, out_x);
+    for (std::size_t r = 0; r < p_.G.size(); ++r)
+      axpy(p_.G[r], w_[r] * dot(p_.G[r], x), out_x);
+    out_y.resize(p_.A.size());
+    for (std::size_t e = 0; e < p_.A.size(); ++e)
+    {
+      axpy(p_.A[e], y[e], out_x);
+      out_y[e] = dot(p_.A[e], x);
+    }
+  }
+};
+
+/** The largest step that keeps v + alpha * dv nonnegative */
+double maxStep(const DblVec& v, const DblVec& dv)
+{
+  double alpha = std::numeric_limits<double>::infinity();
+  for (std::size_t i = 0; i < v.size(); ++i)
+    if (dv[i] < 0)
+      alpha = std::min(alpha, -v[i] / dv[i]);
+  return alpha;
+}
+}  // namespace
+
+CvxOptStatus solveBandedQP(const QPData& qp, BandedQPResult& result, const BandedQPSettings& settings)
+{
+  const IPMProblem p(qp);
+  const std::size_t n = p.n;
+  const std::size_t me = p.A.size();
+  const std::size_t mi = p.G.size();
+
+  // Keep the order of the variables if it is banded, as for the time steps of a trajectory
+  SizeTVec pos = naturalOrder(p);
+  std::size_t bandwidth = kktBandwidth(p, pos);
+  if (bandwidth > 0)
+  {
+    SizeTVec rcm_pos = rcmOrder(p);
+    const std::size_t rcm_bandwidth = kktBandwidth(p, rcm_pos);
+    if (rcm_bandwidth < bandwidth)
+    {
+      pos = std::move(rcm_pos);
+      bandwidth = rcm_bandwidth;
+    }
+  }
+  result.kkt_size = n + me;
+  result.bandwidth = bandwidth;
+  result.iterations = 0;
+  LOG_DEBUG("banded QP with %zu variables, %zu equalities and %zu inequalities has bandwidth %zu",
+            n,
+            me,
+            mi,
+            bandwidth);
+
+  KKTSystem kkt(p, pos, bandwidth, settings);
+  const double scale_p = 1 + std::max(infNorm(p.b), infNorm(p.h));
+  const double scale_d = 1 + infNorm(p.q);
+
+  // Start from the least squares solution with unit weights, shifted into the interior
+  DblVec x, y, s(mi), z(mi);
+  {
+    DblVec rx(n);
+    for (std::size_t i = 0; i < n; ++i)
+      rx[i] = -p.q[i];
+    for (std::size_t r = 0; r < mi; ++r)
+      axpy(p.G[r], p.h[r], rx);
+    kkt.factorize(DblVec(mi, 1));
+    kkt.solve(rx, p.b, x, y);
+    for (std::size_t r = 0; r < mi; ++r)
+    {
+      s[r] = p.h[r] - dot(p.G[r], x);
+      z[r] = -s[r];
+    }
+    for (DblVec* v : { &s, &z })
+    {
+      const double shift = mi > 0 ? -*std::min_element(v->begin(), v->end()) : -1;
+      if (shift >= 0)
+        for (double& vi : *v)
+          vi += 1 + shift;
+    }
+  }
+
+  DblVec rd, rpe(me), rpi(mi), w(mi), rc(mi), t(mi), dx, dy, ds(mi), dz(mi), rx, ry(me);
+  auto newton = [&]() {
+    rx.assign(n, 0);
+    for (std::size_t i = 0; i < n; ++i)
+      rx[i] = -rd[i];
+    for (std::size_t r = 0; r < mi; ++r)
+      axpy(p.G[r], -(z[r] * rpi[r] - rc[r]) / s[r], rx);
+    for (std::size_t e = 0; e < me; ++e)
+      ry[e] = -rpe[e];
+    kkt.solve(rx, ry, dx, dy);
+    for (std::size_t r = 0; r < mi; ++r)
+    {
+      ds[r] = -rpi[r] - dot(p.G[r], dx);
+      dz[r] = -(rc[r] + z[r] * ds[r]) / s[r];
+    }
+  };
+
+  // A Farkas certificate of primal infeasibility is a y and a z >= 0 with A^T y + G^T z = 0 and b^T y + h^T z < 0.
+  // The multipliers of an infeasible QP diverge along one, so they are tested scaled to unit norm.
+  DblVec ray;
+  auto certifiesInfeasibility = [&]() {
+    const double norm = std::max(infNorm(y), infNorm(z));
+    if (!(norm > 0) || !std::isfinite(norm))
+      return false;
+    ray.assign(n, 0);
+    double gap = 0;
+    for (std::size_t e = 0; e < me; ++e)
+    {
+      axpy(p.A[e], y[e] / norm, ray);
+      gap += p.b[e] * y[e] / norm;
+    }
+    for (std::size_t r = 0; r < mi; ++r)
+    {
+      axpy(p.G[r], z[r] / norm, ray);
+      gap += p.h[r] * z[r] / norm;
+    }
+    return gap < -settings.tolerance && infNorm(ray) <= settings.tolerance;
+  };
+
+  for (int iteration = 0; iteration < settings.max_iterations; ++iteration)
+  {
+    result.iterations = iteration;
+    p.multiplyP(x, rd);
+    for (std::size_t i = 0; i < n; ++i)
+      rd[i] += p.q[i];
+    for (std::size_t e = 0; e < me; ++e)
+    {
+      axpy(p.A[e], y[e], rd);
+      rpe[e] = dot(p.A[e], x) - p.b[e];
+    }
+    double mu = 0;
+    for (std::size_t r = 0; r < mi; ++r)
+    {
+      axpy(p.G[r], z[r], rd);
+      rpi[r] = dot(p.G[r], x) + s[r] - p.h[r];
+      mu += s[r] * z[r];
+    }
+    mu = mi > 0 ? mu / static_cast<double>(mi) : 0;
+
+    const double res_p = std::max(infNorm(rpe), infNorm(rpi));
+    const double res_d = infNorm(rd);
+    if (res_p <= settings.tolerance * scale_p && res_d <= settings.tolerance * scale_d && mu <= settings.tolerance)
+    {
+      result.x = x;
+      return CVX_SOLVED;
+    }
+    if (res_p > settings.tolerance * scale_p && certifiesInfeasibility())
+    {
+      result.x = x;
+      return CVX_INFEASIBLE;
+    }
+
+    for (std::size_t r = 0; r < mi; ++r)
+      w[r] = z[r] / s[r];
+    kkt.factorize(w);
+
+    // Predictor
+    for (std::size_t r = 0; r < mi; ++r)
+      rc[r] = s[r] * z[r];
+    newton();
+    const double alpha_aff = std::min({ 1.0, maxStep(s, ds), maxStep(z, dz) });
+
+    // Corrector, centered by how much the predictor reduces the duality gap
+    if (mi > 0)
+    {
+      double mu_aff = 0;
+      for (std::size_t r = 0; r < mi; ++r)
+        mu_aff += (s[r] + alpha_aff * ds[r]) * (z[r] + alpha_aff * dz[r]);
+      mu_aff /= static_cast<double>(mi);
+      const double sigma = std::pow(mu_aff / mu, 3);
+      for (std::size_t r = 0; r < mi; ++r)
+        rc[r] = s[r] * z[r] + ds[r] * dz[r] - sigma * mu;
+      newton();
+    }
+
+    const double alpha = std::min(1.0, 0.99 * std::min(maxStep(s, ds), maxStep(z, dz)));
+    if (!std::isfinite(alpha) || std::any_of(dx.begin(), dx.end(), [](double v) { return !std::isfinite(v); }))
+      break;
+    for (std::size_t i = 0; i < n; ++i)
+      x[i] += alpha * dx[i];
+    for (std::size_t e = 0; e < me; ++e)
+      y[e] += alpha * dy[e];
+    for (std::size_t r = 0; r < mi; ++r)
+    {
+      s[r] += alpha * ds[r];
+      z[r] += alpha * dz[r];
+    }
+  }
+
+  // Running out of iterations proves nothing, a feasible QP may just converge slowly
+  result.x = x;
+  return certifiesInfeasibility() ? CVX_INFEASIBLE : CVX_FAILED;
+}
+}  // namespace sco
@@ -0,0 +1,82 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <map>
+#include <string>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/batch_optimizer.hpp>
+
+namespace sco
+{
+BatchOptimizer::BatchOptimizer(int num_threads) : pool_(static_cast<std::size_t>(std::max(num_threads, 1))) {}
+
+std::size_t BatchOptimizer::addProblem(OptProb::Ptr prob,
+                                       DblVec x,
+                                       const BasicTrustRegionSQPParameters& param,
+                                       util::LogLevel log_level)
+{
+  if (!prob)
+    PRINT_AND_THROW("need a problem to add to the batch");
+  problems_.push_back({ std::move(prob), std::move(x), param, log_level });
+  return problems_.size() - 1;
+}
+
+std::vector<BatchOptResults> BatchOptimizer::optimize()
+{
+  using Clock = std::chrono::steady_clock;
+  std::vector<BatchOptResults> out(problems_.size());
+  const Clock::time_point batch_start = Clock::now();
+
+  // Problems that would capture their QPs or log their iterations to the same file are given one each
+  auto logPath = [](const Problem& problem) {
+    if (!problem.param.log_results && problem.log_level < util::LevelDebug)
+      return std::string();
+    return problem.param.log_dir + "/" + problem.param.log_file;
+  };
+  std::map<std::string, std::size_t> capture_files;
+  std::map<std::string, std::size_t> log_files;
+  for (const Problem& problem : problems_)
+  {
+    if (!problem.param.qp_capture_file.empty())
+      ++capture_files[problem.param.qp_capture_file];
+    const std::string log_path = logPath(problem);
+    if (!log_path.empty())
+      ++log_files[log_path];
+  }
+
+  pool_.parallelFor(problems_.size(), [&](std::size_t i) {
+    const Problem& problem = problems_[i];
+    BatchOptResults& result = out[i];
+    util::ScopedLogLevel log_level(problem.log_level);
+    BasicTrustRegionSQPParameters param = problem.param;
+    if (!param.qp_capture_file.empty() && capture_files.at(param.qp_capture_file) > 1)
+      param.qp_capture_file += "." + std::to_string(i);
+    const std::string log_path = logPath(problem);
+    if (!log_path.empty() && log_files.at(log_path) > 1)
+      param.log_file += "." + std::to_string(i);
+
+    const Clock::time_point start = Clock::now();
+    result.wait_time = std::chrono::duration<double>(start - batch_start).count();
+    try
+    {
+      BasicTrustRegionSQP opt(problem.prob);
+      opt.setParameters(param);
+      opt.initialize(problem.x);
+      opt.optimize();
+      result.results = opt.results();
+    }
+    catch (const std::exception& e)
+    {
+      LOG_ERROR("optimization of batch problem %zu failed: %s", i, e.what());
+      result.results.status = OPT_FAILED;
+      result.error = e.what();
+    }
+    result.solve_time = std::chrono::duration<double>(Clock::now() - start).count();
+  });
+
+  return out;
+}
+}  // namespace sco
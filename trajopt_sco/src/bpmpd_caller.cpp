@@ -1,14 +1,15 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <cerrno>
+#include <cstdint>
 #include <iostream>
 #include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <trajopt_sco/bpmpd_io.hpp>
 TRAJOPT_IGNORE_WARNINGS_POP
 
-#include <trajopt_utils/stl_to_string.hpp>
-
 extern "C" {
 extern void bpmpd(int*,
                   int*,
@@ -34,8 +35,15 @@ extern void bpmpd(int*,
                   int*);
 }
 
-int main(int /*argc*/, char** /*argv*/)
+/** A worker of BPMPDModel, see bpmpd_io.hpp for the protocol */
+int main(int argc, char** argv)
 {
+  if (argc != 2)
+  {
+    std::cerr << "usage: " << argv[0] << " <shared memory segment>" << std::endl;
+    return 2;
+  }
+
   std::string working_dir = BPMPD_WORKING_DIR;
   int err = chdir(working_dir.c_str());
   if (err != 0)
@@ -44,59 +52,66 @@ int main(int /*argc*/, char** /*argv*/)
     std::cerr << strerror(err) << std::endl;
     abort();
   }
-  // int counter=0;
+
+  const int shm_fd = shm_open(argv[1], O_RDWR, 0);
+  if (shm_fd < 0)
+  {
+    std::cerr << "error opening shared memory segment " << argv[1] << ": " << strerror(errno) << std::endl;
+    return 1;
+  }
+  if (!bpmpd_io::sendAll(STDOUT_FILENO, &bpmpd_io::READY_CHAR, 1))
+    return 1;
+
+  void* data = nullptr;
+  std::uint64_t mapped_size = 0;
   while (true)
   {
-    bpmpd_io::bpmpd_input bi;
-    bpmpd_io::ser(STDIN_FILENO, bi, bpmpd_io::DESER);
+    std::uint64_t size = bpmpd_io::EXIT_REQUEST;
+    if (!bpmpd_io::recvAll(STDIN_FILENO, &size, sizeof(size)) || size == bpmpd_io::EXIT_REQUEST)
+      return 0;
+
+    // The segment grows with the problems
+    if (size != mapped_size)
+    {
+      if (data != nullptr)
+        munmap(data, mapped_size);
+      data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+      if (data == MAP_FAILED)
+      {
+        std::cerr << "error mapping shared memory segment: " << strerror(errno) << std::endl;
+        abort();
+      }
+      mapped_size = size;
+    }
 
+    bpmpd_io::Segment segment(data);
+    bpmpd_io::SegmentHeader& header = *segment.header;
     int memsiz = 0;
     double BIG = 1e30;
-    bpmpd_io::bpmpd_output bo;
-    bo.primal.resize(static_cast<unsigned long>(bi.m) + static_cast<unsigned long>(bi.n));
-    bo.dual.resize(static_cast<unsigned long>(bi.m) + static_cast<unsigned long>(bi.n));
-    bo.status.resize(static_cast<unsigned long>(bi.m) + static_cast<unsigned long>(bi.n));
-
-#define DBG(expr)  // cerr << #expr << ": " << CSTR(expr) << std::endl
-    DBG(bi.m);
-    DBG(bi.n);
-    DBG(bi.nz);
-    DBG(bi.qn);
-    DBG(bi.qnz);
-    DBG(bi.acolcnt);
-    DBG(bi.acolidx);
-    DBG(bi.acolnzs);
-    DBG(bi.qcolcnt);
-    DBG(bi.qcolidx);
-    DBG(bi.qcolnzs);
-    DBG(bi.rhs);
-    DBG(bi.obj);
-    DBG(bi.lbound);
-    DBG(bi.ubound);
-
-    bpmpd(&bi.m,
-          &bi.n,
-          &bi.nz,
-          &bi.qn,
-          &bi.qnz,
-          bi.acolcnt.data(),
-          bi.acolidx.data(),
-          bi.acolnzs.data(),
-          bi.qcolcnt.data(),
-          bi.qcolidx.data(),
-          bi.qcolnzs.data(),
-          bi.rhs.data(),
-          bi.obj.data(),
-          bi.lbound.data(),
-          bi.ubound.data(),
-          bo.primal.data(),
-          bo.dual.data(),
-          bo.status.data(),
+    bpmpd(&header.m,
+          &header.n,
+          &header.nz,
+          &header.qn,
+          &header.qnz,
+          segment.acolcnt,
+          segment.acolidx,
+          segment.acolnzs,
+          segment.qcolcnt,
+          segment.qcolidx,
+          segment.qcolnzs,
+          segment.rhs,
+          segment.obj,
+          segment.lbound,
+          segment.ubound,
+          segment.primal,
+          segment.dual,
+          segment.status,
           &BIG,
-          &bo.code,
-          &bo.opt,
+          &header.code,
+          &header.opt,
           &memsiz);
 
-    bpmpd_io::ser(STDOUT_FILENO, bo, bpmpd_io::SER);
+    if (!bpmpd_io::sendAll(STDOUT_FILENO, &bpmpd_io::DONE_CHAR, 1))
+      return 0;
   }
 }
@@ -1,12 +1,26 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <atomic>
+#include <boost/format.hpp>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <csignal>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <trajopt_sco/bpmpd_io.hpp>
 TRAJOPT_IGNORE_WARNINGS_POP
 
 #include <trajopt_sco/bpmpd_interface.hpp>
+#include <trajopt_sco/compact_expr.hpp>
+#include <trajopt_sco/qp_capture.hpp>
 #include <trajopt_utils/logging.hpp>
 #include <trajopt_utils/stl_to_string.hpp>
 
@@ -158,165 +172,245 @@ Model::Ptr createBPMPDModel()
   return out;
 }
 
-#define READ 0
-#define WRITE 1
-
-pid_t popen2(const char* command, int* infp, int* outfp)
+/**
+ * A bpmpd_caller process and the shared memory segment it solves in, see bpmpd_io.hpp for the protocol. A worker whose
+ * process died can not be used any more, it is replaced by a new one.
+ */
+class BPMPDWorker
 {
-  int p_stdin[2], p_stdout[2];
-  pid_t pid;
+public:
+  BPMPDWorker() = default;
+  ~BPMPDWorker()
+  {
+    if (pid_ > 0)
+    {
+      if (bpmpd_io::sendAll(socket_, &bpmpd_io::EXIT_REQUEST, sizeof(bpmpd_io::EXIT_REQUEST)))
+        waitpid(pid_, nullptr, 0);
+      else
+        reap();
+    }
+    if (socket_ >= 0)
+      close(socket_);
+    if (data_ != nullptr)
+      munmap(data_, capacity_);
+    if (shm_fd_ >= 0)
+      close(shm_fd_);
+  }
+  BPMPDWorker(const BPMPDWorker&) = delete;
+  BPMPDWorker& operator=(const BPMPDWorker&) = delete;
+  BPMPDWorker(BPMPDWorker&&) = delete;
+  BPMPDWorker& operator=(BPMPDWorker&&) = delete;
 
-  if (pipe(p_stdin) != 0 || pipe(p_stdout) != 0)
-    return -1;
+  /** Create the segment and start the process. False if either fails. */
+  bool start()
+  {
+    static std::atomic<unsigned> counter{ 0 };
+    const std::string name = "/trajopt_bpmpd_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+    shm_fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (shm_fd_ < 0)
+    {
+      LOG_ERROR("failed to create BPMPD shared memory %s: %s", name.c_str(), std::strerror(errno));
+      return false;
+    }
 
-  pid = fork();
+    // The socket must not leak into the workers started by other threads, which would keep it open
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+    {
+      shm_unlink(name.c_str());
+      return false;
+    }
 
-  if (pid < 0)
+    pid_ = fork();
+    if (pid_ == 0)
+    {
+      // dup2 clears close-on-exec. Move the socket out of the way of the standard descriptors first.
+      const int end = (fds[1] > STDOUT_FILENO) ? fds[1] : fcntl(fds[1], F_DUPFD, STDERR_FILENO + 1);
+      dup2(end, STDIN_FILENO);
+      dup2(end, STDOUT_FILENO);
+      execl(BPMPD_CALLER, BPMPD_CALLER, name.c_str(), nullptr);
+      perror("execl");
+      _exit(1);
+    }
+    close(fds[1]);
+    socket_ = fds[0];
+
+    // The worker has opened the segment once it is ready, so its name is not needed any more
+    char ready = 0;
+    const bool started = (pid_ > 0) && bpmpd_io::recvAll(socket_, &ready, 1) && ready == bpmpd_io::READY_CHAR;
+    shm_unlink(name.c_str());
+    if (!started)
+    {
+      LOG_ERROR("failed to start BPMPD worker %s", BPMPD_CALLER);
+      reap();
+    }
+    return started;
+  }
+
+  /** Fit the segment to a problem of the given size and write the size to its header */
+  bpmpd_io::Segment segment(int m, int n, int nz, int qn, int qnz)
   {
-    assert(0);
-    return pid;
+    const std::size_t size = bpmpd_io::Segment::size(static_cast<std::size_t>(m),
+                                                     static_cast<std::size_t>(n),
+                                                     static_cast<std::size_t>(nz),
+                                                     static_cast<std::size_t>(qnz));
+    if (size > capacity_)
+    {
+      // Grow geometrically so a growing problem does not remap on every solve
+      const std::size_t capacity = std::max(size, 2 * capacity_);
+      if (data_ != nullptr)
+        munmap(data_, capacity_);
+      data_ = nullptr;
+      capacity_ = 0;
+      if (ftruncate(shm_fd_, static_cast<off_t>(capacity)) != 0)
+        PRINT_AND_THROW(boost::format("failed to resize BPMPD shared memory: %s") % std::strerror(errno));
+      void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd_, 0);
+      if (data == MAP_FAILED)
+        PRINT_AND_THROW(boost::format("failed to map BPMPD shared memory: %s") % std::strerror(errno));
+      data_ = data;
+      capacity_ = capacity;
+    }
+
+    auto* header = static_cast<bpmpd_io::SegmentHeader*>(data_);
+    header->m = m;
+    header->n = n;
+    header->nz = nz;
+    header->qn = qn;
+    header->qnz = qnz;
+    return bpmpd_io::Segment(data_);
   }
 
-  if (pid == 0)
+  /** Solve the problem in the segment. False if the process died, it is reaped then. */
+  bool solve()
   {
-    close(p_stdin[WRITE]);
-    dup2(p_stdin[READ], READ);
-    close(p_stdout[READ]);
-    dup2(p_stdout[WRITE], WRITE);
-
-    execl("/bin/sh", "sh", "-c", command, nullptr);
-    perror("execl");
-    exit(1);
+    const auto capacity = static_cast<std::uint64_t>(capacity_);
+    char done = 0;
+    if (bpmpd_io::sendAll(socket_, &capacity, sizeof(capacity)) && bpmpd_io::recvAll(socket_, &done, 1) &&
+        done == bpmpd_io::DONE_CHAR)
+      return true;
+    reap();
+    return false;
   }
 
-  if (infp == nullptr)
-    close(p_stdin[WRITE]);
-  else
-    *infp = p_stdin[WRITE];
+  /** True unless the process is known to have exited. Reaps it if it has. */
+  bool alive()
+  {
+    if (pid_ > 0 && waitpid(pid_, nullptr, WNOHANG) == pid_)
+      pid_ = -1;
+    return pid_ > 0;
+  }
 
-  if (outfp == nullptr)
-    close(p_stdout[READ]);
-  else
-    *outfp = p_stdout[READ];
+  pid_t pid() const { return pid_; }
 
-  return pid;
-}
+private:
+  pid_t pid_{ -1 };
+  int socket_{ -1 };
+  int shm_fd_{ -1 };
+  void* data_{ nullptr };
+  std::size_t capacity_{ 0 };
 
-static pid_t gPID = 0;
-static int gPipeIn = 0;
-static int gPipeOut = 0;
+  /** Make sure the process is gone and collect its exit status */
+  void reap()
+  {
+    if (pid_ <= 0)
+      return;
+    kill(pid_, SIGKILL);
+    int status = 0;
+    waitpid(pid_, &status, 0);
+    if (WIFSIGNALED(status) && WTERMSIG(status) != SIGKILL)
+      LOG_WARN("BPMPD worker %i was killed by signal %i", pid_, WTERMSIG(status));
+    pid_ = -1;
+  }
+};
 
-void fexit()
+/**
+ * The idle workers. A solve checks one out, so models can be solved from several threads at once, and returns it when
+ * done. Workers that died while idle are dropped at checkout.
+ */
+class BPMPDWorkerPool
 {
-  char text[1] = { bpmpd_io::EXIT_CHAR };
-  long n = write(gPipeIn, text, 1);
-  ALWAYS_ASSERT(n == 1);
-}
+public:
+  /** An idle worker, or a new one. nullptr if no worker can be started. */
+  std::unique_ptr<BPMPDWorker> checkout()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      while (!idle_.empty())
+      {
+        std::unique_ptr<BPMPDWorker> worker = std::move(idle_.back());
+        idle_.pop_back();
+        if (worker->alive())
+          return worker;
+        LOG_WARN("BPMPD worker died while idle, starting a new one");
+      }
+    }
+    auto worker = std::make_unique<BPMPDWorker>();
+    if (!worker->start())
+      return nullptr;
+    return worker;
+  }
 
-BPMPDModel::BPMPDModel()
-{
-  if (gPID == 0)
+  void checkin(std::unique_ptr<BPMPDWorker> worker)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(std::move(worker));
+  }
+
+  std::vector<int> idlePids()
   {
-    atexit(fexit);
-    gPID = popen2(BPMPD_CALLER, &gPipeIn, &gPipeOut);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<int> pids;
+    for (const std::unique_ptr<BPMPDWorker>& worker : idle_)
+      pids.push_back(worker->pid());
+    return pids;
   }
+
+private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<BPMPDWorker>> idle_;
+};
+
+static BPMPDWorkerPool& workerPool()
+{
+  static BPMPDWorkerPool pool;
+  return pool;
 }
 
-// BPMPDModel::~BPMPDModel()
-//{
-// char text[1] = {123};
-// write(gPipeIn, text, 1);
-// // kill(m_pid, SIGKILL); // TODO: WHY DOES THIS KILL THE PARENT PROCESS?!
-// close(m_pipeIn);
-// close(m_pipeOut);
-// m_pipeIn=0;
-// m_pipeOut=0;
-//}
+std::vector<int> idleBPMPDWorkers() { return workerPool().idlePids(); }
+
+BPMPDModel::BPMPDModel() = default;
 
 Var BPMPDModel::addVar(const std::string& name)
 {
-  m_vars.push_back(new VarRep(m_vars.size(), name, this));
+  m_vars.push_back(var_arena_.create(m_vars.size(), name, this));
   m_lbs.push_back(-BPMPD_BIG);
   m_ubs.push_back(BPMPD_BIG);
   return m_vars.back();
 }
-Cnt BPMPDModel::addEqCnt(const AffExpr& expr, const std::string& /*name*/)
-{
-  m_cnts.push_back(new CntRep(m_cnts.size(), this));
-  m_cntExprs.push_back(expr);
-  m_cntTypes.push_back(EQ);
-  return m_cnts.back();
-}
-Cnt BPMPDModel::addIneqCnt(const AffExpr& expr, const std::string& /*name*/)
+Cnt BPMPDModel::addCnt(const AffExpr& expr, ConstraintType type)
 {
-  m_cnts.push_back(new CntRep(m_cnts.size(), this));
-  m_cntExprs.push_back(expr);
-  m_cntTypes.push_back(INEQ);
-  return m_cnts.back();
+  return addCntSlot(m_cnts, m_cntExprs, m_cntTypes, expr, type);
 }
+Cnt BPMPDModel::addEqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, EQ); }
+Cnt BPMPDModel::addIneqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, INEQ); }
 Cnt BPMPDModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
 {
   assert(0 && "NOT IMPLEMENTED");
   return nullptr;
 }
-void BPMPDModel::removeVars(const VarVector& vars)
-{
-  SizeTVec inds;
-  vars2inds(vars, inds);
-  for (const auto& var : vars)
-    var.var_rep->removed = true;
-}
+void BPMPDModel::removeVars(const VarVector& vars) { queueRemovals(vars); }
 
-void BPMPDModel::removeCnts(const CntVector& cnts)
-{
-  SizeTVec inds;
-  cnts2inds(cnts, inds);
-  for (auto& cnt : cnts)
-    cnt.cnt_rep->removed = true;
-}
+void BPMPDModel::removeCnts(const CntVector& cnts) { queueRemovals(cnts); }
 
 void BPMPDModel::update()
 {
+  SizeTVec kept;
+  if (commitVarRemovals(m_vars, kept))
   {
-    size_t inew = 0;
-    for (unsigned iold = 0; iold < m_vars.size(); ++iold)
-    {
-      const Var& var = m_vars[iold];
-      if (!var.var_rep->removed)
-      {
-        m_vars[inew] = var;
-        m_lbs[inew] = m_lbs[iold];
-        m_ubs[inew] = m_ubs[iold];
-        var.var_rep->index = inew;
-        ++inew;
-      }
-      else
-        delete var.var_rep;
-    }
-    m_vars.resize(inew);
-    m_lbs.resize(inew);
-    m_ubs.resize(inew);
-  }
-  {
-    size_t inew = 0;
-    for (unsigned iold = 0; iold < m_cnts.size(); ++iold)
-    {
-      const Cnt& cnt = m_cnts[iold];
-      if (!cnt.cnt_rep->removed)
-      {
-        m_cnts[inew] = cnt;
-        m_cntExprs[inew] = m_cntExprs[iold];
-        m_cntTypes[inew] = m_cntTypes[iold];
-        cnt.cnt_rep->index = inew;
-        ++inew;
-      }
-      else
-        delete cnt.cnt_rep;
-    }
-    m_cnts.resize(inew);
-    m_cntExprs.resize(inew);
-    m_cntTypes.resize(inew);
+    keepEntries(m_lbs, kept);
+    keepEntries(m_ubs, kept);
   }
+  commitCntRemovals(m_cntExprs, m_cntTypes);
 }
 
 void BPMPDModel::setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper)
@@ -344,6 +438,9 @@ DblVec BPMPDModel::getVarValues(const VarVector& vars) const
 CvxOptStatus BPMPDModel::optimize()
 {
   update();
+  if (needsCompaction())
+    compactCnts(m_cnts, m_cntExprs, m_cntTypes);
+  num_solved_cnts_ = m_cnts.size();
   //
   //
   // int    m, n, nz, qn, qnz, acolcnt[maxn+1], acolidx[maxnz], qcolcnt[maxn+1],
@@ -356,17 +453,9 @@ CvxOptStatus BPMPDModel::optimize()
   size_t n = m_vars.size();
   size_t m = m_cnts.size();
 
-  IntVec acolcnt(n), acolidx, qcolcnt(n), qcolidx, status(m + n);
-  DblVec acolnzs, qcolnzs, rhs(m), obj(n, 0), lbound(m + n), ubound(m + n), primal(m + n), dual(m + n);
-
+  // The matrices are gathered by column, with repeated entries merged, and then written straight into the segment
   DBG(m_lbs);
   DBG(m_ubs);
-  for (size_t iVar = 0; iVar < n; ++iVar)
-  {
-    lbound[iVar] = fmax(m_lbs[iVar], -BPMPD_BIG);
-    ubound[iVar] = fmin(m_ubs[iVar], BPMPD_BIG);
-  }
-
   std::vector<IntVec> var2cntinds(n);
   std::vector<DblVec> var2cntvals(n);
   for (size_t iCnt = 0; iCnt < m; ++iCnt)
@@ -381,22 +470,8 @@ CvxOptStatus BPMPDModel::optimize()
       var2cntinds[static_cast<size_t>(inds[i])].push_back(static_cast<int>(iCnt));
       var2cntvals[static_cast<size_t>(inds[i])].push_back(aff.coeffs[i]);  // xxx maybe repeated/
     }
-
-    lbound[n + iCnt] = (m_cntTypes[iCnt] == INEQ) ? -BPMPD_BIG : 0;
-    ubound[n + iCnt] = 0;
-    rhs[iCnt] = -aff.constant;
   }
 
-  for (size_t iVar = 0; iVar < n; ++iVar)
-  {
-    simplify2(var2cntinds[iVar], var2cntvals[iVar]);
-    acolcnt[iVar] = static_cast<int>(var2cntinds[iVar].size());
-    acolidx.insert(acolidx.end(), var2cntinds[iVar].begin(), var2cntinds[iVar].end());
-    acolnzs.insert(acolnzs.end(), var2cntvals[iVar].begin(), var2cntvals[iVar].end());
-  }
-  // cout << CSTR(acolidx) << endl;
-  // cout << CSTR(acolnzs) << endl;
-
   std::vector<DblVec> var2qcoeffs(n);
   std::vector<IntVec> var2qinds(n);
   for (size_t i = 0; i < m_objective.size(); ++i)
@@ -420,103 +495,79 @@ CvxOptStatus BPMPDModel::optimize()
     }
   }
 
+  int nz = 0, qnz = 0;
   for (size_t iVar = 0; iVar < n; ++iVar)
   {
+    simplify2(var2cntinds[iVar], var2cntvals[iVar]);
     simplify2(var2qinds[iVar], var2qcoeffs[iVar]);
-    qcolidx.insert(qcolidx.end(), var2qinds[iVar].begin(), var2qinds[iVar].end());
-    qcolnzs.insert(qcolnzs.end(), var2qcoeffs[iVar].begin(), var2qcoeffs[iVar].end());
-    qcolcnt[iVar] = static_cast<int>(var2qinds[iVar].size());
-  }
-
-  for (size_t i = 0; i < m_objective.affexpr.size(); ++i)
-  {
-    obj[static_cast<size_t>(m_objective.affexpr.vars[i].var_rep->index)] += m_objective.affexpr.coeffs[i];
+    nz += static_cast<int>(var2cntinds[iVar].size());
+    qnz += static_cast<int>(var2qinds[iVar].size());
   }
-
-#define VECINC(vec)                                                                                                    \
-  for (unsigned i = 0; i < (vec).size(); ++i)                                                                          \
-    ++(vec)[i];
-  VECINC(acolidx);
-  VECINC(qcolidx);
-#undef VECINC
-
-  // cout << "objective: " << m_objective << endl;
-
-  auto nz = static_cast<int>(acolnzs.size());
   auto qn = static_cast<int>(n);
-  auto qnz = static_cast<int>(qcolnzs.size());
 
   DBG(m);
   DBG(n);
   DBG(nz);
   DBG(qn);
   DBG(qnz);
-  DBG(acolcnt);
-  DBG(acolidx);
-  DBG(acolnzs);
-  DBG(qcolcnt);
-  DBG(qcolidx);
-  DBG(qcolnzs);
-  DBG(rhs);
-  DBG(obj);
-  DBG(lbound);
-  DBG(ubound);
-
-#if 0
-  bpmpd(&m, &n, &nz, &qn, &qnz, acolcnt.data(), acolidx.data(), acolnzs.data(), qcolcnt.data(), qcolidx.data(), qcolnzs.data(),
-      rhs.data(), obj.data(), lbound.data(), ubound.data(), 
-      primal.data(), dual.data(), status.data(), &BIG, &code, &opt, &memsiz);
-
-  // opt += m_objective.affexpr.constant;
-  m_soln = DblVec(primal.begin(), primal.begin()+n);
-
-
-  if (1) {
-    DBG(primal);
-    DBG(dual);
-    DBG(status);
-    DBG(code);
-    DBG(opt);
-#undef DBG
-
-#else
-
-  bpmpd_io::bpmpd_input bi(static_cast<int>(m),
-                           static_cast<int>(n),
-                           nz,
-                           qn,
-                           qnz,
-                           acolcnt,
-                           acolidx,
-                           acolnzs,
-                           qcolcnt,
-                           qcolidx,
-                           qcolnzs,
-                           rhs,
-                           obj,
-                           lbound,
-                           ubound);
-  bpmpd_io::ser(gPipeIn, bi, bpmpd_io::SER);
-
-  // std::cout << "serialization time:" << end-start << std::endl;
-
-  bpmpd_io::bpmpd_output bo;
-  bpmpd_io::ser(gPipeOut, bo, bpmpd_io::DESER);
-
-  m_soln = DblVec(bo.primal.begin(), bo.primal.begin() + static_cast<long int>(n));
-  int retcode = bo.code;
-
-  if (retcode == 2)
-    return CVX_SOLVED;
-
-  if (retcode == 3 || retcode == 4)
-    return CVX_INFEASIBLE;
 
-  return CVX_FAILED;
+  // BPMPD numbers the rows from 1
+  auto writeColumns = [n](const std::vector<IntVec>& inds, const std::vector<DblVec>& vals, int* cnt, int* idx,
+                          double* nzs) {
+    for (size_t iVar = 0; iVar < n; ++iVar)
+    {
+      cnt[iVar] = static_cast<int>(inds[iVar].size());
+      for (int ind : inds[iVar])
+        *idx++ = ind + 1;
+      nzs = std::copy(vals[iVar].begin(), vals[iVar].end(), nzs);
+    }
+  };
 
-#endif
+  // A worker that dies during the solve is replaced once, a problem that kills it again is given up on
+  for (int attempt = 0; attempt < 2; ++attempt)
+  {
+    std::unique_ptr<BPMPDWorker> worker = workerPool().checkout();
+    if (!worker)
+      return CVX_FAILED;
+
+    bpmpd_io::Segment segment = worker->segment(static_cast<int>(m), static_cast<int>(n), nz, qn, qnz);
+    writeColumns(var2cntinds, var2cntvals, segment.acolcnt, segment.acolidx, segment.acolnzs);
+    writeColumns(var2qinds, var2qcoeffs, segment.qcolcnt, segment.qcolidx, segment.qcolnzs);
+    for (size_t iVar = 0; iVar < n; ++iVar)
+    {
+      segment.lbound[iVar] = fmax(m_lbs[iVar], -BPMPD_BIG);
+      segment.ubound[iVar] = fmin(m_ubs[iVar], BPMPD_BIG);
+    }
+    for (size_t iCnt = 0; iCnt < m; ++iCnt)
+    {
+      segment.lbound[n + iCnt] = (m_cntTypes[iCnt] == INEQ) ? -BPMPD_BIG : 0;
+      segment.ubound[n + iCnt] = 0;
+      segment.rhs[iCnt] = -m_cntExprs[iCnt].constant;
+    }
+    std::fill(segment.obj, segment.obj + n, 0.);
+    for (size_t i = 0; i < m_objective.affexpr.size(); ++i)
+      segment.obj[static_cast<size_t>(m_objective.affexpr.vars[i].var_rep->index)] += m_objective.affexpr.coeffs[i];
+
+    const pid_t pid = worker->pid();
+    if (!worker->solve())
+    {
+      LOG_WARN("BPMPD worker %i died during a solve", pid);
+      continue;
+    }
+
+    m_soln.assign(segment.primal, segment.primal + n);
+    const int retcode = segment.header->code;
+    workerPool().checkin(std::move(worker));
+
+    if (retcode == 2)
+      return CVX_SOLVED;
+
+    if (retcode == 3 || retcode == 4)
+      return CVX_INFEASIBLE;
 
-  // exit(0);
+    return CVX_FAILED;
+  }
+  return CVX_FAILED;
 }
 void BPMPDModel::setObjective(const AffExpr& expr) { m_objective.affexpr = expr; }
 void BPMPDModel::setObjective(const QuadExpr& expr) { m_objective = expr; }
@@ -525,4 +576,54 @@ void BPMPDModel::writeToFile(const std::string& /*fname*/) const
   // assert(0 && "NOT IMPLEMENTED");
 }
 VarVector BPMPDModel::getVars() const { return m_vars; }
+
+ModelSize BPMPDModel::getSize() const
+{
+  ModelSize size;
+  size.num_vars = m_vars.size();
+  size.num_cnts = m_cnts.size() - free_cnt_slots_.size();
+  for (const AffExpr& expr : m_cntExprs)
+    size.cnt_nonzeros += expr.size();
+  size.objective_nonzeros = m_objective.size();
+  return size;
+}
+
+bool BPMPDModel::exportQP(QPData& qp) const
+{
+  toQPData(m_vars, m_lbs, m_ubs, m_objective, m_cntExprs, m_cntTypes, free_cnt_slots_, qp);
+  qp.dual_layout = ModelType::BPMPD;
+  return true;
+}
+
+Model::Ptr BPMPDModel::clone() const
+{
+  auto out = std::make_shared<BPMPDModel>();
+  out->m_vars.reserve(m_vars.size());
+  for (const Var& var : m_vars)
+  {
+    out->m_vars.push_back(out->var_arena_.create(var.var_rep->index, var.var_rep->name, out.get()));
+    out->m_vars.back().var_rep->removed = var.var_rep->removed;
+  }
+  out->m_cnts.reserve(m_cnts.size());
+  out->m_cntExprs.reserve(m_cnts.size());
+  for (size_t i = 0; i < m_cnts.size(); ++i)
+  {
+    out->m_cnts.push_back(out->cnt_arena_.create(i, out.get()));
+    out->m_cnts.back().cnt_rep->removed = m_cnts[i].cnt_rep->removed;
+    out->m_cntExprs.push_back(toAffExpr(CompactAffExpr(m_cntExprs[i]), out->m_vars));
+  }
+  for (const Var& var : removed_vars_)
+    out->removed_vars_.push_back(out->m_vars[var.var_rep->index]);
+  for (const Cnt& cnt : removed_cnts_)
+    out->removed_cnts_.push_back(out->m_cnts[cnt.cnt_rep->index]);
+  out->copyFreeAuxVars(*this, out->m_vars);
+
+  out->m_cntTypes = m_cntTypes;
+  out->m_soln = m_soln;
+  out->m_lbs = m_lbs;
+  out->m_ubs = m_ubs;
+  out->free_cnt_slots_ = free_cnt_slots_;
+  out->m_objective = toQuadExpr(CompactQuadExpr(m_objective), out->m_vars);
+  return out;
+}
 }  // namespace sco
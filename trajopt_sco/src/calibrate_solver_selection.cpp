@@ -0,0 +1,225 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/qp_capture.hpp>
+#include <trajopt_sco/solver_selection.hpp>
+
+namespace
+{
+const double INF = std::numeric_limits<double>::infinity();
+
+const std::vector<std::size_t> SIZES = { 25, 50, 100, 200, 400, 800, 1600 };
+const std::vector<double> EQ_FRACTIONS = { 0, 0.5, 1 };
+const std::vector<double> DENSITIES = { 0.01, 0.05, 0.2 };
+/** Density of the problems that the size and equality sweeps use, about that of a trajectory */
+const double BASE_DENSITY = 0.01;
+const int REPEATS = 3;
+
+/**
+ * A feasible QP shaped like the ones trajopt builds: a smoothing objective over neighbouring variables and half as
+ * many constraints as variables, each on a band of neighbouring variables.
+ */
+sco::QPData generateQP(std::size_t n_vars, double eq_fraction, double density, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> uniform(-1, 1);
+
+  sco::QPData qp;
+  qp.dual_layout = sco::ModelType::AUTO_SOLVER;
+  qp.lb.assign(n_vars, -2);
+  qp.ub.assign(n_vars, 2);
+  for (std::size_t i = 0; i < n_vars; ++i)
+  {
+    qp.q.push_back(uniform(gen));
+    qp.P_rows.push_back(static_cast<int>(i));
+    qp.P_cols.push_back(static_cast<int>(i));
+    qp.P_vals.push_back(4);
+    if (i + 1 < n_vars)
+    {
+      qp.P_rows.push_back(static_cast<int>(i));
+      qp.P_cols.push_back(static_cast<int>(i + 1));
+      qp.P_vals.push_back(-2);
+    }
+  }
+
+  // Constraints hold at a point inside the bounds, so the problem is feasible
+  sco::DblVec x0(n_vars);
+  for (double& x : x0)
+    x = uniform(gen);
+
+  const std::size_t n_cnts = std::max<std::size_t>(n_vars / 2, 1);
+  const auto n_eq = static_cast<std::size_t>(eq_fraction * static_cast<double>(n_cnts) + 0.5);
+  const auto width = static_cast<std::size_t>(density * static_cast<double>(n_vars));
+  const std::size_t band = std::min(n_vars, std::max<std::size_t>(2, width));
+  std::uniform_int_distribution<std::size_t> start(0, n_vars - band);
+  for (std::size_t i = 0; i < n_cnts; ++i)
+  {
+    const std::size_t first = start(gen);
+    double value = 0;
+    for (std::size_t j = first; j < first + band; ++j)
+    {
+      const double coeff = uniform(gen);
+      qp.A_rows.push_back(static_cast<int>(i));
+      qp.A_cols.push_back(static_cast<int>(j));
+      qp.A_vals.push_back(coeff);
+      value += coeff * x0[j];
+    }
+    if (i < n_eq)
+    {
+      qp.l.push_back(value);
+      qp.u.push_back(value);
+    }
+    else
+    {
+      qp.l.push_back(-INF);
+      qp.u.push_back(value + (uniform(gen) + 1) / 2);
+    }
+  }
+  return qp;
+}
+
+/** Median seconds optimize() takes, infinite if the backend fails */
+double timeSolve(const sco::QPData& qp, sco::ModelType model_type)
+{
+  std::vector<double> times;
+  for (int i = 0; i < REPEATS; ++i)
+  {
+    sco::Model::Ptr model = sco::createModel(qp, model_type);
+    const auto start = std::chrono::steady_clock::now();
+    const sco::CvxOptStatus status = model->optimize();
+    const auto end = std::chrono::steady_clock::now();
+    if (status != sco::CVX_SOLVED)
+      return INF;
+    times.push_back(std::chrono::duration<double>(end - start).count());
+  }
+  std::sort(times.begin(), times.end());
+  return times[times.size() / 2];
+}
+
+/** Times every backend on a generated QP, prints a row of the table and returns the fastest backend */
+sco::ModelType fastest(const std::vector<sco::ModelType>& backends,
+                       std::size_t n_vars,
+                       double eq_fraction,
+                       double density)
+{
+  const sco::QPData qp = generateQP(n_vars, eq_fraction, density, static_cast<unsigned>(n_vars));
+  std::cout << std::setw(8) << n_vars << std::setw(8) << eq_fraction << std::setw(10) << density;
+  sco::ModelType best = backends.front();
+  double best_time = INF;
+  for (const sco::ModelType& backend : backends)
+  {
+    const double time = timeSolve(qp, backend);
+    std::cout << std::setw(12) << time * 1000;
+    if (time < best_time)
+    {
+      best = backend;
+      best_time = time;
+    }
+  }
+  std::cout << "   " << best << std::endl;
+  return best;
+}
+
+bool contains(const std::vector<sco::ModelType>& backends, sco::ModelType model_type)
+{
+  return std::find(backends.begin(), backends.end(), model_type) != backends.end();
+}
+}  // namespace
+
+/**
+ * Measures where the available backends overtake each other on generated QPs and writes the thresholds of
+ * ModelType::AUTO_SOLVER to a JSON file, to be named by TRAJOPT_SOLVER_SELECTION. Thresholds between backends that are
+ * not both available keep their default.
+ */
+int main(int argc, char** argv)
+{
+  if (argc > 2)
+  {
+    std::cerr << "usage: " << argv[0] << " [output file, default trajopt_solver_selection.json]" << std::endl;
+    return 2;
+  }
+  const std::string output = (argc == 2) ? argv[1] : "trajopt_solver_selection.json";
+
+  try
+  {
+    const std::vector<sco::ModelType> backends = sco::availableSolvers();
+    sco::SolverSelectionThresholds thresholds;
+
+    std::cout << std::setw(8) << "vars" << std::setw(8) << "eq" << std::setw(10) << "density";
+    for (const sco::ModelType& backend : backends)
+      std::cout << std::setw(12) << backend;
+    std::cout << "   (median ms)" << std::endl;
+
+    // Size and share of equalities up to which the active set solver wins
+    std::map<std::size_t, std::vector<sco::ModelType>> winners;
+    for (std::size_t n_vars : SIZES)
+      for (double eq_fraction : EQ_FRACTIONS)
+        winners[n_vars].push_back(fastest(backends, n_vars, eq_fraction, BASE_DENSITY));
+
+    if (contains(backends, sco::ModelType::QPOASES) && backends.size() > 1)
+    {
+      thresholds.active_set_max_vars = 0;
+      thresholds.active_set_min_eq_fraction = 1;
+      for (std::size_t n_vars : SIZES)
+      {
+        for (std::size_t i = 0; i < EQ_FRACTIONS.size(); ++i)
+        {
+          if (!(winners[n_vars][i] == sco::ModelType::QPOASES))
+            continue;
+          thresholds.active_set_max_vars = n_vars;
+          thresholds.active_set_min_eq_fraction = std::min(thresholds.active_set_min_eq_fraction, EQ_FRACTIONS[i]);
+        }
+      }
+    }
+
+    // Smallest size from which a large problem backend always wins
+    const bool have_large = contains(backends, sco::ModelType::OSQP) || contains(backends, sco::ModelType::BPMPD);
+    if (have_large && backends.size() > 1)
+    {
+      thresholds.large_min_vars = SIZES.back();
+      for (auto it = SIZES.rbegin(); it != SIZES.rend(); ++it)
+      {
+        const std::vector<sco::ModelType>& w = winners[*it];
+        if (!std::all_of(w.begin(), w.end(), [](sco::ModelType t) {
+              return t == sco::ModelType::OSQP || t == sco::ModelType::BPMPD;
+            }))
+          break;
+        thresholds.large_min_vars = *it;
+      }
+    }
+
+    // Density up to which OSQP beats BPMPD on large problems
+    if (contains(backends, sco::ModelType::OSQP) && contains(backends, sco::ModelType::BPMPD))
+    {
+      const std::vector<sco::ModelType> large = { sco::ModelType::OSQP, sco::ModelType::BPMPD };
+      const std::size_t n_vars = std::max(thresholds.large_min_vars, SIZES[SIZES.size() / 2]);
+      thresholds.sparse_max_density = 0;
+      for (double density : DENSITIES)
+      {
+        if (!(fastest(large, n_vars, 0.5, density) == sco::ModelType::OSQP))
+          break;
+        thresholds.sparse_max_density = density;
+      }
+    }
+
+    sco::saveSolverSelectionThresholds(output, thresholds);
+    std::cout << "wrote " << output << ":" << std::endl << thresholds.toJson() << std::endl;
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/compact_expr.hpp>
+
+namespace sco
+{
+namespace
+{
+/**
+ * @brief Computes sum(coeffs[i] * x[inds[i]])
+ *
+ * The loop is unrolled over independent accumulators, so the gathered loads are not serialized behind a single
+ * dependency chain and the products can be vectorized.
+ */
+double gatherDot(const std::uint32_t* inds, const double* coeffs, std::size_t n, const double* x)
+{
+  double acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    acc0 += coeffs[i] * x[inds[i]];
+    acc1 += coeffs[i + 1] * x[inds[i + 1]];
+    acc2 += coeffs[i + 2] * x[inds[i + 2]];
+    acc3 += coeffs[i + 3] * x[inds[i + 3]];
+  }
+  for (; i < n; ++i)
+    acc0 += coeffs[i] * x[inds[i]];
+  return (acc0 + acc1) + (acc2 + acc3);
+}
+
+/** @brief Computes sum(coeffs[i] * x[inds1[i]] * x[inds2[i]]) */
+double gatherDot2(const std::uint32_t* inds1,
+                  const std::uint32_t* inds2,
+                  const double* coeffs,
+                  std::size_t n,
+                  const double* x)
+{
+  double acc0 = 0, acc1 = 0;
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+  {
+    acc0 += coeffs[i] * x[inds1[i]] * x[inds2[i]];
+    acc1 += coeffs[i + 1] * x[inds1[i + 1]] * x[inds2[i + 1]];
+  }
+  for (; i < n; ++i)
+    acc0 += coeffs[i] * x[inds1[i]] * x[inds2[i]];
+  return acc0 + acc1;
+}
+
+void varsToInds(const VarVector& vars, IndexVec& inds)
+{
+  inds.resize(vars.size());
+  for (std::size_t i = 0; i < vars.size(); ++i)
+    inds[i] = static_cast<std::uint32_t>(vars[i].var_rep->index);
+}
+
+void indsToVars(const IndexVec& inds, const VarVector& vars, VarVector& out)
+{
+  out.resize(inds.size());
+  for (std::size_t i = 0; i < inds.size(); ++i)
+  {
+    assert(inds[i] < vars.size() && vars[inds[i]].var_rep->index == inds[i]);
+    out[i] = vars[inds[i]];
+  }
+}
+}  // namespace
+
+CompactAffExpr::CompactAffExpr(const AffExpr& expr) : constant(expr.constant), coeffs(expr.coeffs)
+{
+  varsToInds(expr.vars, inds);
+}
+
+double CompactAffExpr::value(const double* x) const { return constant + gatherDot(inds.data(), coeffs.data(), size(), x); }
+double CompactAffExpr::value(const DblVec& x) const
+{
+  assert(inds.empty() || *std::max_element(inds.begin(), inds.end()) < x.size());
+  return value(x.data());
+}
+
+CompactQuadExpr::CompactQuadExpr(const QuadExpr& expr) : affexpr(expr.affexpr), coeffs(expr.coeffs)
+{
+  varsToInds(expr.vars1, inds1);
+  varsToInds(expr.vars2, inds2);
+}
+
+double CompactQuadExpr::value(const double* x) const
+{
+  return affexpr.value(x) + gatherDot2(inds1.data(), inds2.data(), coeffs.data(), size(), x);
+}
+double CompactQuadExpr::value(const DblVec& x) const
+{
+  return affexpr.value(x) + gatherDot2(inds1.data(), inds2.data(), coeffs.data(), size(), x.data());
+}
+
+AffExpr toAffExpr(const CompactAffExpr& expr, const VarVector& vars)
+{
+  AffExpr out(expr.constant);
+  out.coeffs = expr.coeffs;
+  indsToVars(expr.inds, vars, out.vars);
+  return out;
+}
+
+QuadExpr toQuadExpr(const CompactQuadExpr& expr, const VarVector& vars)
+{
+  QuadExpr out(toAffExpr(expr.affexpr, vars));
+  out.coeffs = expr.coeffs;
+  indsToVars(expr.inds1, vars, out.vars1);
+  indsToVars(expr.inds2, vars, out.vars2);
+  return out;
+}
+
+void exprInc(CompactAffExpr& a, const CompactAffExpr& b)
+{
+  a.constant += b.constant;
+  a.inds.insert(a.inds.end(), b.inds.begin(), b.inds.end());
+  a.coeffs.insert(a.coeffs.end(), b.coeffs.begin(), b.coeffs.end());
+}
+
+void exprInc(CompactQuadExpr& a, const CompactQuadExpr& b)
+{
+  exprInc(a.affexpr, b.affexpr);
+  a.inds1.insert(a.inds1.end(), b.inds1.begin(), b.inds1.end());
+  a.inds2.insert(a.inds2.end(), b.inds2.begin(), b.inds2.end());
+  a.coeffs.insert(a.coeffs.end(), b.coeffs.begin(), b.coeffs.end());
+}
+
+std::ostream& operator<<(std::ostream& o, const CompactAffExpr& e)
+{
+  o << e.constant;
+  for (std::size_t i = 0; i < e.size(); ++i)
+    o << " + " << e.coeffs[i] << "*x" << e.inds[i];
+  return o;
+}
+}  // namespace sco
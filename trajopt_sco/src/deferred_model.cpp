@@ -0,0 +1,137 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cmath>
+#include <iostream>
+#include <sstream>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/deferred_model.hpp>
+
+namespace sco
+{
+// The VarReps are destroyed with var_arena_
+DeferredModel::~DeferredModel() = default;
+
+Var DeferredModel::addVar(const std::string& name)
+{
+  vars_.push_back(var_arena_.create(vars_.size(), name, this));
+  lbs_.push_back(-INFINITY);
+  ubs_.push_back(INFINITY);
+  return vars_.back();
+}
+
+Cnt DeferredModel::addEqCnt(const AffExpr&, const std::string& /*name*/)
+{
+  PRINT_AND_THROW("DeferredModel: constraints can not be added while convexifying");
+}
+
+Cnt DeferredModel::addIneqCnt(const AffExpr&, const std::string& /*name*/)
+{
+  PRINT_AND_THROW("DeferredModel: constraints can not be added while convexifying");
+}
+
+Cnt DeferredModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
+{
+  PRINT_AND_THROW("DeferredModel: constraints can not be added while convexifying");
+}
+
+void DeferredModel::removeVars(const VarVector& vars)
+{
+  for (const Var& var : vars)
+    var.var_rep->removed = true;
+}
+
+void DeferredModel::removeCnts(const CntVector& cnts)
+{
+  if (!cnts.empty())
+    PRINT_AND_THROW("DeferredModel: constraints can not be removed while convexifying");
+}
+
+void DeferredModel::update() {}
+
+void DeferredModel::setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper)
+{
+  for (std::size_t i = 0; i < vars.size(); ++i)
+  {
+    if (vars[i].var_rep->creator != this)
+      PRINT_AND_THROW("DeferredModel: only the bounds of auxiliary variables can be set while convexifying");
+    lbs_[vars[i].var_rep->index] = lower[i];
+    ubs_[vars[i].var_rep->index] = upper[i];
+  }
+}
+
+DblVec DeferredModel::getVarValues(const VarVector& /*vars*/) const
+{
+  PRINT_AND_THROW("DeferredModel: has no solution");
+}
+
+CvxOptStatus DeferredModel::optimize() { PRINT_AND_THROW("DeferredModel: can not be optimized"); }
+void DeferredModel::setObjective(const AffExpr&) { PRINT_AND_THROW("DeferredModel: has no objective"); }
+void DeferredModel::setObjective(const QuadExpr&) { PRINT_AND_THROW("DeferredModel: has no objective"); }
+void DeferredModel::writeToFile(const std::string& /*fname*/) const
+{
+  PRINT_AND_THROW("DeferredModel: can not be written to file");
+}
+VarVector DeferredModel::getVars() const { return vars_; }
+Var DeferredModel::addAuxVar(const std::string& name, double lb, double ub) { return Model::addVar(name, lb, ub); }
+void DeferredModel::releaseAuxVars(const VarVector& vars) { removeVars(vars); }
+
+void DeferredModel::createVars(Model* model)
+{
+  assert(committed_.empty());
+  committed_.reserve(vars_.size());
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+  {
+    committed_.push_back(model->addAuxVar(vars_[i].var_rep->name, lbs_[i], ubs_[i]));
+    if (vars_[i].var_rep->removed)
+      model->releaseAuxVars(VarVector(1, committed_.back()));
+  }
+}
+
+void DeferredModel::translate(Var& var) const
+{
+  if (var.var_rep != nullptr && var.var_rep->creator == this)
+    var = committed_[var.var_rep->index];
+}
+
+void DeferredModel::translate(AffExpr& expr) const
+{
+  for (Var& var : expr.vars)
+    translate(var);
+}
+
+void DeferredModel::translate(QuadExpr& expr) const
+{
+  translate(expr.affexpr);
+  for (Var& var : expr.vars1)
+    translate(var);
+  for (Var& var : expr.vars2)
+    translate(var);
+}
+
+void DeferredModel::commit(Model* model, ConvexObjective& cost)
+{
+  assert(cost.cnts_.empty());
+  createVars(model);
+  translate(cost.quad_);
+  for (AffExpr& aff : cost.eqs_)
+    translate(aff);
+  for (AffExpr& aff : cost.ineqs_)
+    translate(aff);
+  for (Var& var : cost.vars_)
+    translate(var);
+  if (cost.model_ == this)
+    cost.model_ = model;
+}
+
+void DeferredModel::commit(Model* model, ConvexConstraints& cnt)
+{
+  createVars(model);
+  for (AffExpr& aff : cnt.eqs_)
+    translate(aff);
+  for (AffExpr& aff : cnt.ineqs_)
+    translate(aff);
+  if (cnt.inModel())
+    cnt.setModel(model);
+}
+}  // namespace sco
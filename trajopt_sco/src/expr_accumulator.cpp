@@ -0,0 +1,66 @@
+#include <trajopt_sco/expr_accumulator.hpp>
+
+namespace sco
+{
+void ExprAccumulator::clear()
+{
+  expr_.affexpr.constant = 0;
+  expr_.affexpr.vars.clear();
+  expr_.affexpr.coeffs.clear();
+  expr_.vars1.clear();
+  expr_.vars2.clear();
+  expr_.coeffs.clear();
+  linear_terms_.clear();
+  quadratic_terms_.clear();
+}
+
+void ExprAccumulator::add(const AffExpr& expr)
+{
+  expr_.affexpr.constant += expr.constant;
+  for (std::size_t i = 0; i < expr.size(); ++i)
+    addLinear(expr.vars[i], expr.coeffs[i]);
+}
+
+void ExprAccumulator::add(const QuadExpr& expr)
+{
+  add(expr.affexpr);
+  for (std::size_t i = 0; i < expr.size(); ++i)
+    addQuadratic(expr.vars1[i], expr.vars2[i], expr.coeffs[i]);
+}
+
+void ExprAccumulator::addLinear(const Var& var, double coeff)
+{
+  auto it = linear_terms_.emplace(var.var_rep->index, expr_.affexpr.size());
+  if (it.second)
+  {
+    expr_.affexpr.vars.push_back(var);
+    expr_.affexpr.coeffs.push_back(coeff);
+  }
+  else
+  {
+    expr_.affexpr.coeffs[it.first->second] += coeff;
+  }
+}
+
+void ExprAccumulator::addQuadratic(const Var& var1, const Var& var2, double coeff)
+{
+  // x_i * x_j and x_j * x_i are the same term, which is stored with the lower index first
+  const bool swap = var2.var_rep->index < var1.var_rep->index;
+  const Var& first = swap ? var2 : var1;
+  const Var& second = swap ? var1 : var2;
+  const std::uint64_t key =
+      (static_cast<std::uint64_t>(first.var_rep->index) << 32) | static_cast<std::uint64_t>(second.var_rep->index);
+
+  auto it = quadratic_terms_.emplace(key, expr_.size());
+  if (it.second)
+  {
+    expr_.vars1.push_back(first);
+    expr_.vars2.push_back(second);
+    expr_.coeffs.push_back(coeff);
+  }
+  else
+  {
+    expr_.coeffs[it.first->second] += coeff;
+  }
+}
+}  // namespace sco
@@ -3,6 +3,7 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 extern "C" {
 #include "gurobi_c.h"
 }
+#include <cmath>
 #include <iostream>
 #include <map>
 #include <sstream>
@@ -85,14 +86,14 @@ Var GurobiModel::addVar(const std::string& name)
 {
   ENSURE_SUCCESS(GRBaddvar(
       m_model, 0, nullptr, nullptr, 0, -GRB_INFINITY, GRB_INFINITY, GRB_CONTINUOUS, const_cast<char*>(name.c_str())));
-  m_vars.push_back(new VarRep(m_vars.size(), name, this));
+  m_vars.push_back(var_arena_.create(m_vars.size(), name, this));
   return m_vars.back();
 }
 
 Var GurobiModel::addVar(const std::string& name, double lb, double ub)
 {
   ENSURE_SUCCESS(GRBaddvar(m_model, 0, nullptr, nullptr, 0, lb, ub, GRB_CONTINUOUS, const_cast<char*>(name.c_str())));
-  m_vars.push_back(new VarRep(m_vars.size(), name, this));
+  m_vars.push_back(var_arena_.create(m_vars.size(), name, this));
   return m_vars.back();
 }
 
@@ -110,7 +111,7 @@ Cnt GurobiModel::addEqCnt(const AffExpr& expr, const std::string& name)
                               GRB_EQUAL,
                               -expr.constant,
                               const_cast<char*>(name.c_str())));
-  m_cnts.push_back(new CntRep(m_cnts.size(), this));
+  m_cnts.push_back(cnt_arena_.create(m_cnts.size(), this));
   return m_cnts.back();
 }
 Cnt GurobiModel::addIneqCnt(const AffExpr& expr, const std::string& name)
@@ -127,7 +128,7 @@ Cnt GurobiModel::addIneqCnt(const AffExpr& expr, const std::string& name)
                               GRB_LESS_EQUAL,
                               -expr.constant,
                               const_cast<char*>(name.c_str())));
-  m_cnts.push_back(new CntRep(m_cnts.size(), this));
+  m_cnts.push_back(cnt_arena_.create(m_cnts.size(), this));
   return m_cnts.back();
 }
 Cnt GurobiModel::addIneqCnt(const QuadExpr& qexpr, const std::string& name)
@@ -241,6 +242,11 @@ CvxOptStatus GurobiModel::optimize()
   else
     return CVX_FAILED;
 }
+void GurobiModel::setTimeLimit(double time_limit)
+{
+  ENSURE_SUCCESS(
+      GRBsetdblparam(GRBgetenv(m_model), GRB_DBL_PAR_TIMELIMIT, std::isfinite(time_limit) ? time_limit : GRB_INFINITY));
+}
 CvxOptStatus GurobiModel::optimizeFeasRelax()
 {
   double lbpen = GRB_INFINITY, ubpen = GRB_INFINITY, rhspen = 1;
@@ -296,7 +302,7 @@ void GurobiModel::update()
         ++inew;
       }
       else
-        delete var.var_rep;
+        var_arena_.release(var.var_rep);
     }
     m_vars.resize(inew);
   }
@@ -311,7 +317,7 @@ void GurobiModel::update()
         ++inew;
       }
       else
-        delete cnt.cnt_rep;
+        cnt_arena_.release(cnt.cnt_rep);
     }
     m_cnts.resize(inew);
   }
@@ -0,0 +1,285 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <boost/format.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/iteration_log.hpp>
+#include <trajopt_utils/logging.hpp>
+
+namespace sco
+{
+namespace
+{
+/** Start of every iteration log, followed by the format version */
+const char ITERATION_LOG_MAGIC[8] = { 'T', 'R', 'A', 'J', 'O', 'P', 'T', 'L' };
+const std::uint32_t ITERATION_LOG_VERSION = 1;
+
+/** Doubles per record: the merit scalars, the variables, three values per cost and four per constraint */
+std::size_t recordSize(std::size_t n_vars, std::size_t n_costs, std::size_t n_cnts)
+{
+  return 6 + n_vars + 3 * n_costs + 4 * n_cnts;
+}
+
+double* packVec(double* out, const DblVec& v, std::size_t n, const char* name)
+{
+  if (v.size() != n)
+    PRINT_AND_THROW(boost::format("iteration log expected %i values of %s, got %i") % n % name % v.size());
+  return std::copy(v.begin(), v.end(), out);
+}
+
+void packRecord(const BasicTrustRegionSQPResults& r, double* out)
+{
+  const std::size_t n_costs = r.cost_names.size();
+  const std::size_t n_cnts = r.cnt_names.size();
+  *out++ = r.old_merit;
+  *out++ = r.model_merit;
+  *out++ = r.new_merit;
+  *out++ = r.approx_merit_improve;
+  *out++ = r.exact_merit_improve;
+  *out++ = r.merit_improve_ratio;
+  out = packVec(out, r.new_x, r.var_names.size(), "new_x");
+  out = packVec(out, r.old_cost_vals, n_costs, "old_cost_vals");
+  out = packVec(out, r.model_cost_vals, n_costs, "model_cost_vals");
+  out = packVec(out, r.new_cost_vals, n_costs, "new_cost_vals");
+  out = packVec(out, r.old_cnt_viols, n_cnts, "old_cnt_viols");
+  out = packVec(out, r.model_cnt_viols, n_cnts, "model_cnt_viols");
+  out = packVec(out, r.new_cnt_viols, n_cnts, "new_cnt_viols");
+  packVec(out, r.merit_error_coeffs, n_cnts, "merit_error_coeffs");
+}
+
+const double* unpackVec(const double* in, DblVec& v, std::size_t n)
+{
+  v.assign(in, in + n);
+  return in + n;
+}
+
+void unpackRecord(const double* in, BasicTrustRegionSQPResults& r)
+{
+  const std::size_t n_costs = r.cost_names.size();
+  const std::size_t n_cnts = r.cnt_names.size();
+  r.old_merit = *in++;
+  r.model_merit = *in++;
+  r.new_merit = *in++;
+  r.approx_merit_improve = *in++;
+  r.exact_merit_improve = *in++;
+  r.merit_improve_ratio = *in++;
+  in = unpackVec(in, r.new_x, r.var_names.size());
+  in = unpackVec(in, r.old_cost_vals, n_costs);
+  in = unpackVec(in, r.model_cost_vals, n_costs);
+  in = unpackVec(in, r.new_cost_vals, n_costs);
+  in = unpackVec(in, r.old_cnt_viols, n_cnts);
+  in = unpackVec(in, r.model_cnt_viols, n_cnts);
+  in = unpackVec(in, r.new_cnt_viols, n_cnts);
+  unpackVec(in, r.merit_error_coeffs, n_cnts);
+}
+
+void writeNames(std::FILE* file, const std::vector<std::string>& names)
+{
+  const auto n = static_cast<std::uint32_t>(names.size());
+  std::fwrite(&n, sizeof(n), 1, file);
+  for (const std::string& name : names)
+  {
+    const auto length = static_cast<std::uint32_t>(name.size());
+    std::fwrite(&length, sizeof(length), 1, file);
+    std::fwrite(name.data(), 1, name.size(), file);
+  }
+}
+
+bool readNames(std::FILE* file, std::vector<std::string>& names)
+{
+  std::uint32_t n{ 0 };
+  if (std::fread(&n, sizeof(n), 1, file) != 1)
+    return false;
+  names.clear();
+  for (std::uint32_t i = 0; i < n; ++i)
+  {
+    std::uint32_t length{ 0 };
+    if (std::fread(&length, sizeof(length), 1, file) != 1)
+      return false;
+    std::string name(length, '\0');
+    if (length > 0 && std::fread(&name[0], 1, length, file) != length)
+      return false;
+    names.push_back(std::move(name));
+  }
+  return true;
+}
+
+using FilePtr = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+
+FilePtr openCsv(const std::string& path)
+{
+  FilePtr file(std::fopen(path.c_str(), "w"), &std::fclose);
+  if (!file)
+    PRINT_AND_THROW(boost::format("failed to create %s") % path);
+  return file;
+}
+}  // namespace
+
+IterationLogWriter::IterationLogWriter(const std::string& path,
+                                       const std::vector<std::string>& var_names,
+                                       const std::vector<std::string>& cost_names,
+                                       const std::vector<std::string>& cnt_names,
+                                       std::size_t capacity)
+  : file_(std::fopen(path.c_str(), "wb"))
+  , record_size_(recordSize(var_names.size(), cost_names.size(), cnt_names.size()))
+  , capacity_(std::max<std::size_t>(capacity, 1))
+  , ring_(capacity_ * record_size_)
+  , head_(0)
+  , tail_(0)
+  , closing_(false)
+  , waiting_(false)
+  , dropped_(0)
+{
+  if (file_ == nullptr)
+    PRINT_AND_THROW(boost::format("failed to create iteration log %s") % path);
+
+  std::fwrite(ITERATION_LOG_MAGIC, 1, sizeof(ITERATION_LOG_MAGIC), file_);
+  std::fwrite(&ITERATION_LOG_VERSION, sizeof(ITERATION_LOG_VERSION), 1, file_);
+  writeNames(file_, var_names);
+  writeNames(file_, cost_names);
+  writeNames(file_, cnt_names);
+
+  thread_ = std::thread(&IterationLogWriter::run, this);
+}
+
+IterationLogWriter::~IterationLogWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_.store(true, std::memory_order_release);
+  }
+  wakeup_.notify_one();
+  thread_.join();
+  if (dropped_ > 0)
+    LOG_WARN("iteration log dropped %zu records because the writer could not keep up", dropped_);
+  std::fclose(file_);
+}
+
+bool IterationLogWriter::push(const BasicTrustRegionSQPResults& results)
+{
+  const std::size_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head_.load(std::memory_order_acquire) == capacity_)
+  {
+    ++dropped_;
+    return false;
+  }
+  packRecord(results, &ring_[(tail % capacity_) * record_size_]);
+  // Sequentially consistent with waiting_, so either the writer thread sees the record before it sleeps or it is woken
+  tail_.store(tail + 1);
+  if (waiting_.load())
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wakeup_.notify_one();
+  }
+  return true;
+}
+
+void IterationLogWriter::run()
+{
+  bool unflushed = false;
+  bool failed = false;
+  for (;;)
+  {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    const std::size_t tail = tail_.load(std::memory_order_acquire);
+    if (head == tail)
+    {
+      // push() is done before closing_ is set, so tail_ is final once closing_ is seen
+      if (closing_.load(std::memory_order_acquire) && tail_.load(std::memory_order_acquire) == tail)
+        break;
+      if (unflushed)
+      {
+        std::fflush(file_);
+        unflushed = false;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      waiting_.store(true);
+      wakeup_.wait(lock, [&] { return tail_.load() != tail || closing_.load(std::memory_order_acquire); });
+      waiting_.store(false, std::memory_order_relaxed);
+      continue;
+    }
+
+    // Write everything up to the end of the ring at once
+    const std::size_t first = head % capacity_;
+    const std::size_t count = std::min(tail - head, capacity_ - first);
+    const std::size_t n = count * record_size_;
+    if (std::fwrite(&ring_[first * record_size_], sizeof(double), n, file_) != n && !failed)
+    {
+      LOG_ERROR("failed to write the iteration log: %s", std::strerror(errno));
+      failed = true;
+    }
+    unflushed = true;
+    head_.store(head + count, std::memory_order_release);
+  }
+  std::fflush(file_);
+}
+
+IterationLogReader::IterationLogReader(const std::string& path) : file_(std::fopen(path.c_str(), "rb"))
+{
+  if (file_ == nullptr)
+    PRINT_AND_THROW(boost::format("failed to open iteration log %s") % path);
+
+  char magic[sizeof(ITERATION_LOG_MAGIC)];
+  std::uint32_t version{ 0 };
+  if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic) ||
+      std::memcmp(magic, ITERATION_LOG_MAGIC, sizeof(magic)) != 0 ||
+      std::fread(&version, sizeof(version), 1, file_) != 1)
+  {
+    std::fclose(file_);
+    PRINT_AND_THROW(boost::format("%s is not an iteration log") % path);
+  }
+  if (version != ITERATION_LOG_VERSION)
+  {
+    std::fclose(file_);
+    PRINT_AND_THROW(boost::format("iteration log %s has version %i, expected %i") % path % version %
+                    ITERATION_LOG_VERSION);
+  }
+  if (!readNames(file_, var_names_) || !readNames(file_, cost_names_) || !readNames(file_, cnt_names_))
+  {
+    std::fclose(file_);
+    PRINT_AND_THROW(boost::format("iteration log %s has a truncated header") % path);
+  }
+  record_.resize(recordSize(var_names_.size(), cost_names_.size(), cnt_names_.size()));
+}
+
+IterationLogReader::~IterationLogReader() { std::fclose(file_); }
+
+bool IterationLogReader::next(BasicTrustRegionSQPResults& results)
+{
+  if (results.var_names.size() != var_names_.size() || results.cost_names.size() != cost_names_.size() ||
+      results.cnt_names.size() != cnt_names_.size())
+    PRINT_AND_THROW("results do not match the names of the iteration log");
+
+  if (std::fread(record_.data(), sizeof(double), record_.size(), file_) != record_.size())
+    return false;
+  unpackRecord(record_.data(), results);
+  return true;
+}
+
+std::size_t iterationLogToCsv(const std::string& log_path, const std::string& csv_dir)
+{
+  IterationLogReader reader(log_path);
+  BasicTrustRegionSQPResults results(reader.varNames(), reader.costNames(), reader.cntNames());
+  FilePtr solver = openCsv(csv_dir + "/trajopt_solver.log");
+  FilePtr vars = openCsv(csv_dir + "/trajopt_vars.log");
+  FilePtr costs = openCsv(csv_dir + "/trajopt_costs.log");
+  FilePtr constraints = openCsv(csv_dir + "/trajopt_constraints.log");
+
+  std::size_t n_records = 0;
+  while (reader.next(results))
+  {
+    const bool header = (n_records == 0);
+    results.writeSolver(solver.get(), header);
+    results.writeVars(vars.get(), header);
+    results.writeCosts(costs.get(), header);
+    results.writeConstraints(constraints.get(), header);
+    ++n_records;
+  }
+  return n_records;
+}
+}  // namespace sco
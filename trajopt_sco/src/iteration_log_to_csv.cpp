@@ -0,0 +1,29 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <exception>
+#include <iostream>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/iteration_log.hpp>
+
+/** Converts the binary iteration log of BasicTrustRegionSQP to the CSV files it used to write directly */
+int main(int argc, char** argv)
+{
+  if (argc != 3)
+  {
+    std::cerr << "usage: " << argv[0] << " <iteration log> <output directory>" << std::endl;
+    return 2;
+  }
+
+  try
+  {
+    std::size_t n_records = sco::iterationLogToCsv(argv[1], argv[2]);
+    std::cout << "converted " << n_records << " records" << std::endl;
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -6,8 +6,10 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <sstream>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+#include <trajopt_sco/auto_solver_model.hpp>
 #include <trajopt_sco/expr_ops.hpp>
 #include <trajopt_sco/modeling.hpp>
+#include <trajopt_sco/presolve_model.hpp>
 #include <trajopt_sco/sco_common.hpp>
 #include <trajopt_utils/logging.hpp>
 #include <trajopt_utils/macros.h>
@@ -18,7 +20,7 @@ void ConvexObjective::addAffExpr(const AffExpr& affexpr) { exprInc(quad_, affexp
 void ConvexObjective::addQuadExpr(const QuadExpr& quadexpr) { exprInc(quad_, quadexpr); }
 void ConvexObjective::addHinge(const AffExpr& affexpr, double coeff)
 {
-  Var hinge = model_->addVar("hinge", 0, INFINITY);
+  Var hinge = model_->addAuxVar("hinge", 0, INFINITY);
   vars_.push_back(hinge);
   ineqs_.push_back(affexpr);
   exprDec(ineqs_.back(), hinge);
@@ -29,8 +31,8 @@ void ConvexObjective::addHinge(const AffExpr& affexpr, double coeff)
 void ConvexObjective::addAbs(const AffExpr& affexpr, double coeff)
 {
   // Add variables that will enforce ABS
-  Var neg = model_->addVar("neg", 0, INFINITY);
-  Var pos = model_->addVar("pos", 0, INFINITY);
+  Var neg = model_->addAuxVar("neg", 0, INFINITY);
+  Var pos = model_->addAuxVar("pos", 0, INFINITY);
   vars_.push_back(neg);
   vars_.push_back(pos);
   // Coeff will be applied whenever neg/pos are not 0
@@ -68,7 +70,8 @@ void ConvexObjective::addL2Norm(const AffExprVector& ev)
 
 void ConvexObjective::addMax(const AffExprVector& ev)
 {
-  Var m = model_->addVar("max", -INFINITY, INFINITY);
+  Var m = model_->addAuxVar("max", -INFINITY, INFINITY);
+  vars_.push_back(m);
   for (const auto& i : ev)
   {
     ineqs_.push_back(i);
@@ -92,7 +95,8 @@ void ConvexObjective::addConstraintsToModel()
 void ConvexObjective::removeFromModel()
 {
   model_->removeCnts(cnts_);
-  model_->removeVars(vars_);
+  // The auxiliary variables are kept in the model for the next convexification
+  model_->releaseAuxVars(vars_);
   model_ = nullptr;
 }
 ConvexObjective::~ConvexObjective()
@@ -161,6 +165,24 @@ DblVec Constraint::violations(const DblVec& x)
 
 double Constraint::violation(const DblVec& x) { return vecSum(violations(x)); }
 OptProb::OptProb(ModelType convex_solver) : model_(createModel(convex_solver)) {}
+
+OptProb::OptProb(ModelType convex_solver, const QPFeatures& features, bool presolve)
+  : model_(presolve ? createPresolveModel(convex_solver, features) : createModel(convex_solver, features))
+{
+}
+
+OptProb::OptProb(ModelType convex_solver, bool presolve)
+{
+  if (!(convex_solver == ModelType::AUTO_SOLVER))
+  {
+    model_ = presolve ? createPresolveModel(convex_solver) : createModel(convex_solver);
+    return;
+  }
+  if (presolve)
+    model_ = std::make_shared<PresolveModel>(convex_solver);
+  else
+    model_ = std::make_shared<AutoSolverModel>();
+}
 VarVector OptProb::createVariables(const std::vector<std::string>& names)
 {
   return createVariables(names, DblVec(names.size(), -INFINITY), DblVec(names.size(), INFINITY));
@@ -1,6 +1,7 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <Eigen/Eigenvalues>
+#include <cmath>
 #include <iostream>
 TRAJOPT_IGNORE_WARNINGS_POP
 
@@ -12,6 +13,8 @@ TRAJOPT_IGNORE_WARNINGS_POP
 namespace sco
 {
 const double DEFAULT_EPSILON = 1e-5;
+/** Errors closer than this to the kink of an ABS or HINGE penalty have their weight in the quasi-Newton update damped */
+const double QUASI_NEWTON_KINK_WIDTH = 1e-3;
 
 Eigen::VectorXd getVec(const DblVec& x, const VarVector& vars)
 {
@@ -55,6 +58,21 @@ ConvexObjective::Ptr CostFromFunc::convex(const DblVec& x, Model* model)
   Eigen::VectorXd x_eigen = getVec(x, vars_);
 
   ConvexObjective::Ptr out(new ConvexObjective(model));
+  if (quasi_newton_.type() != NO_QUASI_NEWTON)
+  {
+    Eigen::VectorXd grad = calcForwardNumGrad(*f_, x_eigen, epsilon_);
+    if (prev_x_.size() > 0 && prev_x_ != x_eigen)
+      quasi_newton_.update(x_eigen - prev_x_, grad - prev_grad_);
+    prev_x_ = x_eigen;
+    prev_grad_ = grad;
+    if (!quasi_newton_.empty())
+    {
+      out->addAffExpr(affFromValGrad(f_->call(x_eigen), x_eigen, grad, vars_));
+      out->addQuadExpr(quasi_newton_.quadExpr(x_eigen, vars_));
+      return out;
+    }
+  }
+
   if (!full_hessian_)
   {
     double val;
@@ -207,6 +225,40 @@ ConvexObjective::Ptr CostFromErrFunc::convex(const DblVec& x, Model* model)
         assert(0 && "unreachable");
     }
   }
+
+  if (quasi_newton_.type() != NO_QUASI_NEWTON)
+  {
+    // The gradient of the cost is jac^T * penalty_grad, so its curvature beyond the linearization is the one of the
+    // error function weighted with penalty_grad. The derivative of ABS and HINGE jumps at zero, where the error of a
+    // converging cost ends up, so it is ramped across the kink. Otherwise the weights flip sign between the updates.
+    Eigen::VectorXd penalty_grad(y.size());
+    for (long int i = 0; i < y.size(); ++i)
+    {
+      switch (pen_type_)
+      {
+        case SQUARED:
+          penalty_grad[i] = 2 * y[i];
+          break;
+        case ABS:
+          penalty_grad[i] = fmax(-1., fmin(1., y[i] / QUASI_NEWTON_KINK_WIDTH));
+          break;
+        case HINGE:
+          penalty_grad[i] = fmax(0., fmin(1., y[i] / QUASI_NEWTON_KINK_WIDTH));
+          break;
+        default:
+          assert(0 && "unreachable");
+      }
+    }
+    if (coeffs_.size() > 0)
+      penalty_grad.array() *= coeffs_.array();
+
+    if (prev_x_.size() > 0 && prev_x_ != x_eigen)
+      quasi_newton_.update(x_eigen - prev_x_, (jac - prev_jac_).transpose() * penalty_grad);
+    prev_x_ = x_eigen;
+    prev_jac_ = jac;
+    if (!quasi_newton_.empty())
+      out->addQuadExpr(quasi_newton_.quadExpr(x_eigen, vars_));
+  }
   return out;
 }
 
@@ -1,13 +1,23 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
 #include <boost/format.hpp>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
+#include <exception>
+#include <limits>
+#include <memory>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+#include <trajopt_sco/compact_expr.hpp>
+#include <trajopt_sco/deferred_model.hpp>
+#include <trajopt_sco/expr_accumulator.hpp>
 #include <trajopt_sco/expr_ops.hpp>
+#include <trajopt_sco/iteration_log.hpp>
 #include <trajopt_sco/modeling.hpp>
 #include <trajopt_sco/optimizers.hpp>
+#include <trajopt_sco/qp_capture.hpp>
 #include <trajopt_sco/sco_common.hpp>
 #include <trajopt_sco/solver_interface.hpp>
 #include <trajopt_utils/logging.hpp>
@@ -29,46 +39,213 @@ std::ostream& operator<<(std::ostream& o, const OptResults& r)
   return o;
 }
 
+Deadline::Deadline(double max_time) : unlimited_(!std::isfinite(max_time))
+{
+  if (!unlimited_)
+    end_ = std::chrono::steady_clock::now() +
+           std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(max_time));
+}
+
+bool Deadline::expired() const { return !unlimited_ && std::chrono::steady_clock::now() >= end_; }
+
+double Deadline::remaining() const
+{
+  if (unlimited_)
+    return static_cast<double>(INFINITY);
+  return std::fmax(std::chrono::duration<double>(end_ - std::chrono::steady_clock::now()).count(), 0.0);
+}
+
+void Deadline::check() const
+{
+  if (expired())
+    throw TimeLimitExceeded();
+}
+
+OptProfile::PhaseTimes& OptProfile::PhaseTimes::operator+=(const PhaseTimes& other)
+{
+  convexify += other.convexify;
+  model_build += other.model_build;
+  qp_solve += other.qp_solve;
+  evaluate += other.evaluate;
+  callbacks += other.callbacks;
+  return *this;
+}
+
+double OptProfile::cacheHitRate() const
+{
+  std::size_t hits = 0;
+  std::size_t lookups = 0;
+  for (const auto& term : terms)
+  {
+    hits += term.second.cache.hits;
+    lookups += term.second.cache.hits + term.second.cache.misses;
+  }
+  return (lookups == 0) ? 0 : static_cast<double>(hits) / static_cast<double>(lookups);
+}
+
 //////////////////////////////////////////////////
 ////////// private utility functions for  sqp /////////
 //////////////////////////////////////////////////
 
-static DblVec evaluateCosts(const std::vector<Cost::Ptr>& costs, const DblVec& x)
+/** Adds the wall time of its lifetime to a counter. Without a counter it does not even read the clock. */
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(double* seconds) : seconds_(seconds)
+  {
+    if (seconds_ != nullptr)
+      start_ = std::chrono::steady_clock::now();
+  }
+  ~ScopedTimer()
+  {
+    if (seconds_ != nullptr)
+      *seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  }
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+  ScopedTimer(ScopedTimer&&) = delete;
+  ScopedTimer& operator=(ScopedTimer&&) = delete;
+
+private:
+  double* seconds_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/** The counter of term i in times, which holds one per term, or nullptr if times is */
+static double* termTime(double* times, std::size_t i) { return (times != nullptr) ? times + i : nullptr; }
+
+static DblVec evaluateCosts(const std::vector<Cost::Ptr>& costs,
+                            const DblVec& x,
+                            const Deadline* deadline = nullptr,
+                            double* times = nullptr)
 {
   DblVec out(costs.size());
   for (size_t i = 0; i < costs.size(); ++i)
   {
+    if (deadline != nullptr)
+      deadline->check();
+    ScopedTimer timer(termTime(times, i));
     out[i] = costs[i]->value(x);
   }
   return out;
 }
-static DblVec evaluateConstraintViols(const std::vector<Constraint::Ptr>& constraints, const DblVec& x)
+static DblVec evaluateConstraintViols(const std::vector<Constraint::Ptr>& constraints,
+                                     const DblVec& x,
+                                     const Deadline* deadline = nullptr,
+                                     double* times = nullptr)
 {
   DblVec out(constraints.size());
   for (size_t i = 0; i < constraints.size(); ++i)
   {
+    if (deadline != nullptr)
+      deadline->check();
+    ScopedTimer timer(termTime(times, i));
     out[i] = constraints[i]->violation(x);
   }
   return out;
 }
+/**
+ * Evaluates the costs and constraint violations at x. With a pool every term is a separate work item;
+ * each value is stored in its own slot, so the results are bit-identical to the serial evaluation.
+ * If the deadline expires before all terms are evaluated, TimeLimitExceeded is thrown and the outputs are unchanged.
+ * If times is not null, the evaluation time of every cost and then every constraint is added to it.
+ */
+static void evaluateCostsAndConstraintViols(const std::vector<Cost::Ptr>& costs,
+                                            const std::vector<Constraint::Ptr>& constraints,
+                                            const DblVec& x,
+                                            DblVec& cost_vals,
+                                            DblVec& cnt_viols,
+                                            ThreadPool* pool = nullptr,
+                                            const Deadline* deadline = nullptr,
+                                            double* times = nullptr)
+{
+  DblVec new_cost_vals, new_cnt_viols;
+  if (pool == nullptr)
+  {
+    new_cost_vals = evaluateCosts(costs, x, deadline, times);
+    new_cnt_viols = evaluateConstraintViols(constraints, x, deadline, termTime(times, costs.size()));
+  }
+  else
+  {
+    new_cost_vals.resize(costs.size());
+    new_cnt_viols.resize(constraints.size());
+    pool->parallelFor(costs.size() + constraints.size(), [&](std::size_t i) {
+      if (deadline != nullptr)
+        deadline->check();
+      ScopedTimer timer(termTime(times, i));
+      if (i < costs.size())
+        new_cost_vals[i] = costs[i]->value(x);
+      else
+        new_cnt_viols[i - costs.size()] = constraints[i - costs.size()]->violation(x);
+    });
+  }
+  cost_vals.swap(new_cost_vals);
+  cnt_viols.swap(new_cnt_viols);
+}
 static std::vector<ConvexObjective::Ptr> convexifyCosts(const std::vector<Cost::Ptr>& costs,
                                                         const DblVec& x,
-                                                        Model* model)
+                                                        Model* model,
+                                                        ThreadPool* pool = nullptr,
+                                                        const Deadline* deadline = nullptr,
+                                                        double* times = nullptr)
 {
+  if (pool != nullptr)
+  {
+    // Each term records its auxiliary variables in its own DeferredModel. They are committed to
+    // the shared model in term order, so the result does not depend on the thread schedule.
+    std::vector<std::unique_ptr<DeferredModel>> deferred(costs.size());
+    std::vector<ConvexObjective::Ptr> out(costs.size());
+    pool->parallelFor(costs.size(), [&](std::size_t i) {
+      if (deadline != nullptr)
+        deadline->check();
+      deferred[i].reset(new DeferredModel());
+      ScopedTimer timer(termTime(times, i));
+      out[i] = costs[i]->convex(x, deferred[i].get());
+    });
+    for (size_t i = 0; i < costs.size(); ++i)
+      deferred[i]->commit(model, *out[i]);
+    return out;
+  }
+
   std::vector<ConvexObjective::Ptr> out(costs.size());
   for (size_t i = 0; i < costs.size(); ++i)
   {
+    if (deadline != nullptr)
+      deadline->check();
+    ScopedTimer timer(termTime(times, i));
     out[i] = costs[i]->convex(x, model);
   }
   return out;
 }
 static std::vector<ConvexConstraints::Ptr> convexifyConstraints(const std::vector<Constraint::Ptr>& cnts,
                                                                 const DblVec& x,
-                                                                Model* model)
+                                                                Model* model,
+                                                                ThreadPool* pool = nullptr,
+                                                                const Deadline* deadline = nullptr,
+                                                                double* times = nullptr)
 {
+  if (pool != nullptr)
+  {
+    std::vector<std::unique_ptr<DeferredModel>> deferred(cnts.size());
+    std::vector<ConvexConstraints::Ptr> out(cnts.size());
+    pool->parallelFor(cnts.size(), [&](std::size_t i) {
+      if (deadline != nullptr)
+        deadline->check();
+      deferred[i].reset(new DeferredModel());
+      ScopedTimer timer(termTime(times, i));
+      out[i] = cnts[i]->convex(x, deferred[i].get());
+    });
+    for (size_t i = 0; i < cnts.size(); ++i)
+      deferred[i]->commit(model, *out[i]);
+    return out;
+  }
+
   std::vector<ConvexConstraints::Ptr> out(cnts.size());
   for (size_t i = 0; i < cnts.size(); ++i)
   {
+    if (deadline != nullptr)
+      deadline->check();
+    ScopedTimer timer(termTime(times, i));
     out[i] = cnts[i]->convex(x, model);
   }
   return out;
@@ -142,6 +319,22 @@ std::vector<ConvexObjective::Ptr> cntsToCosts(const std::vector<ConvexConstraint
   return out;
 }
 
+/**
+ * Changes the penalty coefficients of the objectives created by cntsToCosts() in place. Their objectives are sums of
+ * slack variables that all carry the coefficient of their constraint, so the result is identical to calling
+ * cntsToCosts() again with the new coefficients.
+ */
+static void setCntCostCoeffs(const std::vector<ConvexObjective::Ptr>& cnt_costs, const std::vector<double>& err_coeffs)
+{
+  assert(cnt_costs.size() == err_coeffs.size());
+  for (std::size_t c = 0; c < cnt_costs.size(); ++c)
+  {
+    assert(cnt_costs[c]->quad_.size() == 0);
+    for (double& coeff : cnt_costs[c]->quad_.affexpr.coeffs)
+      coeff = err_coeffs[c];
+  }
+}
+
 void Optimizer::addCallback(const Callback& cb) { callbacks_.push_back(cb); }
 void Optimizer::callCallbacks()
 {
@@ -178,8 +371,21 @@ BasicTrustRegionSQPParameters::BasicTrustRegionSQPParameters()
   initial_merit_error_coeff = 10;
   inflate_constraints_individually = true;
   trust_box_size = 1e-1;
+  num_threads = 1;
+  num_eval_threads = 1;
+  num_trust_box_candidates = 1;
+  use_filter = false;
+  filter_max_violation = 1e-2;
+  filter_violation_ratio = 2;
+  profile = false;
   log_results = false;
   log_dir = "/tmp";
+  log_file = "trajopt_iterations.bin";
+  qp_capture_file = "";
+  inexact_qp = false;
+  max_qp_tolerance = 1e-2;
+  min_qp_tolerance = 0;
+  qp_tolerance_ratio = 1e-1;
 }
 
 BasicTrustRegionSQP::BasicTrustRegionSQP(OptProb::Ptr prob) { setProblem(std::move(prob)); }
@@ -189,42 +395,78 @@ void BasicTrustRegionSQP::setProblem(OptProb::Ptr prob)
   model_ = prob->getModel();
 }
 
+void BasicTrustRegionSQP::updateThreadPool(ThreadPool::Ptr& pool, int num_threads)
+{
+  if (num_threads > 1)
+  {
+    if (!pool || pool->size() != static_cast<std::size_t>(num_threads))
+      pool = std::make_shared<ThreadPool>(static_cast<std::size_t>(num_threads));
+  }
+  else
+  {
+    pool.reset();
+  }
+}
+
 void BasicTrustRegionSQP::adjustTrustRegion(double ratio) { param_.trust_box_size *= ratio; }
 void BasicTrustRegionSQP::setTrustBoxConstraints(const DblVec& x)
 {
-  const VarVector& vars = prob_->getVars();
-  assert(vars.size() == x.size());
+  setTrustBoxConstraints(x, *model_, param_.trust_box_size);
+}
+void BasicTrustRegionSQP::setTrustBoxConstraints(const DblVec& x, Model& model, double trust_box_size) const
+{
+  const VarVector& prob_vars = prob_->getVars();
+  assert(prob_vars.size() == x.size());
   const DblVec &lb = prob_->getLowerBounds(), ub = prob_->getUpperBounds();
   DblVec lbtrust(x.size()), ubtrust(x.size());
   for (size_t i = 0; i < x.size(); ++i)
   {
-    lbtrust[i] = fmax(x[i] - param_.trust_box_size, lb[i]);
-    ubtrust[i] = fmin(x[i] + param_.trust_box_size, ub[i]);
+    lbtrust[i] = fmax(x[i] - trust_box_size, lb[i]);
+    ubtrust[i] = fmin(x[i] + trust_box_size, ub[i]);
   }
-  model_->setVarBounds(vars, lbtrust, ubtrust);
+  if (&model == model_.get())
+  {
+    model.setVarBounds(prob_vars, lbtrust, ubtrust);
+    return;
+  }
+  // A copy has the same layout, but its own variables
+  const VarVector model_vars = model.getVars();
+  VarVector vars(prob_vars.size());
+  for (size_t i = 0; i < prob_vars.size(); ++i)
+    vars[i] = model_vars[prob_vars[i].var_rep->index];
+  model.setVarBounds(vars, lbtrust, ubtrust);
 }
 
-#if 0
-struct MultiCritFilter {
+struct MultiCritFilter
+{
   /**
    * Checks if you're making an improvement on a multidimensional objective
    * Given a set of past error vectors, the improvement is defined as
    * min_{olderrvec in past_err_vecs} | olderrvec - errvec |^+
    */
-  vector<DblVec> errvecs;
-  double improvement(const DblVec& errvec) {
-    double leastImprovement=INFINITY;
-    for (const DblVec& olderrvec : errvecs) {
-      double improvement=0;
-      for (int i=0; i < errvec.size(); ++i) improvement += pospart(olderrvec[i] - errvec[i]);
+  std::vector<DblVec> errvecs;
+  double improvement(const DblVec& errvec) const
+  {
+    double leastImprovement = INFINITY;
+    for (const DblVec& olderrvec : errvecs)
+    {
+      double improvement = 0;
+      for (std::size_t i = 0; i < errvec.size(); ++i)
+        improvement += pospart(olderrvec[i] - errvec[i]);
       leastImprovement = fmin(leastImprovement, improvement);
     }
     return leastImprovement;
   }
-  void insert(const DblVec& x) {errvecs.push_back(x);}
-  bool empty() {return errvecs.size() > 0;}
+  void insert(const DblVec& x) { errvecs.push_back(x); }
+  void clear() { errvecs.clear(); }
+  bool empty() const { return errvecs.empty(); }
 };
-#endif
+
+/** The error vector of an iterate for the filter. Its entries add up to the merit. */
+static DblVec filterErrVec(const DblVec& cost_vals, const DblVec& cnt_viols, const DblVec& merit_error_coeffs)
+{
+  return { vecSum(cost_vals), vecDot(cnt_viols, merit_error_coeffs) };
+}
 
 BasicTrustRegionSQPResults::BasicTrustRegionSQPResults(std::vector<std::string> var_names,
                                                        std::vector<std::string> cost_names,
@@ -255,7 +497,10 @@ void BasicTrustRegionSQPResults::update(const OptResults& prev_opt_results,
                                         const std::vector<ConvexObjective::Ptr>& cnt_cost_models,
                                         const std::vector<Constraint::Ptr>& constraints,
                                         const std::vector<Cost::Ptr>& costs,
-                                        std::vector<double> merit_error_coeffs)
+                                        std::vector<double> merit_error_coeffs,
+                                        ThreadPool* pool,
+                                        const Deadline* deadline,
+                                        double* term_eval_times)
 {
   this->merit_error_coeffs = merit_error_coeffs;
   model_var_vals = model.getVarValues(model.getVars());
@@ -279,8 +524,8 @@ void BasicTrustRegionSQPResults::update(const OptResults& prev_opt_results,
 
   old_cost_vals = prev_opt_results.cost_vals;
   old_cnt_viols = prev_opt_results.cnt_viols;
-  new_cost_vals = evaluateCosts(costs, new_x);
-  new_cnt_viols = evaluateConstraintViols(constraints, new_x);
+  evaluateCostsAndConstraintViols(
+      costs, constraints, new_x, new_cost_vals, new_cnt_viols, pool, deadline, term_eval_times);
 
   old_merit = vecSum(old_cost_vals) + vecDot(old_cnt_viols, merit_error_coeffs);
   model_merit = vecSum(model_cost_vals) + vecDot(model_cnt_viols, merit_error_coeffs);
@@ -558,17 +803,40 @@ OptStatus BasicTrustRegionSQP::optimize()
   std::vector<double> merit_error_coeffs(constraints.size(), param_.initial_merit_error_coeff);
   BasicTrustRegionSQPResults iteration_results(var_names, cost_names, cnt_names);
 
-  std::FILE* log_solver_stream = nullptr;
-  std::FILE* log_vars_stream = nullptr;
-  std::FILE* log_costs_stream = nullptr;
-  std::FILE* log_constraints_stream = nullptr;
+  // Written on a background thread, see IterationLogWriter
+  std::unique_ptr<IterationLogWriter> iteration_log;
   if (param_.log_results || util::GetLogLevel() >= util::LevelDebug)
   {
-    log_solver_stream = std::fopen((param_.log_dir + "/trajopt_solver.log").c_str(), "w");
-    log_vars_stream = std::fopen((param_.log_dir + "/trajopt_vars.log").c_str(), "w");
-    log_costs_stream = std::fopen((param_.log_dir + "/trajopt_costs.log").c_str(), "w");
-    log_constraints_stream = std::fopen((param_.log_dir + "/trajopt_constraints.log").c_str(), "w");
+    try
+    {
+      iteration_log = std::make_unique<IterationLogWriter>(
+          param_.log_dir + "/" + param_.log_file, var_names, cost_names, cnt_names);
+    }
+    catch (const std::exception& e)
+    {
+      LOG_ERROR("not logging iterations: %s", e.what());
+    }
+  }
+
+  std::unique_ptr<QPCaptureWriter> qp_capture;
+  if (!param_.qp_capture_file.empty())
+  {
+    try
+    {
+      qp_capture = std::make_unique<QPCaptureWriter>(param_.qp_capture_file);
+    }
+    catch (const std::exception& e)
+    {
+      LOG_ERROR("not capturing QPs: %s", e.what());
+    }
   }
+  auto captureQP = [&](const Model& model) {
+    if (!qp_capture)
+      return;
+    QPData qp;
+    if (model.exportQP(qp))
+      qp_capture->write(qp);
+  };
 
   if (results_.x.empty())
     PRINT_AND_THROW("you forgot to initialize!");
@@ -577,227 +845,628 @@ OptStatus BasicTrustRegionSQP::optimize()
 
   results_.x = prob_->getClosestFeasiblePoint(results_.x);
 
+  updateThreadPool(thread_pool_, param_.num_threads);
+  updateThreadPool(eval_thread_pool_, param_.num_eval_threads);
+  updateThreadPool(trust_box_thread_pool_, param_.num_trust_box_candidates);
+
   assert(results_.x.size() == prob_->getVars().size());
   assert(!prob_->getCosts().empty() || !constraints.empty());
 
   OptStatus retval = INVALID;
 
-  for (int merit_increases = 0; merit_increases < param_.max_merit_coeff_increases; ++merit_increases)
-  { /* merit adjustment loop */
-    for (int iter = 1;; ++iter)
-    { /* sqp loop */
-      callCallbacks();
-
-      LOG_DEBUG("current iterate: %s", CSTR(results_.x));
-      LOG_INFO("iteration %i", iter);
-
-      // speedup: if you just evaluated the cost when doing the line search, use
-      // that
-      if (results_.cost_vals.empty() && results_.cnt_viols.empty())
-      {  // only happens on the first iteration
-        results_.cnt_viols = evaluateConstraintViols(constraints, results_.x);
-        results_.cost_vals = evaluateCosts(prob_->getCosts(), results_.x);
-        assert(results_.n_func_evals == 0);
-        ++results_.n_func_evals;
-      }
-
-      // DblVec new_cnt_viols = evaluateConstraintViols(constraints, results_.x);
-      // DblVec new_cost_vals = evaluateCosts(prob_->getCosts(), results_.x);
-      // cout << "costs" << endl;
-      // for (int i=0; i < new_cnt_viols.size(); ++i) {
-      //   cout << cnt_names[i] << " " << new_cnt_viols[i] -
-      //   results_.cnt_viols[i] << endl;
-      // }
-      // for (int i=0; i < new_cost_vals.size(); ++i) {
-      //   cout << cost_names[i] << " " << new_cost_vals[i] -
-      //   results_.cost_vals[i] << endl;
-      // }
-
-      std::vector<ConvexObjective::Ptr> cost_models = convexifyCosts(prob_->getCosts(), results_.x, model_.get());
-      std::vector<ConvexConstraints::Ptr> cnt_models = convexifyConstraints(constraints, results_.x, model_.get());
-      std::vector<ConvexObjective::Ptr> cnt_cost_models = cntsToCosts(cnt_models, merit_error_coeffs, model_.get());
-      model_->update();
-      for (ConvexObjective::Ptr& cost : cost_models)
-        cost->addConstraintsToModel();
-      for (ConvexObjective::Ptr& cost : cnt_cost_models)
-        cost->addConstraintsToModel();
-      model_->update();
-      QuadExpr objective;
-      for (ConvexObjective::Ptr& co : cost_models)
-        exprInc(objective, co->quad_);
-      for (ConvexObjective::Ptr& co : cnt_cost_models)
-        exprInc(objective, co->quad_);
-
-      //    objective = cleanupExpr(objective);
-      model_->setObjective(objective);
-
-      //    if (logging::filter() >= IPI_LEVEL_DEBUG) {
-      //      DblVec model_cost_vals;
-      //      for (ConvexObjectivePtr& cost : cost_models) {
-      //        model_cost_vals.push_back(cost->value(x));
-      //      }
-      //      LOG_DEBUG("model costs %s should equalcosts  %s",
-      //      printer(model_cost_vals), printer(cost_vals));
-      //    }
-
-      while (param_.trust_box_size >= param_.min_trust_box_size)
-      {
-        setTrustBoxConstraints(results_.x);
-        CvxOptStatus status = model_->optimize();
+  // The feasible iterate with the lowest cost so far. If the time limit is hit at an infeasible iterate, it is returned
+  // instead. The current iterate has the lowest merit so far unless the filter accepted a step, but it need not be
+  // feasible.
+  const Deadline deadline(param_.max_time);
+  OptResults best_feasible;
+  auto recordIfFeasible = [&]() {
+    if (!results_.cnt_viols.empty() && vecMax(results_.cnt_viols) >= param_.cnt_tolerance)
+      return;
+    if (best_feasible.x.empty() || vecSum(results_.cost_vals) < vecSum(best_feasible.cost_vals))
+    {
+      best_feasible.x = results_.x;
+      best_feasible.cost_vals = results_.cost_vals;
+      best_feasible.cnt_viols = results_.cnt_viols;
+    }
+  };
+
+  // The convexification is kept across penalty increases. They do not move the iterate, so only the penalty
+  // coefficients need to be updated before the next QP.
+  std::vector<ConvexObjective::Ptr> cost_models;
+  std::vector<ConvexConstraints::Ptr> cnt_models;
+  std::vector<ConvexObjective::Ptr> cnt_cost_models;
+  DblVec convexified_x;
+  // Merges the terms of the convexified costs into the QP objective, reusing its memory across iterations
+  ExprAccumulator objective;
+  // Copies of model_ for the smaller trust region candidates. They hold the constraints of the current
+  // convexification, so from one round to the next only their bounds and objective are updated.
+  std::vector<Model::Ptr> candidate_models;
+
+  // Without profiling, phase stays null and so do the counters of all timers
+  OptProfile& profile = results_.profile;
+  profile.clear();
+  OptProfile::PhaseTimes outside_iterations;
+  OptProfile::PhaseTimes* phase = nullptr;  // the times of the current iteration
+  const std::size_t n_terms = prob_->getCosts().size() + constraints.size();
+  DblVec term_convexify_times, term_eval_times;
+  std::vector<CacheStats> initial_cache_stats;
+  if (param_.profile)
+  {
+    phase = &outside_iterations;
+    term_convexify_times.assign(n_terms, 0);
+    term_eval_times.assign(n_terms, 0);
+    for (const Cost::Ptr& cost : prob_->getCosts())
+      initial_cache_stats.push_back(cost->getCacheStats());
+    for (const Constraint::Ptr& cnt : constraints)
+      initial_cache_stats.push_back(cnt->getCacheStats());
+  }
+  double* const cost_convexify_times = param_.profile ? term_convexify_times.data() : nullptr;
+  double* const cnt_convexify_times = termTime(cost_convexify_times, prob_->getCosts().size());
+  double* const eval_times = param_.profile ? term_eval_times.data() : nullptr;
+  auto recordQPSize = [&](const Model& model) {
+    if (!param_.profile)
+      return;
+    const ModelSize size = model.getSize();
+    ModelSize& peak = profile.peak_qp_size;
+    peak.num_vars = std::max(peak.num_vars, size.num_vars);
+    peak.num_cnts = std::max(peak.num_cnts, size.num_cnts);
+    peak.cnt_nonzeros = std::max(peak.cnt_nonzeros, size.cnt_nonzeros);
+    peak.objective_nonzeros = std::max(peak.objective_nonzeros, size.objective_nonzeros);
+  };
+
+  // Results of the speculative solves for several trust region sizes, largest first
+  std::vector<BasicTrustRegionSQPResults> candidate_results;
+  if (trust_box_thread_pool_)
+  {
+    candidate_results.reserve(static_cast<std::size_t>(param_.num_trust_box_candidates));
+    for (int i = 0; i < param_.num_trust_box_candidates; ++i)
+      candidate_results.emplace_back(var_names, cost_names, cnt_names);
+  }
 
-        ++results_.n_qp_solves;
-        if (status != CVX_SOLVED)
+  auto writeLogs = [&](const BasicTrustRegionSQPResults& results) {
+    if (iteration_log)
+      iteration_log->push(results);
+  };
+
+  // Past iterates a step must improve on to be accepted by the filter, see BasicTrustRegionSQPParameters::use_filter
+  MultiCritFilter filter;
+  // The lowest constraint violation of the iterates so far, it bounds the violation of the steps the filter accepts
+  double best_violation = INFINITY;
+  auto meritAccepts = [&](const BasicTrustRegionSQPResults& results) {
+    return !(results.exact_merit_improve < 0 || results.merit_improve_ratio < param_.improve_ratio_threshold);
+  };
+  auto filterAccepts = [&](const BasicTrustRegionSQPResults& results) {
+    if (!param_.use_filter)
+      return false;
+    best_violation = fmin(best_violation, vecSum(results.old_cnt_viols));
+    const double envelope = fmax(param_.filter_max_violation, param_.filter_violation_ratio * best_violation);
+    if (vecSum(results.new_cnt_viols) > envelope)
+      return false;
+    const DblVec errvec = filterErrVec(results.new_cost_vals, results.new_cnt_viols, results.merit_error_coeffs);
+    MultiCritFilter current;
+    current.insert(filterErrVec(results.old_cost_vals, results.old_cnt_viols, results.merit_error_coeffs));
+    const double required = param_.improve_ratio_threshold * results.approx_merit_improve;
+    return current.improvement(errvec) >= required && filter.improvement(errvec) >= required;
+  };
+  // A step only the filter accepts may increase the merit, so the iterate it leaves must not be returned to
+  auto addToFilter = [&](const BasicTrustRegionSQPResults& results) {
+    LOG_INFO("merit function rejected the step, but the filter accepted it");
+    filter.insert(filterErrVec(results.old_cost_vals, results.old_cnt_viols, results.merit_error_coeffs));
+  };
+
+  // The accuracy the QPs are solved to, see BasicTrustRegionSQPParameters::inexact_qp
+  double qp_tolerance = param_.min_qp_tolerance;
+  auto setQPTolerance = [&](Model& model) {
+    if (param_.inexact_qp)
+      model.setToleranceHint(qp_tolerance);
+  };
+  auto solvedAccurately = [&]() { return !param_.inexact_qp || qp_tolerance <= param_.min_qp_tolerance; };
+  // The tolerance only tightens, as the predicted improvement gets smaller
+  auto tightenQPTolerance = [&](const BasicTrustRegionSQPResults& results) {
+    if (!param_.inexact_qp)
+      return;
+    const double improve_frac =
+        results.approx_merit_improve / std::fmax(std::fabs(results.old_merit), std::numeric_limits<double>::min());
+    qp_tolerance =
+        std::fmax(param_.min_qp_tolerance, std::fmin(qp_tolerance, param_.qp_tolerance_ratio * improve_frac));
+  };
+  auto improvementIsSmall = [&](const BasicTrustRegionSQPResults& results) {
+    return results.approx_merit_improve < param_.min_approx_improve ||
+           results.approx_merit_improve / results.old_merit < param_.min_approx_improve_frac;
+  };
+
+  try
+  {
+    for (int merit_increases = 0; merit_increases < param_.max_merit_coeff_increases; ++merit_increases)
+    { /* merit adjustment loop */
+      if (param_.inexact_qp)
+        qp_tolerance = param_.max_qp_tolerance;
+      for (int iter = 1;; ++iter)
+      { /* sqp loop */
+        if (param_.profile)
         {
-          LOG_ERROR("convex solver failed! set TRAJOPT_LOG_THRESH=DEBUG to see "
-                    "solver output. saving model to /tmp/fail.lp and IIS to "
-                    "/tmp/fail.ilp");
-          model_->writeToFile("/tmp/fail.lp");
-          model_->writeToFile("/tmp/fail.ilp");
-          retval = OPT_FAILED;
-          goto cleanup;
+          profile.iterations.emplace_back();
+          phase = &profile.iterations.back();
+        }
+        {
+          ScopedTimer timer(phase ? &phase->callbacks : nullptr);
+          callCallbacks();
+        }
+        deadline.check();
+
+        LOG_DEBUG("current iterate: %s", CSTR(results_.x));
+        LOG_INFO("iteration %i", iter);
+
+        // speedup: if you just evaluated the cost when doing the line search, use
+        // that
+        if (results_.cost_vals.empty() && results_.cnt_viols.empty())
+        {  // only happens on the first iteration
+          ScopedTimer timer(phase ? &phase->evaluate : nullptr);
+          evaluateCostsAndConstraintViols(prob_->getCosts(),
+                                          constraints,
+                                          results_.x,
+                                          results_.cost_vals,
+                                          results_.cnt_viols,
+                                          eval_thread_pool_.get(),
+                                          &deadline,
+                                          eval_times);
+          assert(results_.n_func_evals == 0);
+          ++results_.n_func_evals;
+          recordIfFeasible();
         }
 
-        iteration_results.update(results_,
-                                 *model_,
-                                 cost_models,
-                                 cnt_models,
-                                 cnt_cost_models,
-                                 constraints,
-                                 prob_->getCosts(),
-                                 merit_error_coeffs);
-        if (SUPER_DEBUG_MODE)
+        // DblVec new_cnt_viols = evaluateConstraintViols(constraints, results_.x);
+        // DblVec new_cost_vals = evaluateCosts(prob_->getCosts(), results_.x);
+        // cout << "costs" << endl;
+        // for (int i=0; i < new_cnt_viols.size(); ++i) {
+        //   cout << cnt_names[i] << " " << new_cnt_viols[i] -
+        //   results_.cnt_viols[i] << endl;
+        // }
+        // for (int i=0; i < new_cost_vals.size(); ++i) {
+        //   cout << cost_names[i] << " " << new_cost_vals[i] -
+        //   results_.cost_vals[i] << endl;
+        // }
+
+        if (!convexified_x.empty() && convexified_x == results_.x)
         {
-          model_->writeToFile("trajopt_model.txt");
-          iteration_results.printRaw();
+          LOG_DEBUG("iterate did not change, reusing its convexification");
+          ScopedTimer timer(phase ? &phase->model_build : nullptr);
+          setCntCostCoeffs(cnt_cost_models, merit_error_coeffs);
         }
+        else
+        {
+          {
+            ScopedTimer timer(phase ? &phase->convexify : nullptr);
+            // Release the previous convexification first, so its auxiliary variables can be reused
+            convexified_x.clear();
+            candidate_models.clear();
+            cnt_cost_models.clear();
+            cnt_models.clear();
+            cost_models.clear();
+            cost_models = convexifyCosts(prob_->getCosts(),
+                                         results_.x,
+                                         model_.get(),
+                                         thread_pool_.get(),
+                                         &deadline,
+                                         cost_convexify_times);
+            cnt_models = convexifyConstraints(
+                constraints, results_.x, model_.get(), thread_pool_.get(), &deadline, cnt_convexify_times);
+            cnt_cost_models = cntsToCosts(cnt_models, merit_error_coeffs, model_.get());
+          }
+          // The constraints take over the places of the ones removed with the previous convexification, so the size
+          // of the QP stays the same and the backends do not have to compact
+          ScopedTimer timer(phase ? &phase->model_build : nullptr);
+          for (ConvexObjective::Ptr& cost : cost_models)
+            cost->addConstraintsToModel();
+          for (ConvexObjective::Ptr& cost : cnt_cost_models)
+            cost->addConstraintsToModel();
+          model_->update();
+          convexified_x = results_.x;
+        }
+        {
+          ScopedTimer timer(phase ? &phase->model_build : nullptr);
+          objective.clear();
+          for (ConvexObjective::Ptr& co : cost_models)
+            objective.add(co->quad_);
+          for (ConvexObjective::Ptr& co : cnt_cost_models)
+            objective.add(co->quad_);
+          model_->setObjective(objective.expr());
+          if (!candidate_models.empty())
+          {
+            const CompactQuadExpr compact(objective.expr());
+            for (const Model::Ptr& candidate : candidate_models)
+              candidate->setObjective(toQuadExpr(compact, candidate->getVars()));
+          }
+        }
+
+        //    if (logging::filter() >= IPI_LEVEL_DEBUG) {
+        //      DblVec model_cost_vals;
+        //      for (ConvexObjectivePtr& cost : cost_models) {
+        //        model_cost_vals.push_back(cost->value(x));
+        //      }
+        //      LOG_DEBUG("model costs %s should equalcosts  %s",
+        //      printer(model_cost_vals), printer(cost_vals));
+        //    }
 
-        if (param_.log_results || util::GetLogLevel() >= util::LevelDebug)
+        while (param_.trust_box_size >= param_.min_trust_box_size)
         {
-          if (log_solver_stream != nullptr)
-            iteration_results.writeSolver(log_solver_stream, results_.n_func_evals == 1);
+          deadline.check();
 
-          if (log_vars_stream != nullptr)
-            iteration_results.writeVars(log_vars_stream, results_.n_func_evals == 1);
+          // The box sizes the serial loop would try next, if the step keeps getting rejected
+          DblVec box_sizes;
+          if (trust_box_thread_pool_)
+          {
+            for (double size = param_.trust_box_size;
+                 box_sizes.size() < candidate_results.size() && size >= param_.min_trust_box_size;
+                 size *= param_.trust_shrink_ratio)
+              box_sizes.push_back(size);
+          }
 
-          if (log_costs_stream != nullptr)
-            iteration_results.writeCosts(log_costs_stream, results_.n_func_evals == 1);
+          if (box_sizes.size() > 1)
+          {
+            // The largest box is solved on model_ itself, so a rejected round can warm start from its solution
+            std::vector<Model::Ptr> models(box_sizes.size(), model_);
+            for (std::size_t i = 1; i < models.size(); ++i)
+            {
+              if (candidate_models.size() < i)
+              {
+                ScopedTimer timer(phase ? &phase->model_build : nullptr);
+                Model::Ptr copy = model_->clone();
+                if (!copy)
+                {
+                  LOG_WARN("the convex solver can not copy its model, trying one trust region size at a time");
+                  trust_box_thread_pool_.reset();
+                  box_sizes.clear();
+                  break;
+                }
+                candidate_models.push_back(std::move(copy));
+              }
+              models[i] = candidate_models[i - 1];
+            }
+            if (!box_sizes.empty())
+            {
+              std::vector<CvxOptStatus> statuses(box_sizes.size(), CVX_FAILED);
+              std::vector<OptProfile::PhaseTimes> candidate_times(box_sizes.size());
+              // As in the serial loop, the QPs are captured as they are handed to the solver. They are written in
+              // the order of the candidates once all are solved.
+              std::vector<QPData> candidate_qps(qp_capture ? box_sizes.size() : 0);
+              std::vector<char> exported(candidate_qps.size(), false);
+              trust_box_thread_pool_->parallelFor(box_sizes.size(), [&](std::size_t i) {
+                deadline.check();
+                OptProfile::PhaseTimes* times = (phase != nullptr) ? &candidate_times[i] : nullptr;
+                {
+                  ScopedTimer timer(times ? &times->model_build : nullptr);
+                  setTrustBoxConstraints(results_.x, *models[i], box_sizes[i]);
+                }
+                if (qp_capture)
+                  exported[i] = models[i]->exportQP(candidate_qps[i]);
+                {
+                  ScopedTimer timer(times ? &times->qp_solve : nullptr);
+                  models[i]->setTimeLimit(deadline.remaining());
+                  setQPTolerance(*models[i]);
+                  statuses[i] = models[i]->optimize();
+                }
+              });
+              results_.n_qp_solves += static_cast<int>(box_sizes.size());
+              for (std::size_t i = 0; i < candidate_qps.size(); ++i)
+              {
+                if (exported[i])
+                  qp_capture->write(candidate_qps[i]);
+              }
+              if (phase != nullptr)
+              {
+                for (const OptProfile::PhaseTimes& times : candidate_times)
+                  *phase += times;
+              }
+              recordQPSize(*model_);
+
+              // Go through the candidates in the order the serial loop would have, and take the accepted step with
+              // the lowest merit among those before the first one that converges or fails
+              std::size_t n_solved = 0;
+              std::size_t best = box_sizes.size();
+              bool solve_accurately = false;
+              for (std::size_t i = 0; i < box_sizes.size(); ++i)
+              {
+                if (statuses[i] != CVX_SOLVED)
+                {
+                  if (i > 0)
+                    break;
+                  deadline.check();  // the solver may have stopped because of the time limit
+                  LOG_ERROR("convex solver failed! set TRAJOPT_LOG_THRESH=DEBUG to see "
+                            "solver output. saving model to /tmp/fail.lp and IIS to "
+                            "/tmp/fail.ilp");
+                  model_->writeToFile("/tmp/fail.lp");
+                  model_->writeToFile("/tmp/fail.ilp");
+                  retval = OPT_FAILED;
+                  goto cleanup;
+                }
+
+                // The exact terms are evaluated one candidate at a time, since a term need not be re-entrant (e.g.
+                // the collision terms share their contact manager and cache). As in the serial loop, the evaluation
+                // stops at the first accepted candidate, so an accepted full step costs one evaluation.
+                {
+                  ScopedTimer timer(phase ? &phase->evaluate : nullptr);
+                  candidate_results[i].update(results_,
+                                              *models[i],
+                                              cost_models,
+                                              cnt_models,
+                                              cnt_cost_models,
+                                              constraints,
+                                              prob_->getCosts(),
+                                              merit_error_coeffs,
+                                              eval_thread_pool_.get(),
+                                              &deadline,
+                                              eval_times);
+                }
+                const BasicTrustRegionSQPResults& candidate = candidate_results[i];
+                writeLogs(candidate);
+                ++results_.n_func_evals;
+                n_solved = i + 1;
+
+                if (candidate.approx_merit_improve < -1e-5)
+                {
+                  LOG_ERROR("approximate merit function got worse (%.3e). "
+                            "(convexification is probably wrong to zeroth order)",
+                            candidate.approx_merit_improve);
+                }
+
+                if (improvementIsSmall(candidate))
+                {
+                  if (!solvedAccurately())
+                  {
+                    solve_accurately = true;
+                    break;
+                  }
+                  LOG_INFO("converged because improvement was small (%.3e)", candidate.approx_merit_improve);
+                  retval = OPT_CONVERGED;
+                  goto penaltyadjustment;
+                }
+                tightenQPTolerance(candidate);
+
+                if (!meritAccepts(candidate) && !filterAccepts(candidate))
+                  continue;
+                best = i;
+                break;
+              }
+
+              if (best < box_sizes.size())
+              {
+                if (!meritAccepts(candidate_results[best]))
+                  addToFilter(candidate_results[best]);
+                results_.x = candidate_results[best].new_x;
+                results_.cost_vals = candidate_results[best].new_cost_vals;
+                results_.cnt_viols = candidate_results[best].new_cnt_viols;
+                recordIfFeasible();
+                // The model was good enough for this box, so that is where the next round starts
+                param_.trust_box_size = box_sizes[best];
+                adjustTrustRegion(param_.trust_expand_ratio);
+                LOG_INFO("expanded trust region. new box size: %.4f", param_.trust_box_size);
+                break;
+              }
+
+              if (solve_accurately)
+              {
+                LOG_INFO("improvement was small for QPs solved to a tolerance of %.1e, solving them accurately",
+                         qp_tolerance);
+                qp_tolerance = param_.min_qp_tolerance;
+                model_->setWarmStart(candidate_results[0].model_var_vals, models[0]->getDualValues());
+                continue;
+              }
+
+              param_.trust_box_size = box_sizes[n_solved - 1];
+              adjustTrustRegion(param_.trust_shrink_ratio);
+              LOG_INFO("shrunk trust region. new box size: %.4f", param_.trust_box_size);
+              // Start the next round from the solution of the smallest box that was solved
+              model_->setWarmStart(candidate_results[n_solved - 1].model_var_vals,
+                                   models[n_solved - 1]->getDualValues());
+              continue;
+            }
+          }
 
-          if (log_constraints_stream != nullptr)
-            iteration_results.writeConstraints(log_constraints_stream, results_.n_func_evals == 1);
-        }
+          {
+            ScopedTimer timer(phase ? &phase->model_build : nullptr);
+            setTrustBoxConstraints(results_.x);
+          }
+          captureQP(*model_);
+          CvxOptStatus status;
+          {
+            ScopedTimer timer(phase ? &phase->qp_solve : nullptr);
+            model_->setTimeLimit(deadline.remaining());
+            setQPTolerance(*model_);
+            status = model_->optimize();
+          }
+          recordQPSize(*model_);
 
-        ++results_.n_func_evals;
+          ++results_.n_qp_solves;
+          if (status != CVX_SOLVED)
+          {
+            deadline.check();  // the solver may have stopped because of the time limit
+            LOG_ERROR("convex solver failed! set TRAJOPT_LOG_THRESH=DEBUG to see "
+                      "solver output. saving model to /tmp/fail.lp and IIS to "
+                      "/tmp/fail.ilp");
+            model_->writeToFile("/tmp/fail.lp");
+            model_->writeToFile("/tmp/fail.ilp");
+            retval = OPT_FAILED;
+            goto cleanup;
+          }
 
-        if (iteration_results.approx_merit_improve < -1e-5)
-        {
-          LOG_ERROR("approximate merit function got worse (%.3e). "
-                    "(convexification is probably wrong to zeroth order)",
-                    iteration_results.approx_merit_improve);
-        }
+          {
+            ScopedTimer timer(phase ? &phase->evaluate : nullptr);
+            iteration_results.update(results_,
+                                     *model_,
+                                     cost_models,
+                                     cnt_models,
+                                     cnt_cost_models,
+                                     constraints,
+                                     prob_->getCosts(),
+                                     merit_error_coeffs,
+                                     eval_thread_pool_.get(),
+                                     &deadline,
+                                     eval_times);
+          }
+          if (SUPER_DEBUG_MODE)
+          {
+            model_->writeToFile("trajopt_model.txt");
+            iteration_results.printRaw();
+          }
 
-        if (iteration_results.approx_merit_improve < param_.min_approx_improve)
-        {
-          LOG_INFO("converged because improvement was small (%.3e < %.3e)",
-                   iteration_results.approx_merit_improve,
-                   param_.min_approx_improve);
-          retval = OPT_CONVERGED;
-          goto penaltyadjustment;
+          writeLogs(iteration_results);
+          ++results_.n_func_evals;
+
+          if (iteration_results.approx_merit_improve < -1e-5)
+          {
+            LOG_ERROR("approximate merit function got worse (%.3e). "
+                      "(convexification is probably wrong to zeroth order)",
+                      iteration_results.approx_merit_improve);
+          }
+
+          if (!solvedAccurately() && improvementIsSmall(iteration_results))
+          {
+            LOG_INFO("improvement was small for a QP solved to a tolerance of %.1e, solving it accurately",
+                     qp_tolerance);
+            qp_tolerance = param_.min_qp_tolerance;
+            model_->setWarmStart(iteration_results.model_var_vals, model_->getDualValues());
+            continue;
+          }
+          tightenQPTolerance(iteration_results);
+
+          if (iteration_results.approx_merit_improve < param_.min_approx_improve)
+          {
+            LOG_INFO("converged because improvement was small (%.3e < %.3e)",
+                     iteration_results.approx_merit_improve,
+                     param_.min_approx_improve);
+            retval = OPT_CONVERGED;
+            goto penaltyadjustment;
+          }
+
+          if (iteration_results.approx_merit_improve / iteration_results.old_merit < param_.min_approx_improve_frac)
+          {
+            LOG_INFO("converged because improvement ratio was small (%.3e < %.3e)",
+                     iteration_results.approx_merit_improve / iteration_results.old_merit,
+                     param_.min_approx_improve_frac);
+            retval = OPT_CONVERGED;
+            goto penaltyadjustment;
+          }
+          else if (!meritAccepts(iteration_results) && !filterAccepts(iteration_results))
+          {
+            adjustTrustRegion(param_.trust_shrink_ratio);
+            LOG_INFO("shrunk trust region. new box size: %.4f", param_.trust_box_size);
+            // Only the trust region bounds change, so start the next QP from this solution
+            model_->setWarmStart(iteration_results.model_var_vals, model_->getDualValues());
+          }
+          else
+          {
+            if (!meritAccepts(iteration_results))
+              addToFilter(iteration_results);
+            results_.x = iteration_results.new_x;
+            results_.cost_vals = iteration_results.new_cost_vals;
+            results_.cnt_viols = iteration_results.new_cnt_viols;
+            recordIfFeasible();
+            adjustTrustRegion(param_.trust_expand_ratio);
+            LOG_INFO("expanded trust region. new box size: %.4f", param_.trust_box_size);
+            break;
+          }
         }
 
-        if (iteration_results.approx_merit_improve / iteration_results.old_merit < param_.min_approx_improve_frac)
+        if (param_.trust_box_size < param_.min_trust_box_size)
         {
-          LOG_INFO("converged because improvement ratio was small (%.3e < %.3e)",
-                   iteration_results.approx_merit_improve / iteration_results.old_merit,
-                   param_.min_approx_improve_frac);
+          LOG_INFO("converged because trust region is tiny");
           retval = OPT_CONVERGED;
           goto penaltyadjustment;
         }
-        else if (iteration_results.exact_merit_improve < 0 ||
-                 iteration_results.merit_improve_ratio < param_.improve_ratio_threshold)
+        else if (iter >= param_.max_iter)
         {
-          adjustTrustRegion(param_.trust_shrink_ratio);
-          LOG_INFO("shrunk trust region. new box size: %.4f", param_.trust_box_size);
-        }
-        else
-        {
-          results_.x = iteration_results.new_x;
-          results_.cost_vals = iteration_results.new_cost_vals;
-          results_.cnt_viols = iteration_results.new_cnt_viols;
-          adjustTrustRegion(param_.trust_expand_ratio);
-          LOG_INFO("expanded trust region. new box size: %.4f", param_.trust_box_size);
-          break;
-        }
-      }
+          LOG_INFO("iteration limit");
+          retval = OPT_SCO_ITERATION_LIMIT;
 
-      if (param_.trust_box_size < param_.min_trust_box_size)
-      {
-        LOG_INFO("converged because trust region is tiny");
-        retval = OPT_CONVERGED;
-        goto penaltyadjustment;
-      }
-      else if (iter >= param_.max_iter)
-      {
-        LOG_INFO("iteration limit");
-        retval = OPT_SCO_ITERATION_LIMIT;
+          if (results_.cnt_viols.empty() || vecMax(results_.cnt_viols) < param_.cnt_tolerance)
+          {
+            retval = OPT_CONVERGED;
+            if (!results_.cnt_viols.empty())
+              LOG_INFO("woo-hoo! constraints are satisfied (to tolerance %.2e)", param_.cnt_tolerance);
+          }
 
-        if (results_.cnt_viols.empty() || vecMax(results_.cnt_viols) < param_.cnt_tolerance)
-        {
-          retval = OPT_CONVERGED;
-          if (!results_.cnt_viols.empty())
-            LOG_INFO("woo-hoo! constraints are satisfied (to tolerance %.2e)", param_.cnt_tolerance);
+          goto cleanup;
         }
+      } /* sqp loop */
 
-        goto cleanup;
+    penaltyadjustment:
+      if (results_.cnt_viols.empty() || vecMax(results_.cnt_viols) < param_.cnt_tolerance)
+      {
+        if (!results_.cnt_viols.empty())
+          LOG_INFO("woo-hoo! constraints are satisfied (to tolerance %.2e)", param_.cnt_tolerance);
+        goto cleanup;  // NOLINT
       }
-    } /* sqp loop */
-
-  penaltyadjustment:
-    if (results_.cnt_viols.empty() || vecMax(results_.cnt_viols) < param_.cnt_tolerance)
-    {
-      if (!results_.cnt_viols.empty())
-        LOG_INFO("woo-hoo! constraints are satisfied (to tolerance %.2e)", param_.cnt_tolerance);
-      goto cleanup;  // NOLINT
-    }
-    else
-    {
-      if (param_.inflate_constraints_individually)
+      else
       {
-        assert(results_.cnt_viols.size() == merit_error_coeffs.size());
-        for (std::size_t idx = 0; idx < results_.cnt_viols.size(); idx++)
+        if (param_.inflate_constraints_individually)
         {
-          if (results_.cnt_viols[idx] > param_.cnt_tolerance)
+          assert(results_.cnt_viols.size() == merit_error_coeffs.size());
+          for (std::size_t idx = 0; idx < results_.cnt_viols.size(); idx++)
           {
-            LOG_INFO("Not all constraints are satisfied. Increasing constraint penalties for %s", CSTR(cnt_names[idx]));
-            merit_error_coeffs[idx] *= param_.merit_coeff_increase_ratio;
+            if (results_.cnt_viols[idx] > param_.cnt_tolerance)
+            {
+              LOG_INFO("Not all constraints are satisfied. Increasing constraint penalties for %s",
+                       CSTR(cnt_names[idx]));
+              merit_error_coeffs[idx] *= param_.merit_coeff_increase_ratio;
+            }
           }
         }
+        else
+        {
+          LOG_INFO("Not all constraints are satisfied. Increasing constraint penalties uniformly");
+          for (auto& merit_error_coeff : merit_error_coeffs)
+            merit_error_coeff *= param_.merit_coeff_increase_ratio;
+        }
+        LOG_INFO("New merit_error_coeffs: %s", CSTR(merit_error_coeffs));
+        // The error vectors in the filter are penalized with the old coeffs
+        filter.clear();
+        param_.trust_box_size =
+            fmax(param_.trust_box_size, param_.min_trust_box_size / param_.trust_shrink_ratio * 1.5);
       }
-      else
-      {
-        LOG_INFO("Not all constraints are satisfied. Increasing constraint penalties uniformly");
-        for (auto& merit_error_coeff : merit_error_coeffs)
-          merit_error_coeff *= param_.merit_coeff_increase_ratio;
-      }
-      LOG_INFO("New merit_error_coeffs: %s", CSTR(merit_error_coeffs));
-      param_.trust_box_size = fmax(param_.trust_box_size, param_.min_trust_box_size / param_.trust_shrink_ratio * 1.5);
+    } /* merit adjustment loop */
+    retval = OPT_PENALTY_ITERATION_LIMIT;
+    LOG_INFO("optimization couldn't satisfy all constraints");
+  }
+  catch (const TimeLimitExceeded&)
+  {
+    LOG_INFO("time limit of %.3f seconds exceeded", param_.max_time);
+    retval = OPT_TIME_LIMIT;
+    if (!best_feasible.x.empty() && !results_.cnt_viols.empty() && vecMax(results_.cnt_viols) >= param_.cnt_tolerance)
+    {
+      LOG_INFO("returning the best iterate that satisfies the constraints");
+      results_.x = best_feasible.x;
+      results_.cost_vals = best_feasible.cost_vals;
+      results_.cnt_viols = best_feasible.cnt_viols;
     }
-  } /* merit adjustment loop */
-  retval = OPT_PENALTY_ITERATION_LIMIT;
-  LOG_INFO("optimization couldn't satisfy all constraints");
+  }
 
 cleanup:
   assert(retval != INVALID && "should never happen");
   results_.status = retval;
   results_.total_cost = vecSum(results_.cost_vals);
   LOG_INFO("\n==================\n%s==================", CSTR(results_));
-  callCallbacks();
+  {
+    ScopedTimer timer(param_.profile ? &outside_iterations.callbacks : nullptr);
+    callCallbacks();
+  }
 
-  if (param_.log_results || util::GetLogLevel() >= util::LevelDebug)
+  if (param_.profile)
   {
-    std::fclose(log_solver_stream);
-    std::fclose(log_vars_stream);
-    std::fclose(log_costs_stream);
-    std::fclose(log_constraints_stream);
+    profile.total = outside_iterations;
+    for (const OptProfile::PhaseTimes& times : profile.iterations)
+      profile.total += times;
+    const std::size_t n_costs = cost_names.size();
+    for (std::size_t i = 0; i < n_terms; ++i)
+    {
+      OptProfile::TermProfile& term = profile.terms[(i < n_costs) ? cost_names[i] : cnt_names[i - n_costs]];
+      term.convexify_time += term_convexify_times[i];
+      term.evaluate_time += term_eval_times[i];
+      const CacheStats stats =
+          (i < n_costs) ? prob_->getCosts()[i]->getCacheStats() : constraints[i - n_costs]->getCacheStats();
+      term.cache.hits += stats.hits - initial_cache_stats[i].hits;
+      term.cache.misses += stats.misses - initial_cache_stats[i].misses;
+    }
   }
 
   return retval;
@@ -1,21 +1,28 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <constants.h>
+#include <algorithm>
 #include <cmath>
 #include <Eigen/SparseCore>
 #include <fstream>
 #include <csignal>
 #include <iomanip>
+#include <numeric>
+#include <tuple>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+#include <trajopt_sco/compact_expr.hpp>
 #include <trajopt_sco/osqp_interface.hpp>
-#include <trajopt_sco/solver_utils.hpp>
+#include <trajopt_sco/qp_capture.hpp>
 #include <trajopt_utils/logging.hpp>
 #include <trajopt_utils/stl_to_string.hpp>
 
 namespace sco
 {
 const double OSQP_INFINITY = std::numeric_limits<double>::infinity();
+/** The default accuracy, less accurate than OSQP's own, but polished */
+const double OSQP_EPS_ABS = 1e-4;
+const double OSQP_EPS_REL = 1e-6;
 const bool SUPER_DEBUG_MODE = false;
 
 Model::Ptr createOSQPModel()
@@ -30,8 +37,8 @@ OSQPModel::OSQPModel() : P_(nullptr), A_(nullptr)
   // see https://osqp.org/docs/interfaces/solver_settings.html#solver-settings
   osqp_set_default_settings(&osqp_settings_);
   // tuning parameters to be less accurate, but add a polishing step
-  osqp_settings_.eps_abs = 1e-4;
-  osqp_settings_.eps_rel = 1e-6;
+  osqp_settings_.eps_abs = OSQP_EPS_ABS;
+  osqp_settings_.eps_rel = OSQP_EPS_REL;
   osqp_settings_.max_iter = 8192;
   osqp_settings_.polish = 1;
   osqp_settings_.verbose = SUPER_DEBUG_MODE;
@@ -46,27 +53,22 @@ OSQPModel::~OSQPModel()
 
 Var OSQPModel::addVar(const std::string& name)
 {
-  vars_.push_back(new VarRep(vars_.size(), name, this));
+  vars_dirty_ = true;
+  vars_.push_back(var_arena_.create(vars_.size(), name, this));
   lbs_.push_back(-OSQP_INFINITY);
   ubs_.push_back(OSQP_INFINITY);
   return vars_.back();
 }
 
-Cnt OSQPModel::addEqCnt(const AffExpr& expr, const std::string& /*name*/)
+Cnt OSQPModel::addCnt(const AffExpr& expr, ConstraintType type)
 {
-  cnts_.push_back(new CntRep(cnts_.size(), this));
-  cnt_exprs_.push_back(expr);
-  cnt_types_.push_back(EQ);
-  return cnts_.back();
+  constraints_dirty_ = true;
+  return addCntSlot(cnts_, cnt_exprs_, cnt_types_, expr, type);
 }
 
-Cnt OSQPModel::addIneqCnt(const AffExpr& expr, const std::string& /*name*/)
-{
-  cnts_.push_back(new CntRep(cnts_.size(), this));
-  cnt_exprs_.push_back(expr);
-  cnt_types_.push_back(INEQ);
-  return cnts_.back();
-}
+Cnt OSQPModel::addEqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, EQ); }
+
+Cnt OSQPModel::addIneqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, INEQ); }
 
 Cnt OSQPModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
 {
@@ -74,99 +76,260 @@ Cnt OSQPModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
   return Cnt{};
 }
 
-void OSQPModel::removeVars(const VarVector& vars)
+void OSQPModel::removeVars(const VarVector& vars) { queueRemovals(vars); }
+
+void OSQPModel::removeCnts(const CntVector& cnts) { queueRemovals(cnts); }
+
+/**
+ * @brief Builds the CSC sparsity pattern of a matrix from the (row, column) entries of its terms
+ * @param rows Row of each term
+ * @param cols Column of each term
+ * @param n_cols Number of columns of the matrix
+ * @param row_indices Row indices of the nonzeros, CSC format
+ * @param column_pointers Column pointers, CSC format
+ * @param slots Index of the nonzero each term is accumulated into
+ */
+static void buildPattern(const std::vector<c_int>& rows,
+                         const std::vector<c_int>& cols,
+                         std::size_t n_cols,
+                         std::vector<c_int>& row_indices,
+                         std::vector<c_int>& column_pointers,
+                         std::vector<std::size_t>& slots)
 {
-  SizeTVec inds;
-  vars2inds(vars, inds);
-  for (auto& var : vars)
-    var.var_rep->removed = true;
+  std::vector<std::size_t> order(rows.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&rows, &cols](std::size_t a, std::size_t b) {
+    return std::tie(cols[a], rows[a]) < std::tie(cols[b], rows[b]);
+  });
+
+  row_indices.clear();
+  column_pointers.assign(n_cols + 1, 0);
+  for (std::size_t k = 0; k < order.size(); ++k)
+  {
+    const std::size_t t = order[k];
+    if (k == 0 || rows[t] != rows[order[k - 1]] || cols[t] != cols[order[k - 1]])
+    {
+      row_indices.push_back(rows[t]);
+      ++column_pointers[static_cast<std::size_t>(cols[t]) + 1];
+    }
+    slots[t] = row_indices.size() - 1;
+  }
+  std::partial_sum(column_pointers.begin(), column_pointers.end(), column_pointers.begin());
 }
 
-void OSQPModel::removeCnts(const CntVector& cnts)
+bool OSQPModel::updateObjective()
 {
-  SizeTVec inds;
-  cnts2inds(cnts, inds);
-  for (auto& cnt : cnts)
-    cnt.cnt_rep->removed = true;
+  const size_t n = vars_.size();
+  osqp_data_.n = static_cast<c_int>(n);
+
+  // The values the workspace was last updated with are kept to detect whether P changed
+  P_csc_data_.swap(P_csc_data_old_);
+  bool pattern_changed = false;
+  if (!scatterObjective())
+  {
+    pattern_changed = buildObjectivePattern();
+    scatterObjective();
+  }
+  P_->x = P_csc_data_.data();
+
+  q_.resize(static_cast<Eigen::Index>(n));
+  q_.setZero();
+  for (size_t i = 0; i < objective_.affexpr.size(); ++i)
+    q_[static_cast<Eigen::Index>(objective_.affexpr.vars[i].var_rep->index)] += objective_.affexpr.coeffs[i];
+
+  osqp_data_.P = P_.get();
+  osqp_data_.q = q_.data();
+
+  if (SUPER_DEBUG_MODE)
+  {
+    Eigen::Map<const Eigen::SparseMatrix<double, Eigen::ColMajor, c_int>> P_map(osqp_data_.n,
+                                                                                osqp_data_.n,
+                                                                                P_->p[P_->n],
+                                                                                P_->p,
+                                                                                P_->i,
+                                                                                P_->x);
+    std::cout << std::fixed << std::setprecision(3) << "OSQP Hessian:\n" << P_map.toDense() << std::endl;
+    std::cout << std::fixed << std::setprecision(3) << "OSQP Gradient: " << q_.transpose() << std::endl;
+  }
+  return pattern_changed;
+}
+
+bool OSQPModel::scatterObjective()
+{
+  const size_t n_terms = objective_.size();
+  if (P_ == nullptr || P_->n != osqp_data_.n || P_term_slots_.size() != n_terms)
+    return false;
+
+  P_csc_data_.assign(P_row_indices_.size(), 0.);
+  for (size_t i = 0; i < n_terms; ++i)
+  {
+    const auto r = static_cast<c_int>(objective_.vars1[i].var_rep->index);
+    const auto c = static_cast<c_int>(objective_.vars2[i].var_rep->index);
+    if (std::min(r, c) != P_term_rows_[i] || std::max(r, c) != P_term_cols_[i])
+      return false;
+    // The objective is 1/2*x'Px, so diagonal terms are doubled while off-diagonal terms only fill the upper
+    // triangle and are mirrored by OSQP
+    P_csc_data_[P_term_slots_[i]] += (r == c) ? 2 * objective_.coeffs[i] : objective_.coeffs[i];
+  }
+  return true;
 }
 
-void OSQPModel::updateObjective()
+bool OSQPModel::buildObjectivePattern()
 {
   const size_t n = vars_.size();
-  osqp_data_.n = static_cast<c_int>(n);
+  const size_t n_terms = objective_.size();
 
-  Eigen::SparseMatrix<double> sm;
-  exprToEigen(objective_, sm, q_, static_cast<int>(n), true);
+  P_term_rows_.resize(n_terms);
+  P_term_cols_.resize(n_terms);
+  P_term_slots_.resize(n_terms);
+  for (size_t i = 0; i < n_terms; ++i)
+  {
+    const size_t r = objective_.vars1[i].var_rep->index;
+    const size_t c = objective_.vars2[i].var_rep->index;
+    if (r >= n || c >= n)
+      PRINT_AND_THROW("Variable index in objective is out of bounds");
+    P_term_rows_[i] = static_cast<c_int>(std::min(r, c));
+    P_term_cols_[i] = static_cast<c_int>(std::max(r, c));
+  }
 
-  // Copy triangular upper into empty matrix
-  Eigen::SparseMatrix<double> triangular_sm;
-  triangular_sm = sm.triangularView<Eigen::Upper>();
-  if (SUPER_DEBUG_MODE)
-    std::cout << std::fixed << std::setprecision(3) << "OSQP Hessian:\n" << triangular_sm.toDense() << std::endl;
-  eigenToCSC(triangular_sm, P_row_indices_, P_column_pointers_, P_csc_data_);
+  std::vector<c_int> old_row_indices, old_column_pointers;
+  old_row_indices.swap(P_row_indices_);
+  old_column_pointers.swap(P_column_pointers_);
+  buildPattern(P_term_rows_, P_term_cols_, n, P_row_indices_, P_column_pointers_, P_term_slots_);
 
   P_.reset(csc_matrix(osqp_data_.n,
                       osqp_data_.n,
-                      static_cast<c_int>(P_csc_data_.size()),
+                      static_cast<c_int>(P_row_indices_.size()),
                       P_csc_data_.data(),
                       P_row_indices_.data(),
                       P_column_pointers_.data()));
+  return P_row_indices_ != old_row_indices || P_column_pointers_ != old_column_pointers;
+}
 
-  osqp_data_.P = P_.get();
-  osqp_data_.q = q_.data();
+bool OSQPModel::updateConstraints()
+{
+  const size_t n = vars_.size();
+  const size_t m = cnts_.size();
+  osqp_data_.m = static_cast<c_int>(m) + static_cast<c_int>(n);
+
+  // The values the workspace was last updated with are kept to detect whether A changed
+  A_csc_data_.swap(A_csc_data_old_);
+  bool pattern_changed = false;
+  if (!scatterConstraints())
+  {
+    pattern_changed = buildConstraintPattern();
+    scatterConstraints();
+  }
+  A_->x = A_csc_data_.data();
+  osqp_data_.A = A_.get();
 
   if (SUPER_DEBUG_MODE)
   {
-    Eigen::Map<Eigen::VectorXd> q_vec(q_.data(), q_.size());
-    std::cout << std::fixed << std::setprecision(3) << "OSQP Gradient: " << q_vec.transpose() << std::endl;
+    Eigen::Map<const Eigen::SparseMatrix<double, Eigen::ColMajor, c_int>> A_map(osqp_data_.m,
+                                                                                osqp_data_.n,
+                                                                                A_->p[A_->n],
+                                                                                A_->p,
+                                                                                A_->i,
+                                                                                A_->x);
+    std::cout << std::fixed << std::setprecision(3) << "OSQP Constraint Matrix:\n" << A_map.toDense() << std::endl;
   }
+
+  updateBounds();
+  return pattern_changed;
 }
 
-void OSQPModel::updateConstraints()
+bool OSQPModel::scatterConstraints()
 {
   const size_t n = vars_.size();
   const size_t m = cnts_.size();
-  const auto n_int = static_cast<int>(n);
-  const auto m_int = static_cast<int>(m);
+  if (A_ == nullptr || A_->m != osqp_data_.m || A_->n != osqp_data_.n || A_row_starts_.size() != m + 1)
+    return false;
 
-  osqp_data_.m = static_cast<c_int>(m) + static_cast<c_int>(n);
+  A_csc_data_.assign(A_row_indices_.size(), 0.);
+  for (size_t i_cnt = 0; i_cnt < m; ++i_cnt)
+  {
+    const AffExpr& expr = cnt_exprs_[i_cnt];
+    const size_t start = A_row_starts_[i_cnt];
+    if (A_row_starts_[i_cnt + 1] - start != expr.size())
+      return false;
+    for (size_t i = 0; i < expr.size(); ++i)
+    {
+      if (static_cast<c_int>(expr.vars[i].var_rep->index) != A_term_cols_[start + i])
+        return false;
+      A_csc_data_[A_term_slots_[start + i]] += expr.coeffs[i];
+    }
+  }
+  // Variable bounds are the identity rows below the constraints
+  for (size_t i_bnd = 0; i_bnd < n; ++i_bnd)
+    A_csc_data_[A_term_slots_[A_row_starts_[m] + i_bnd]] = 1.;
+  return true;
+}
 
-  Eigen::SparseMatrix<double> sm;
-  Eigen::VectorXd v;
-  exprToEigen(cnt_exprs_, sm, v, static_cast<int>(n));
-  Eigen::SparseMatrix<double> sm_e(n_int + m_int, n_int);
-  Eigen::SparseMatrix<double> sm_e2 = sm;
-  sm.conservativeResize(m_int + n_int, Eigen::NoChange_t(n));
+bool OSQPModel::buildConstraintPattern()
+{
+  const size_t n = vars_.size();
+  const size_t m = cnts_.size();
 
-  l_.clear();
-  l_.resize(m + n, -OSQP_INFINITY);
-  u_.clear();
-  u_.resize(m + n, OSQP_INFINITY);
+  A_row_starts_.resize(m + 1);
+  A_row_starts_[0] = 0;
+  for (size_t i_cnt = 0; i_cnt < m; ++i_cnt)
+    A_row_starts_[i_cnt + 1] = A_row_starts_[i_cnt] + cnt_exprs_[i_cnt].size();
 
-  for (std::size_t i_cnt = 0; i_cnt < m; ++i_cnt)
+  const size_t n_terms = A_row_starts_[m] + n;
+  std::vector<c_int> term_rows(n_terms);
+  A_term_cols_.resize(n_terms);
+  A_term_slots_.resize(n_terms);
+  for (size_t i_cnt = 0; i_cnt < m; ++i_cnt)
   {
-    l_[i_cnt] = (cnt_types_[i_cnt] == INEQ) ? -OSQP_INFINITY : v[static_cast<Eigen::Index>(i_cnt)];
-    u_[i_cnt] = v[static_cast<Eigen::Index>(i_cnt)];
+    const AffExpr& expr = cnt_exprs_[i_cnt];
+    for (size_t i = 0; i < expr.size(); ++i)
+    {
+      const size_t c = expr.vars[i].var_rep->index;
+      if (c >= n)
+        PRINT_AND_THROW("Variable index in constraint is out of bounds");
+      term_rows[A_row_starts_[i_cnt] + i] = static_cast<c_int>(i_cnt);
+      A_term_cols_[A_row_starts_[i_cnt] + i] = static_cast<c_int>(c);
+    }
   }
-
-  for (std::size_t i_bnd = 0; i_bnd < n; ++i_bnd)
+  for (size_t i_bnd = 0; i_bnd < n; ++i_bnd)
   {
-    l_[i_bnd + m] = fmax(lbs_[i_bnd], -OSQP_INFINITY);
-    u_[i_bnd + m] = fmin(ubs_[i_bnd], OSQP_INFINITY);
-    sm.insert(static_cast<Eigen::Index>(i_bnd + m), static_cast<Eigen::Index>(i_bnd)) = 1.;
+    term_rows[A_row_starts_[m] + i_bnd] = static_cast<c_int>(m + i_bnd);
+    A_term_cols_[A_row_starts_[m] + i_bnd] = static_cast<c_int>(i_bnd);
   }
-  if (SUPER_DEBUG_MODE)
-    std::cout << std::fixed << std::setprecision(3) << "OSQP Constraint Matrix:\n" << sm.toDense() << std::endl;
-  eigenToCSC(sm, A_row_indices_, A_column_pointers_, A_csc_data_);
+
+  std::vector<c_int> old_row_indices, old_column_pointers;
+  old_row_indices.swap(A_row_indices_);
+  old_column_pointers.swap(A_column_pointers_);
+  buildPattern(term_rows, A_term_cols_, n, A_row_indices_, A_column_pointers_, A_term_slots_);
 
   A_.reset(csc_matrix(osqp_data_.m,
                       osqp_data_.n,
-                      static_cast<c_int>(A_csc_data_.size()),
+                      static_cast<c_int>(A_row_indices_.size()),
                       A_csc_data_.data(),
                       A_row_indices_.data(),
                       A_column_pointers_.data()));
+  return A_row_indices_ != old_row_indices || A_column_pointers_ != old_column_pointers;
+}
 
-  osqp_data_.A = A_.get();
+void OSQPModel::updateBounds()
+{
+  const size_t n = vars_.size();
+  const size_t m = cnts_.size();
+
+  l_.resize(m + n);
+  u_.resize(m + n);
+  for (std::size_t i_cnt = 0; i_cnt < m; ++i_cnt)
+  {
+    const double rhs = -cnt_exprs_[i_cnt].constant;
+    l_[i_cnt] = (cnt_types_[i_cnt] == INEQ) ? -OSQP_INFINITY : rhs;
+    u_[i_cnt] = rhs;
+  }
+
+  for (std::size_t i_bnd = 0; i_bnd < n; ++i_bnd)
+  {
+    l_[i_bnd + m] = fmax(lbs_[i_bnd], -OSQP_INFINITY);
+    u_[i_bnd + m] = fmin(ubs_[i_bnd], OSQP_INFINITY);
+  }
 
   if (SUPER_DEBUG_MODE)
   {
@@ -181,64 +344,73 @@ void OSQPModel::updateConstraints()
 
 void OSQPModel::createOrUpdateSolver()
 {
-  updateObjective();
-  updateConstraints();
-
-  // TODO atm we are not updating the workspace, but recreating it each time.
-  // In the future, we will checking sparsity did not change and update instead
-  if (osqp_workspace_ != nullptr)
-    osqp_cleanup(osqp_workspace_);
+  // Changing the number of variables changes the size of every matrix, so it always needs a new workspace
+  bool setup = osqp_workspace_ == nullptr || vars_dirty_;
+  bool P_changed = false, A_changed = false;
+  if (objective_dirty_ || setup)
+  {
+    setup |= updateObjective();
+    P_changed = P_csc_data_ != P_csc_data_old_;
+  }
+  if (constraints_dirty_ || setup)
+  {
+    setup |= updateConstraints();
+    A_changed = A_csc_data_ != A_csc_data_old_;
+  }
+  else if (bounds_dirty_)
+  {
+    updateBounds();
+  }
 
-  // Setup workspace - this should be called only once
-  auto ret = osqp_setup(&osqp_workspace_, &osqp_data_, &osqp_settings_);
-  if (ret)
+  // With an unchanged sparsity pattern the workspace is updated in place. New matrix values require a new
+  // factorization, so they are only passed on if they actually changed.
+  if (!setup)
   {
-    throw std::runtime_error("Could not initialize OSQP: error " + std::to_string(ret));
+    const auto P_nnz = static_cast<c_int>(P_csc_data_.size());
+    const auto A_nnz = static_cast<c_int>(A_csc_data_.size());
+    bool ok = true;
+    if (P_changed)
+      ok = ok && osqp_update_P(osqp_workspace_, P_csc_data_.data(), OSQP_NULL, P_nnz) == 0;
+    if (objective_dirty_)
+      ok = ok && osqp_update_lin_cost(osqp_workspace_, q_.data()) == 0;
+    if (A_changed)
+      ok = ok && osqp_update_A(osqp_workspace_, A_csc_data_.data(), OSQP_NULL, A_nnz) == 0;
+    if (constraints_dirty_ || bounds_dirty_)
+      ok = ok && osqp_update_bounds(osqp_workspace_, l_.data(), u_.data()) == 0;
+    // Fall back to a full setup if OSQP rejected one of the updates
+    setup = !ok;
   }
-}
 
-void OSQPModel::update()
-{
+  if (setup)
   {
-    std::size_t inew = 0;
-    for (std::size_t iold = 0; iold < vars_.size(); ++iold)
+    if (osqp_workspace_ != nullptr)
+      osqp_cleanup(osqp_workspace_);
+    osqp_workspace_ = nullptr;
+
+    auto ret = osqp_setup(&osqp_workspace_, &osqp_data_, &osqp_settings_);
+    if (ret)
     {
-      const Var& var = vars_[iold];
-      if (!var.var_rep->removed)
-      {
-        vars_[inew] = var;
-        lbs_[inew] = lbs_[iold];
-        ubs_[inew] = ubs_[iold];
-        var.var_rep->index = inew;
-        ++inew;
-      }
-      else
-        delete var.var_rep;
+      throw std::runtime_error("Could not initialize OSQP: error " + std::to_string(ret));
     }
-    vars_.resize(inew);
-    lbs_.resize(inew);
-    ubs_.resize(inew);
   }
+
+  vars_dirty_ = false;
+  objective_dirty_ = false;
+  constraints_dirty_ = false;
+  bounds_dirty_ = false;
+}
+
+void OSQPModel::update()
+{
+  SizeTVec kept;
+  if (commitVarRemovals(vars_, kept))
   {
-    std::size_t inew = 0;
-    for (std::size_t iold = 0; iold < cnts_.size(); ++iold)
-    {
-      const Cnt& cnt = cnts_[iold];
-      if (!cnt.cnt_rep->removed)
-      {
-        cnts_[inew] = cnt;
-        cnt_exprs_[inew] = cnt_exprs_[iold];
-        cnt_types_[inew] = cnt_types_[iold];
-        cnt.cnt_rep->index = inew;
-        ++inew;
-      }
-      else
-        delete cnt.cnt_rep;
-    }
-    cnts_.resize(inew);
-    cnt_exprs_.resize(inew);
-    cnt_types_.resize(inew);
+    keepEntries(lbs_, kept);
+    keepEntries(ubs_, kept);
+    vars_dirty_ = true;
   }
+  if (commitCntRemovals(cnt_exprs_, cnt_types_))
+    constraints_dirty_ = true;
 }
 
 void OSQPModel::setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper)
@@ -249,6 +421,7 @@ void OSQPModel::setVarBounds(const VarVector& vars, const DblVec& lower, const D
     lbs_[varind] = lower[i];
     ubs_[varind] = upper[i];
   }
+  bounds_dirty_ = true;
 }
 DblVec OSQPModel::getVarValues(const VarVector& vars) const
 {
@@ -264,8 +437,25 @@ DblVec OSQPModel::getVarValues(const VarVector& vars) const
 CvxOptStatus OSQPModel::optimize()
 {
   update();
+  if (needsCompaction())
+  {
+    compactCnts(cnts_, cnt_exprs_, cnt_types_);
+    constraints_dirty_ = true;
+  }
+  num_solved_cnts_ = cnts_.size();
   createOrUpdateSolver();
 
+  // A reused workspace starts from its previous solution, an explicit starting point replaces it
+  if (warm_primal_.size() == vars_.size())
+  {
+    if (warm_dual_.size() == l_.size())
+      osqp_warm_start(osqp_workspace_, warm_primal_.data(), warm_dual_.data());
+    else
+      osqp_warm_start_x(osqp_workspace_, warm_primal_.data());
+  }
+  warm_primal_.clear();
+  warm_dual_.clear();
+
   // Solve Problem
   const c_int retcode = osqp_solve(osqp_workspace_);
 
@@ -273,6 +463,7 @@ CvxOptStatus OSQPModel::optimize()
   {
     // opt += m_objective.affexpr.constant;
     solution_ = DblVec(osqp_workspace_->solution->x, osqp_workspace_->solution->x + vars_.size());
+    dual_solution_ = DblVec(osqp_workspace_->solution->y, osqp_workspace_->solution->y + l_.size());
 
     if (SUPER_DEBUG_MODE)
     {
@@ -289,11 +480,116 @@ CvxOptStatus OSQPModel::optimize()
   }
   return CVX_FAILED;
 }
-void OSQPModel::setObjective(const AffExpr& expr) { objective_.affexpr = expr; }
-void OSQPModel::setObjective(const QuadExpr& expr) { objective_ = expr; }
+void OSQPModel::setTimeLimit(double time_limit)
+{
+#ifdef PROFILING
+  // OSQP disables the limit if it is zero
+  osqp_settings_.time_limit = std::isfinite(time_limit) ? std::fmax(time_limit, 1e-6) : 0.0;
+  if (osqp_workspace_ != nullptr)
+    osqp_update_time_limit(osqp_workspace_, osqp_settings_.time_limit);
+#else
+  (void)time_limit;  // OSQP was built without timing support
+#endif
+}
+void OSQPModel::setToleranceHint(double tolerance)
+{
+  // The hint is relative, so only eps_rel follows it. Polishing only pays off once the SQP asks for the default
+  // accuracy.
+  osqp_settings_.eps_rel = std::fmax(tolerance, OSQP_EPS_REL);
+  osqp_settings_.polish = (tolerance <= OSQP_EPS_REL) ? 1 : 0;
+  if (osqp_workspace_ != nullptr)
+  {
+    osqp_update_eps_rel(osqp_workspace_, osqp_settings_.eps_rel);
+    osqp_update_polish(osqp_workspace_, osqp_settings_.polish);
+  }
+}
+void OSQPModel::setPrescaled(bool prescaled)
+{
+  const c_int scaling = prescaled ? 0 : SCALING;
+  if (osqp_settings_.scaling == scaling)
+    return;
+  osqp_settings_.scaling = scaling;
+  // The scaling is part of the setup, so the next optimize() sets up a new workspace
+  if (osqp_workspace_ != nullptr)
+    osqp_cleanup(osqp_workspace_);
+  osqp_workspace_ = nullptr;
+}
+void OSQPModel::setWarmStart(const DblVec& primal, const DblVec& dual)
+{
+  warm_primal_ = primal;
+  warm_dual_ = dual;
+}
+DblVec OSQPModel::getDualValues() const { return dual_solution_; }
+void OSQPModel::setObjective(const AffExpr& expr)
+{
+  objective_.affexpr = expr;
+  objective_dirty_ = true;
+}
+void OSQPModel::setObjective(const QuadExpr& expr)
+{
+  objective_ = expr;
+  objective_dirty_ = true;
+}
 
 VarVector OSQPModel::getVars() const { return vars_; }
 
+ModelSize OSQPModel::getSize() const
+{
+  ModelSize size;
+  size.num_vars = vars_.size();
+  size.num_cnts = cnts_.size() - free_cnt_slots_.size();
+  for (const AffExpr& expr : cnt_exprs_)
+    size.cnt_nonzeros += expr.size();
+  size.objective_nonzeros = objective_.size();
+  return size;
+}
+
+bool OSQPModel::exportQP(QPData& qp) const
+{
+  // The multipliers of the constraints come before the ones of the variable bounds
+  toQPData(vars_, lbs_, ubs_, objective_, cnt_exprs_, cnt_types_, free_cnt_slots_, qp, warm_dual_, 0);
+  qp.warm_primal = warm_primal_;
+  qp.dual_layout = ModelType::OSQP;
+  return true;
+}
+
+Model::Ptr OSQPModel::clone() const
+{
+  auto out = std::make_shared<OSQPModel>();
+  out->vars_.reserve(vars_.size());
+  for (const Var& var : vars_)
+  {
+    out->vars_.push_back(out->var_arena_.create(var.var_rep->index, var.var_rep->name, out.get()));
+    out->vars_.back().var_rep->removed = var.var_rep->removed;
+  }
+  out->cnts_.reserve(cnts_.size());
+  out->cnt_exprs_.reserve(cnts_.size());
+  for (std::size_t i = 0; i < cnts_.size(); ++i)
+  {
+    out->cnts_.push_back(out->cnt_arena_.create(i, out.get()));
+    out->cnts_.back().cnt_rep->removed = cnts_[i].cnt_rep->removed;
+    out->cnt_exprs_.push_back(toAffExpr(CompactAffExpr(cnt_exprs_[i]), out->vars_));
+  }
+  for (const Var& var : removed_vars_)
+    out->removed_vars_.push_back(out->vars_[var.var_rep->index]);
+  for (const Cnt& cnt : removed_cnts_)
+    out->removed_cnts_.push_back(out->cnts_[cnt.cnt_rep->index]);
+  out->copyFreeAuxVars(*this, out->vars_);
+
+  // The workspace is set up from scratch by the first optimize() of the copy
+  out->lbs_ = lbs_;
+  out->ubs_ = ubs_;
+  out->cnt_types_ = cnt_types_;
+  out->free_cnt_slots_ = free_cnt_slots_;
+  out->solution_ = solution_;
+  out->dual_solution_ = dual_solution_;
+  out->warm_primal_ = warm_primal_;
+  out->warm_dual_ = warm_dual_;
+  out->objective_ = toQuadExpr(CompactQuadExpr(objective_), out->vars_);
+  out->osqp_settings_ = osqp_settings_;
+  return out;
+}
+
 void OSQPModel::writeToFile(const std::string& fname) const
 {
   std::ofstream outStream(fname);
@@ -0,0 +1,597 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <limits>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/compact_expr.hpp>
+#include <trajopt_sco/presolve_model.hpp>
+#include <trajopt_sco/qp_capture.hpp>
+#include <trajopt_sco/solver_utils.hpp>
+#include <trajopt_utils/logging.hpp>
+
+namespace sco
+{
+const double PRESOLVE_INFINITY = std::numeric_limits<double>::infinity();
+/** How far a constraint that is left without variables may be violated before the QP is reported infeasible */
+const double PRESOLVE_FEASIBILITY_TOL = 1e-6;
+
+Model::Ptr createPresolveModel(ModelType model_type, const QPFeatures& features)
+{
+  Model::Ptr out(new PresolveModel(resolveModelType(model_type, features)));
+  return out;
+}
+
+PresolveModel::PresolveModel(ModelType inner_type)
+  : inner_type_(inner_type)
+  , inner_((inner_type == ModelType::AUTO_SOLVER) ? nullptr : createModel(inner_type))
+  , time_limit_(PRESOLVE_INFINITY)
+{
+}
+
+Var PresolveModel::addVar(const std::string& name)
+{
+  vars_.push_back(var_arena_.create(vars_.size(), name, this));
+  lbs_.push_back(-PRESOLVE_INFINITY);
+  ubs_.push_back(PRESOLVE_INFINITY);
+  inner_vars_.emplace_back();
+  return vars_.back();
+}
+
+Cnt PresolveModel::addCnt(const AffExpr& expr, ConstraintType type)
+{
+  structure_dirty_ = true;
+  return addCntSlot(cnts_, cnt_exprs_, cnt_types_, expr, type);
+}
+
+Cnt PresolveModel::addEqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, EQ); }
+
+Cnt PresolveModel::addIneqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, INEQ); }
+
+Cnt PresolveModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
+{
+  throw std::runtime_error("NOT IMPLEMENTED");
+}
+
+void PresolveModel::removeVars(const VarVector& vars) { queueRemovals(vars); }
+
+void PresolveModel::removeCnts(const CntVector& cnts) { queueRemovals(cnts); }
+
+void PresolveModel::update()
+{
+  VarVector removed_inner_vars;
+  for (const Var& var : removed_vars_)
+  {
+    const Var& inner_var = inner_vars_[var.var_rep->index];
+    if (inner_var.var_rep != nullptr)
+      removed_inner_vars.push_back(inner_var);
+  }
+
+  SizeTVec kept;
+  if (commitVarRemovals(vars_, kept))
+  {
+    keepEntries(lbs_, kept);
+    keepEntries(ubs_, kept);
+    keepEntries(inner_vars_, kept);
+    keepEntries(solution_, kept);
+    if (inner_ != nullptr)
+      inner_->removeVars(removed_inner_vars);
+    structure_dirty_ = true;
+  }
+  if (commitCntRemovals(cnt_exprs_, cnt_types_))
+    structure_dirty_ = true;
+}
+
+void PresolveModel::setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper)
+{
+  for (std::size_t i = 0; i < vars.size(); ++i)
+  {
+    const std::size_t varind = vars[i].var_rep->index;
+    lbs_[varind] = lower[i];
+    ubs_[varind] = upper[i];
+  }
+}
+
+DblVec PresolveModel::getVarValues(const VarVector& vars) const
+{
+  DblVec out(vars.size());
+  for (std::size_t i = 0; i < vars.size(); ++i)
+    out[i] = solution_[vars[i].var_rep->index];
+  return out;
+}
+
+void PresolveModel::findFixedVars(std::vector<bool>& fixed, DblVec& values, std::vector<bool>& dropped) const
+{
+  fixed.assign(vars_.size(), false);
+  values.assign(vars_.size(), 0);
+  // Removed constraints are kept as 0 <= 0 and never fix anything
+  dropped.assign(cnts_.size(), false);
+  if (!settings.remove_fixed_vars)
+    return;
+
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+  {
+    if (lbs_[i] == ubs_[i])
+    {
+      fixed[i] = true;
+      values[i] = lbs_[i];
+    }
+  }
+
+  // An equality on a single variable fixes it, which can leave another equality with a single variable
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (std::size_t i = 0; i < cnt_exprs_.size(); ++i)
+    {
+      if (dropped[i] || cnt_types_[i] != EQ)
+        continue;
+
+      const AffExpr& expr = cnt_exprs_[i];
+      double constant = expr.constant;
+      std::size_t var = vars_.size();
+      double coeff = 0;
+      bool single = true;
+      for (std::size_t j = 0; j < expr.size() && single; ++j)
+      {
+        const std::size_t k = expr.vars[j].var_rep->index;
+        if (fixed[k])
+          constant += expr.coeffs[j] * values[k];
+        else if (var == vars_.size() || var == k)
+        {
+          var = k;
+          coeff += expr.coeffs[j];
+        }
+        else
+          single = false;
+      }
+      if (!single || var == vars_.size() || coeff == 0)
+        continue;
+
+      // Leave a value outside of the bounds to the backend, which reports the problem as infeasible
+      const double value = -constant / coeff;
+      if (value < lbs_[var] - PRESOLVE_FEASIBILITY_TOL || value > ubs_[var] + PRESOLVE_FEASIBILITY_TOL)
+        continue;
+      fixed[var] = true;
+      values[var] = value;
+      dropped[i] = true;
+      changed = true;
+    }
+  }
+}
+
+QPFeatures PresolveModel::reducedFeatures(const std::vector<bool>& fixed, const std::vector<bool>& dropped) const
+{
+  QPFeatures features;
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+    if (!fixed[i])
+      ++features.num_vars;
+  std::vector<bool> is_free(cnts_.size(), false);
+  for (std::size_t slot : free_cnt_slots_)
+    is_free[slot] = true;
+  for (std::size_t i = 0; i < cnt_exprs_.size(); ++i)
+  {
+    if (is_free[i] || dropped[i])
+      continue;
+    std::size_t nonzeros = 0;
+    for (const Var& var : cnt_exprs_[i].vars)
+      if (!fixed[var.var_rep->index])
+        ++nonzeros;
+    if (nonzeros == 0)
+      continue;
+    features.cnt_nonzeros += nonzeros;
+    ++((cnt_types_[i] == EQ) ? features.num_eq_cnts : features.num_ineq_cnts);
+  }
+  return features;
+}
+
+AffExpr PresolveModel::substitute(const AffExpr& expr, const std::vector<bool>& fixed, const DblVec& values) const
+{
+  AffExpr out;
+  out.constant = expr.constant;
+  out.vars.reserve(expr.size());
+  out.coeffs.reserve(expr.size());
+  for (std::size_t j = 0; j < expr.size(); ++j)
+  {
+    const std::size_t k = expr.vars[j].var_rep->index;
+    if (fixed[k])
+    {
+      out.constant += expr.coeffs[j] * values[k];
+    }
+    else
+    {
+      out.vars.push_back(inner_vars_[k]);
+      out.coeffs.push_back(expr.coeffs[j]);
+    }
+  }
+  return out;
+}
+
+void PresolveModel::buildInner(const std::vector<bool>& fixed, const DblVec& values, const std::vector<bool>& dropped)
+{
+  // The backend keeps the variables that stay free, so it can warm start as long as the same ones are fixed
+  VarVector removed_inner_vars;
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+  {
+    if (fixed[i] && inner_vars_[i].var_rep != nullptr)
+    {
+      removed_inner_vars.push_back(inner_vars_[i]);
+      inner_vars_[i] = Var();
+    }
+  }
+  if (!removed_inner_vars.empty())
+  {
+    // The rows refer to the removed variables, so they go at the same time
+    inner_->removeVars(removed_inner_vars);
+    inner_->removeCnts(inner_cnts_);
+    inner_cnts_.clear();
+    inner_->update();
+  }
+
+  VarVector free_vars;
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+  {
+    if (fixed[i])
+      continue;
+    if (inner_vars_[i].var_rep == nullptr)
+      inner_vars_[i] = inner_->addVar(vars_[i].var_rep->name);
+    free_vars.push_back(inner_vars_[i]);
+  }
+  inner_->update();
+
+  stats_ = PresolveStats();
+  stats_.num_fixed_vars = vars_.size() - free_vars.size();
+  std::vector<bool> is_free(cnts_.size(), false);
+  for (std::size_t slot : free_cnt_slots_)
+    is_free[slot] = true;
+  infeasible_ = false;
+  AffExprVector rows;
+  ConstraintTypeVector row_types;
+  for (std::size_t i = 0; i < cnt_exprs_.size(); ++i)
+  {
+    if (is_free[i])
+      continue;
+    if (dropped[i])
+    {
+      ++stats_.num_dropped_cnts;
+      continue;
+    }
+    AffExpr expr = substitute(cnt_exprs_[i], fixed, values);
+    if (expr.vars.empty())
+    {
+      ++stats_.num_dropped_cnts;
+      if ((cnt_types_[i] == EQ) ? std::abs(expr.constant) > PRESOLVE_FEASIBILITY_TOL :
+                                  expr.constant > PRESOLVE_FEASIBILITY_TOL)
+        infeasible_ = true;
+      continue;
+    }
+    rows.push_back(std::move(expr));
+    row_types.push_back(cnt_types_[i]);
+  }
+
+  // Products with a fixed variable become linear terms, products of two constants
+  QuadExpr objective;
+  objective.affexpr = substitute(objective_.affexpr, fixed, values);
+  for (std::size_t j = 0; j < objective_.size(); ++j)
+  {
+    const std::size_t k1 = objective_.vars1[j].var_rep->index;
+    const std::size_t k2 = objective_.vars2[j].var_rep->index;
+    const double coeff = objective_.coeffs[j];
+    if (fixed[k1] && fixed[k2])
+    {
+      objective.affexpr.constant += coeff * values[k1] * values[k2];
+    }
+    else if (fixed[k1])
+    {
+      objective.affexpr.vars.push_back(inner_vars_[k2]);
+      objective.affexpr.coeffs.push_back(coeff * values[k1]);
+    }
+    else if (fixed[k2])
+    {
+      objective.affexpr.vars.push_back(inner_vars_[k1]);
+      objective.affexpr.coeffs.push_back(coeff * values[k2]);
+    }
+    else
+    {
+      objective.vars1.push_back(inner_vars_[k1]);
+      objective.vars2.push_back(inner_vars_[k2]);
+      objective.coeffs.push_back(coeff);
+    }
+  }
+
+  // The backend solves for y = x / col_scale, indexed like its variables
+  Eigen::VectorXd col_scale = Eigen::VectorXd::Ones(static_cast<Eigen::Index>(free_vars.size()));
+  Eigen::VectorXd row_scale = Eigen::VectorXd::Ones(static_cast<Eigen::Index>(rows.size()));
+  if (settings.scaling_iterations > 0 && !free_vars.empty())
+  {
+    const auto n = static_cast<int>(free_vars.size());
+    Eigen::SparseMatrix<double> P, A;
+    Eigen::VectorXd q, b;
+    double cost_scale = 1;
+    exprToEigen(objective, P, q, n, true);
+    exprToEigen(rows, A, b, n);
+    ruizEquilibration(P, q, A, settings.scaling_iterations, col_scale, row_scale, cost_scale);
+    for (std::size_t r = 0; r < rows.size(); ++r)
+    {
+      const double e = row_scale[static_cast<Eigen::Index>(r)];
+      AffExpr& row = rows[r];
+      for (std::size_t j = 0; j < row.size(); ++j)
+        row.coeffs[j] *= e * col_scale[static_cast<Eigen::Index>(row.vars[j].var_rep->index)];
+      row.constant *= e;
+    }
+    for (std::size_t j = 0; j < objective.size(); ++j)
+      objective.coeffs[j] *= cost_scale * col_scale[static_cast<Eigen::Index>(objective.vars1[j].var_rep->index)] *
+                             col_scale[static_cast<Eigen::Index>(objective.vars2[j].var_rep->index)];
+    AffExpr& linear = objective.affexpr;
+    for (std::size_t j = 0; j < linear.size(); ++j)
+      linear.coeffs[j] *= cost_scale * col_scale[static_cast<Eigen::Index>(linear.vars[j].var_rep->index)];
+    linear.constant *= cost_scale;
+    stats_.cost_scale = cost_scale;
+    stats_.min_col_scale = col_scale.minCoeff();
+    stats_.max_col_scale = col_scale.maxCoeff();
+  }
+
+  // The new rows take over the places of the previous ones, so the backend does not have to compact
+  inner_->removeCnts(inner_cnts_);
+  inner_cnts_.clear();
+  for (std::size_t r = 0; r < rows.size(); ++r)
+    inner_cnts_.push_back((row_types[r] == EQ) ? inner_->addEqCnt(rows[r], "") : inner_->addIneqCnt(rows[r], ""));
+  inner_->setObjective(objective);
+  inner_->update();
+  inner_->setPrescaled(settings.scaling_iterations > 0);
+  num_solved_cnts_ = rows.size();
+
+  inner_col_scale_.assign(col_scale.data(), col_scale.data() + col_scale.size());
+  row_scale_.assign(row_scale.data(), row_scale.data() + row_scale.size());
+  assignRowScale();
+
+  built_fixed_ = fixed;
+  built_values_ = values;
+  built_with_ = settings;
+  structure_dirty_ = false;
+
+  LOG_DEBUG("presolve fixed %zu of %zu variables and dropped %zu of %zu constraints",
+            stats_.num_fixed_vars,
+            vars_.size(),
+            stats_.num_dropped_cnts,
+            cnts_.size() - free_cnt_slots_.size());
+}
+
+void PresolveModel::assignRowScale()
+{
+  inner_row_scale_.clear();
+  for (std::size_t r = 0; r < inner_cnts_.size(); ++r)
+  {
+    const std::size_t i = inner_cnts_[r].cnt_rep->index;
+    if (i >= inner_row_scale_.size())
+      inner_row_scale_.resize(i + 1, 1);
+    inner_row_scale_[i] = row_scale_[r];
+  }
+}
+
+CvxOptStatus PresolveModel::optimize()
+{
+  update();
+  if (needsCompaction())
+    compactCnts(cnts_, cnt_exprs_, cnt_types_);
+
+  std::vector<bool> fixed, dropped;
+  DblVec values;
+  findFixedVars(fixed, values, dropped);
+
+  if (inner_ == nullptr)
+  {
+    inner_type_ = resolveModelType(inner_type_, reducedFeatures(fixed, dropped));
+    inner_ = createModel(inner_type_);
+    inner_->setTimeLimit(time_limit_);
+    inner_->setToleranceHint(tolerance_hint_);
+  }
+
+  // If only the bounds of free variables changed, e.g. when the trust region shrinks, the reduced QP is kept and the
+  // backend only gets the new bounds, so it can take its own bounds-only path
+  const bool reuse = !structure_dirty_ && fixed == built_fixed_ && values == built_values_ &&
+                     settings.remove_fixed_vars == built_with_.remove_fixed_vars &&
+                     settings.scaling_iterations == built_with_.scaling_iterations;
+  if (!reuse)
+    buildInner(fixed, values, dropped);
+  stats_.reused = reuse;
+
+  VarVector free_vars;
+  SizeTVec free_inds;
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+  {
+    if (fixed[i])
+      continue;
+    free_vars.push_back(inner_vars_[i]);
+    free_inds.push_back(i);
+  }
+  DblVec free_lbs(free_vars.size()), free_ubs(free_vars.size());
+  for (std::size_t i = 0; i < free_vars.size(); ++i)
+  {
+    const double d = inner_col_scale_[free_vars[i].var_rep->index];
+    free_lbs[i] = lbs_[free_inds[i]] / d;
+    free_ubs[i] = ubs_[free_inds[i]] / d;
+  }
+  inner_->setVarBounds(free_vars, free_lbs, free_ubs);
+
+  if (warm_primal_.size() == vars_.size())
+  {
+    DblVec primal(free_vars.size());
+    for (std::size_t i = 0; i < free_vars.size(); ++i)
+    {
+      const std::size_t j = free_vars[i].var_rep->index;
+      primal[j] = warm_primal_[free_inds[i]] / inner_col_scale_[j];
+    }
+    DblVec dual = warm_dual_;
+    scaleDuals(dual, true);
+    inner_->setWarmStart(primal, dual);
+  }
+  warm_primal_.clear();
+  warm_dual_.clear();
+
+  solution_ = values;
+  if (infeasible_)
+    return CVX_INFEASIBLE;
+  if (free_vars.empty())
+    return CVX_SOLVED;
+
+  const CvxOptStatus status = inner_->optimize();
+  // The backend drops the places that are left free before it solves, which can renumber the rows
+  assignRowScale();
+  const DblVec free_values = inner_->getVarValues(free_vars);
+  for (std::size_t i = 0; i < free_inds.size(); ++i)
+    solution_[free_inds[i]] = free_values[i] * inner_col_scale_[free_vars[i].var_rep->index];
+  return status;
+}
+
+void PresolveModel::setTimeLimit(double time_limit)
+{
+  time_limit_ = time_limit;
+  if (inner_ != nullptr)
+    inner_->setTimeLimit(time_limit);
+}
+
+void PresolveModel::setToleranceHint(double tolerance)
+{
+  tolerance_hint_ = tolerance;
+  if (inner_ != nullptr)
+    inner_->setToleranceHint(tolerance);
+}
+
+void PresolveModel::setWarmStart(const DblVec& primal, const DblVec& dual)
+{
+  warm_primal_ = primal;
+  warm_dual_ = dual;
+}
+
+DblVec PresolveModel::getDualValues() const
+{
+  if (inner_ == nullptr)
+    return DblVec();
+  DblVec dual = inner_->getDualValues();
+  scaleDuals(dual, false);
+  return dual;
+}
+
+void PresolveModel::scaleDuals(DblVec& dual, bool to_backend) const
+{
+  // The rows of the backend are multiplied by their row scale e and its objective by the cost scale c, so the
+  // multiplier of a row is e / c times the original one. Its variables are divided by their column scale d, which
+  // makes the multiplier of a bound 1 / (c * d) times the original one.
+  const std::size_t n = inner_col_scale_.size();
+  if (dual.size() < n)
+    return;
+  const std::size_t m = dual.size() - n;
+  std::size_t first_row = 0, first_bound = 0;
+  if (inner_type_ == ModelType::OSQP)
+    first_bound = m;
+  else if (inner_type_ == ModelType::QPOASES)
+    first_row = n;
+  else
+    return;  // the other backends have no multipliers
+
+  const double c = stats_.cost_scale;
+  for (std::size_t i = 0; i < m; ++i)
+  {
+    const double e = (i < inner_row_scale_.size()) ? inner_row_scale_[i] : 1;
+    dual[first_row + i] *= to_backend ? c / e : e / c;
+  }
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const double cd = c * inner_col_scale_[i];
+    dual[first_bound + i] *= to_backend ? cd : 1 / cd;
+  }
+}
+
+void PresolveModel::setObjective(const AffExpr& expr) { setObjective(QuadExpr(expr)); }
+
+void PresolveModel::setObjective(const QuadExpr& expr)
+{
+  objective_ = expr;
+  structure_dirty_ = true;
+}
+
+void PresolveModel::writeToFile(const std::string& fname) const
+{
+  std::ofstream outStream(fname);
+  outStream << "\\ Generated by trajopt_sco with presolve\n";
+  outStream << "Minimize\n";
+  outStream << objective_;
+  outStream << "Subject To\n";
+  for (std::size_t i = 0; i < cnt_exprs_.size(); ++i)
+  {
+    std::string op = (cnt_types_[i] == INEQ) ? " <= " : " = ";
+    outStream << cnt_exprs_[i] << op << 0 << "\n";
+  }
+
+  outStream << "Bounds\n";
+  for (std::size_t i = 0; i < vars_.size(); ++i)
+  {
+    outStream << lbs_[i] << " <= " << vars_[i] << " <= " << ubs_[i] << "\n";
+  }
+  outStream << "End";
+}
+
+VarVector PresolveModel::getVars() const { return vars_; }
+
+ModelSize PresolveModel::getSize() const
+{
+  ModelSize size;
+  size.num_vars = vars_.size();
+  size.num_cnts = cnts_.size() - free_cnt_slots_.size();
+  for (const AffExpr& expr : cnt_exprs_)
+    size.cnt_nonzeros += expr.size();
+  size.objective_nonzeros = objective_.size();
+  return size;
+}
+
+bool PresolveModel::exportQP(QPData& qp) const
+{
+  // The multipliers belong to the reduced problem, which a replay does not know about
+  toQPData(vars_, lbs_, ubs_, objective_, cnt_exprs_, cnt_types_, free_cnt_slots_, qp);
+  qp.warm_primal = warm_primal_;
+  qp.dual_layout = inner_type_;
+  return true;
+}
+
+Model::Ptr PresolveModel::clone() const
+{
+  auto out = std::make_shared<PresolveModel>(inner_type_);
+  out->vars_.reserve(vars_.size());
+  for (const Var& var : vars_)
+  {
+    out->vars_.push_back(out->var_arena_.create(var.var_rep->index, var.var_rep->name, out.get()));
+    out->vars_.back().var_rep->removed = var.var_rep->removed;
+  }
+  out->cnts_.reserve(cnts_.size());
+  out->cnt_exprs_.reserve(cnts_.size());
+  for (std::size_t i = 0; i < cnts_.size(); ++i)
+  {
+    out->cnts_.push_back(out->cnt_arena_.create(i, out.get()));
+    out->cnts_.back().cnt_rep->removed = cnts_[i].cnt_rep->removed;
+    out->cnt_exprs_.push_back(toAffExpr(CompactAffExpr(cnt_exprs_[i]), out->vars_));
+  }
+  for (const Var& var : removed_vars_)
+    out->removed_vars_.push_back(out->vars_[var.var_rep->index]);
+  for (const Cnt& cnt : removed_cnts_)
+    out->removed_cnts_.push_back(out->cnts_[cnt.cnt_rep->index]);
+  out->copyFreeAuxVars(*this, out->vars_);
+
+  // The backend of the copy is set up from scratch by its first optimize(), so every backend can be copied
+  out->inner_vars_.resize(vars_.size());
+  out->lbs_ = lbs_;
+  out->ubs_ = ubs_;
+  out->cnt_types_ = cnt_types_;
+  out->free_cnt_slots_ = free_cnt_slots_;
+  out->solution_ = solution_;
+  out->warm_primal_ = warm_primal_;
+  out->objective_ = toQuadExpr(CompactQuadExpr(objective_), out->vars_);
+  out->settings = settings;
+  out->setTimeLimit(time_limit_);
+  out->setToleranceHint(tolerance_hint_);
+  return out;
+}
+}  // namespace sco
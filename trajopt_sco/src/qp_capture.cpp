@@ -0,0 +1,316 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <boost/format.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/qp_capture.hpp>
+
+namespace sco
+{
+namespace
+{
+/** Start of every capture file, followed by the format version and four reserved bytes */
+const char QP_CAPTURE_MAGIC[8] = { 'T', 'R', 'A', 'J', 'O', 'P', 'T', 'Q' };
+const std::uint32_t QP_CAPTURE_VERSION = 1;
+const std::size_t QP_CAPTURE_HEADER_SIZE = sizeof(QP_CAPTURE_MAGIC) + 2 * sizeof(std::uint32_t);
+
+/**
+ * Start of every record. It is followed by lb, ub and q, the rows, columns and values of P and then of A, l, u and
+ * the warm start, all 8 bytes per entry.
+ */
+struct QPRecordHeader
+{
+  std::uint64_t record_size;  // in bytes, including this header
+  std::uint64_t n_vars;
+  std::uint64_t n_cnts;
+  std::uint64_t P_nnz;
+  std::uint64_t A_nnz;
+  std::uint64_t n_warm_primal;
+  std::uint64_t n_warm_dual;
+  std::int64_t dual_layout;
+  double objective_constant;
+};
+static_assert(sizeof(QPRecordHeader) == 9 * 8, "records must stay 8 byte aligned");
+
+std::uint64_t recordSize(const QPRecordHeader& h)
+{
+  return sizeof(QPRecordHeader) +
+         8 * (3 * h.n_vars + 3 * h.P_nnz + 3 * h.A_nnz + 2 * h.n_cnts + h.n_warm_primal + h.n_warm_dual);
+}
+
+void writeDoubles(std::FILE* file, const DblVec& v) { std::fwrite(v.data(), sizeof(double), v.size(), file); }
+
+void writeIndices(std::FILE* file, const IntVec& v)
+{
+  const std::vector<std::int64_t> wide(v.begin(), v.end());
+  std::fwrite(wide.data(), sizeof(std::int64_t), wide.size(), file);
+}
+
+void readDoubles(const unsigned char*& p, std::uint64_t n, DblVec& v)
+{
+  v.resize(n);
+  if (n > 0)
+    std::memcpy(v.data(), p, n * sizeof(double));
+  p += n * sizeof(double);
+}
+
+void readIndices(const unsigned char*& p, std::uint64_t n, IntVec& v)
+{
+  std::vector<std::int64_t> wide(n);
+  if (n > 0)
+    std::memcpy(wide.data(), p, n * sizeof(std::int64_t));
+  v.assign(wide.begin(), wide.end());
+  p += n * sizeof(std::int64_t);
+}
+}  // namespace
+
+void toQPData(const VarVector& vars,
+              const DblVec& lbs,
+              const DblVec& ubs,
+              const QuadExpr& objective,
+              const AffExprVector& cnt_exprs,
+              const ConstraintTypeVector& cnt_types,
+              const SizeTVec& free_cnt_slots,
+              QPData& qp,
+              const DblVec& warm_dual,
+              std::size_t dual_cnt_offset)
+{
+  qp.lb = lbs;
+  qp.ub = ubs;
+  qp.q.assign(vars.size(), 0);
+  qp.objective_constant = objective.affexpr.constant;
+  for (std::size_t i = 0; i < objective.affexpr.size(); ++i)
+    qp.q[objective.affexpr.vars[i].var_rep->index] += objective.affexpr.coeffs[i];
+  qp.P_rows.clear();
+  qp.P_cols.clear();
+  qp.P_vals.clear();
+  for (std::size_t i = 0; i < objective.size(); ++i)
+  {
+    std::size_t row = objective.vars1[i].var_rep->index;
+    std::size_t col = objective.vars2[i].var_rep->index;
+    if (row > col)
+      std::swap(row, col);
+    qp.P_rows.push_back(static_cast<int>(row));
+    qp.P_cols.push_back(static_cast<int>(col));
+    qp.P_vals.push_back((row == col) ? 2 * objective.coeffs[i] : objective.coeffs[i]);
+  }
+
+  std::vector<bool> is_free(cnt_exprs.size(), false);
+  for (std::size_t slot : free_cnt_slots)
+    is_free[slot] = true;
+  qp.A_rows.clear();
+  qp.A_cols.clear();
+  qp.A_vals.clear();
+  qp.l.clear();
+  qp.u.clear();
+  for (std::size_t i = 0; i < cnt_exprs.size(); ++i)
+  {
+    if (is_free[i])
+      continue;
+    const auto row = static_cast<int>(qp.l.size());
+    const AffExpr& expr = cnt_exprs[i];
+    for (std::size_t j = 0; j < expr.size(); ++j)
+    {
+      qp.A_rows.push_back(row);
+      qp.A_cols.push_back(static_cast<int>(expr.vars[j].var_rep->index));
+      qp.A_vals.push_back(expr.coeffs[j]);
+    }
+    qp.u.push_back(-expr.constant);
+    qp.l.push_back((cnt_types[i] == EQ) ? -expr.constant : -std::numeric_limits<double>::infinity());
+  }
+
+  qp.warm_primal.clear();
+  qp.warm_dual.clear();
+  if (warm_dual.size() != vars.size() + cnt_exprs.size())
+    return;
+  qp.warm_dual.reserve(vars.size() + qp.l.size());
+  for (std::size_t i = 0; i < warm_dual.size(); ++i)
+  {
+    if (i < dual_cnt_offset || i >= dual_cnt_offset + cnt_exprs.size() || !is_free[i - dual_cnt_offset])
+      qp.warm_dual.push_back(warm_dual[i]);
+  }
+}
+
+Model::Ptr createModel(const QPData& qp, ModelType model_type)
+{
+  Model::Ptr model = createModel(model_type);
+  VarVector vars;
+  vars.reserve(qp.numVars());
+  for (std::size_t i = 0; i < qp.numVars(); ++i)
+    vars.push_back(model->addVar("x_" + std::to_string(i), qp.lb[i], qp.ub[i]));
+  model->update();
+
+  AffExprVector rows(qp.numCnts());
+  for (std::size_t k = 0; k < qp.A_vals.size(); ++k)
+  {
+    AffExpr& row = rows[static_cast<std::size_t>(qp.A_rows[k])];
+    row.vars.push_back(vars[static_cast<std::size_t>(qp.A_cols[k])]);
+    row.coeffs.push_back(qp.A_vals[k]);
+  }
+  for (std::size_t i = 0; i < rows.size(); ++i)
+  {
+    const std::string name = "c_" + std::to_string(i);
+    AffExpr& row = rows[i];
+    if (qp.l[i] == qp.u[i])
+    {
+      row.constant = -qp.u[i];
+      model->addEqCnt(row, name);
+      continue;
+    }
+    if (qp.u[i] < std::numeric_limits<double>::infinity())
+    {
+      row.constant = -qp.u[i];
+      model->addIneqCnt(row, name);
+    }
+    if (qp.l[i] > -std::numeric_limits<double>::infinity())
+    {
+      AffExpr lower;
+      lower.vars = row.vars;
+      for (double coeff : row.coeffs)
+        lower.coeffs.push_back(-coeff);
+      lower.constant = qp.l[i];
+      model->addIneqCnt(lower, name + "_lower");
+    }
+  }
+
+  QuadExpr objective;
+  objective.affexpr.constant = qp.objective_constant;
+  for (std::size_t i = 0; i < qp.q.size(); ++i)
+  {
+    if (qp.q[i] != 0)
+    {
+      objective.affexpr.vars.push_back(vars[i]);
+      objective.affexpr.coeffs.push_back(qp.q[i]);
+    }
+  }
+  for (std::size_t k = 0; k < qp.P_vals.size(); ++k)
+  {
+    objective.vars1.push_back(vars[static_cast<std::size_t>(qp.P_rows[k])]);
+    objective.vars2.push_back(vars[static_cast<std::size_t>(qp.P_cols[k])]);
+    objective.coeffs.push_back((qp.P_rows[k] == qp.P_cols[k]) ? qp.P_vals[k] / 2 : qp.P_vals[k]);
+  }
+  model->setObjective(objective);
+  model->update();
+
+  if (!qp.warm_primal.empty())
+    model->setWarmStart(qp.warm_primal, (model_type == qp.dual_layout) ? qp.warm_dual : DblVec());
+  return model;
+}
+
+QPCaptureWriter::QPCaptureWriter(const std::string& path) : file_(std::fopen(path.c_str(), "wb"))
+{
+  if (file_ == nullptr)
+    PRINT_AND_THROW(boost::format("failed to create QP capture file %s") % path);
+  const std::uint32_t reserved = 0;
+  std::fwrite(QP_CAPTURE_MAGIC, 1, sizeof(QP_CAPTURE_MAGIC), file_);
+  std::fwrite(&QP_CAPTURE_VERSION, sizeof(QP_CAPTURE_VERSION), 1, file_);
+  std::fwrite(&reserved, sizeof(reserved), 1, file_);
+}
+
+QPCaptureWriter::~QPCaptureWriter() { std::fclose(file_); }
+
+void QPCaptureWriter::write(const QPData& qp)
+{
+  QPRecordHeader h{};
+  h.n_vars = qp.numVars();
+  h.n_cnts = qp.numCnts();
+  h.P_nnz = qp.P_vals.size();
+  h.A_nnz = qp.A_vals.size();
+  h.n_warm_primal = qp.warm_primal.size();
+  h.n_warm_dual = qp.warm_dual.size();
+  h.dual_layout = static_cast<int>(qp.dual_layout);
+  h.objective_constant = qp.objective_constant;
+  h.record_size = recordSize(h);
+
+  std::fwrite(&h, sizeof(h), 1, file_);
+  writeDoubles(file_, qp.lb);
+  writeDoubles(file_, qp.ub);
+  writeDoubles(file_, qp.q);
+  writeIndices(file_, qp.P_rows);
+  writeIndices(file_, qp.P_cols);
+  writeDoubles(file_, qp.P_vals);
+  writeIndices(file_, qp.A_rows);
+  writeIndices(file_, qp.A_cols);
+  writeDoubles(file_, qp.A_vals);
+  writeDoubles(file_, qp.l);
+  writeDoubles(file_, qp.u);
+  writeDoubles(file_, qp.warm_primal);
+  writeDoubles(file_, qp.warm_dual);
+  std::fflush(file_);
+  ++size_;
+}
+
+QPCaptureReader::QPCaptureReader(const std::string& path)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    PRINT_AND_THROW(boost::format("failed to open QP capture file %s") % path);
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < QP_CAPTURE_HEADER_SIZE)
+  {
+    ::close(fd);
+    PRINT_AND_THROW(boost::format("%s is not a QP capture file") % path);
+  }
+  data_size_ = static_cast<std::size_t>(st.st_size);
+  void* data = ::mmap(nullptr, data_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    PRINT_AND_THROW(boost::format("failed to map QP capture file %s") % path);
+  data_ = static_cast<const unsigned char*>(data);
+
+  std::uint32_t version{ 0 };
+  std::memcpy(&version, data_ + sizeof(QP_CAPTURE_MAGIC), sizeof(version));
+  if (std::memcmp(data_, QP_CAPTURE_MAGIC, sizeof(QP_CAPTURE_MAGIC)) != 0 || version != QP_CAPTURE_VERSION)
+  {
+    ::munmap(const_cast<unsigned char*>(data_), data_size_);
+    PRINT_AND_THROW(boost::format("%s is not a QP capture file of version %i") % path % QP_CAPTURE_VERSION);
+  }
+
+  // A record that was cut short, e.g. by a crash, ends the file
+  std::size_t offset = QP_CAPTURE_HEADER_SIZE;
+  while (offset + sizeof(QPRecordHeader) <= data_size_)
+  {
+    QPRecordHeader h{};
+    std::memcpy(&h, data_ + offset, sizeof(h));
+    if (h.record_size != recordSize(h) || h.record_size > data_size_ - offset)
+      break;
+    records_.push_back(offset);
+    offset += h.record_size;
+  }
+}
+
+QPCaptureReader::~QPCaptureReader() { ::munmap(const_cast<unsigned char*>(data_), data_size_); }
+
+QPData QPCaptureReader::get(std::size_t i) const
+{
+  QPRecordHeader h{};
+  std::memcpy(&h, data_ + records_.at(i), sizeof(h));
+  const unsigned char* p = data_ + records_[i] + sizeof(h);
+
+  QPData qp;
+  qp.objective_constant = h.objective_constant;
+  qp.dual_layout = ModelType(static_cast<int>(h.dual_layout));
+  readDoubles(p, h.n_vars, qp.lb);
+  readDoubles(p, h.n_vars, qp.ub);
+  readDoubles(p, h.n_vars, qp.q);
+  readIndices(p, h.P_nnz, qp.P_rows);
+  readIndices(p, h.P_nnz, qp.P_cols);
+  readDoubles(p, h.P_nnz, qp.P_vals);
+  readIndices(p, h.A_nnz, qp.A_rows);
+  readIndices(p, h.A_nnz, qp.A_cols);
+  readDoubles(p, h.A_nnz, qp.A_vals);
+  readDoubles(p, h.n_cnts, qp.l);
+  readDoubles(p, h.n_cnts, qp.u);
+  readDoubles(p, h.n_warm_primal, qp.warm_primal);
+  readDoubles(p, h.n_warm_dual, qp.warm_dual);
+  return qp;
+}
+}  // namespace sco
@@ -6,7 +6,9 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <signal.h>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+#include <trajopt_sco/compact_expr.hpp>
 #include <trajopt_sco/qpoases_interface.hpp>
+#include <trajopt_sco/qp_capture.hpp>
 #include <trajopt_sco/solver_utils.hpp>
 #include <trajopt_utils/logging.hpp>
 #include <trajopt_utils/stl_to_string.hpp>
@@ -23,7 +25,7 @@ Model::Ptr createqpOASESModel()
   return out;
 }
 
-qpOASESModel::qpOASESModel()
+qpOASESModel::qpOASESModel() : time_limit_(std::numeric_limits<double>::infinity())
 {
   // set to be fast. More details at:
   // https://www.coin-or.org/qpOASES/doc/3.2/doxygen/classOptions.html
@@ -38,27 +40,20 @@ qpOASESModel::qpOASESModel()
 qpOASESModel::~qpOASESModel() {}
 Var qpOASESModel::addVar(const std::string& name)
 {
-  vars_.push_back(new VarRep(vars_.size(), name, this));
+  vars_.push_back(var_arena_.create(vars_.size(), name, this));
   lb_.push_back(-QPOASES_INFTY);
   ub_.push_back(QPOASES_INFTY);
   return vars_.back();
 }
 
-Cnt qpOASESModel::addEqCnt(const AffExpr& expr, const std::string& /*name*/)
+Cnt qpOASESModel::addCnt(const AffExpr& expr, ConstraintType type)
 {
-  cnts_.push_back(new CntRep(cnts_.size(), this));
-  cnt_exprs_.push_back(expr);
-  cnt_types_.push_back(EQ);
-  return cnts_.back();
+  return addCntSlot(cnts_, cnt_exprs_, cnt_types_, expr, type);
 }
 
-Cnt qpOASESModel::addIneqCnt(const AffExpr& expr, const std::string& /*name*/)
-{
-  cnts_.push_back(new CntRep(cnts_.size(), this));
-  cnt_exprs_.push_back(expr);
-  cnt_types_.push_back(INEQ);
-  return cnts_.back();
-}
+Cnt qpOASESModel::addEqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, EQ); }
+
+Cnt qpOASESModel::addIneqCnt(const AffExpr& expr, const std::string& /*name*/) { return addCnt(expr, INEQ); }
 
 Cnt qpOASESModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
 {
@@ -66,21 +61,9 @@ Cnt qpOASESModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
   return 0;
 }
 
-void qpOASESModel::removeVars(const VarVector& vars)
-{
-  IntVec inds;
-  vars2inds(vars, inds);
-  for (unsigned i = 0; i < vars.size(); ++i)
-    vars[i].var_rep->removed = true;
-}
+void qpOASESModel::removeVars(const VarVector& vars) { queueRemovals(vars); }
 
-void qpOASESModel::removeCnts(const CntVector& cnts)
-{
-  IntVec inds;
-  cnts2inds(cnts, inds);
-  for (unsigned i = 0; i < cnts.size(); ++i)
-    cnts[i].cnt_rep->removed = true;
-}
+void qpOASESModel::removeCnts(const CntVector& cnts) { queueRemovals(cnts); }
 
 void qpOASESModel::updateObjective()
 {
@@ -139,46 +122,13 @@ void qpOASESModel::createSolver()
 
 void qpOASESModel::update()
 {
+  SizeTVec kept;
+  if (commitVarRemovals(vars_, kept))
   {
-    int inew = 0;
-    for (unsigned iold = 0; iold < vars_.size(); ++iold)
-    {
-      const Var& var = vars_[iold];
-      if (!var.var_rep->removed)
-      {
-        vars_[inew] = var;
-        lb_[inew] = lb_[iold];
-        ub_[inew] = ub_[iold];
-        var.var_rep->index = inew;
-        ++inew;
-      }
-      else
-        delete var.var_rep;
-    }
-    vars_.resize(inew);
-    lb_.resize(inew, QPOASES_INFTY);
-    ub_.resize(inew, -QPOASES_INFTY);
-  }
-  {
-    int inew = 0;
-    for (unsigned iold = 0; iold < cnts_.size(); ++iold)
-    {
-      const Cnt& cnt = cnts_[iold];
-      if (!cnt.cnt_rep->removed)
-      {
-        cnts_[inew] = cnt;
-        cnt_exprs_[inew] = cnt_exprs_[iold];
-        cnt_types_[inew] = cnt_types_[iold];
-        cnt.cnt_rep->index = inew;
-        ++inew;
-      }
-      else
-        delete cnt.cnt_rep;
-    }
-    cnts_.resize(inew);
-    cnt_exprs_.resize(inew);
-    cnt_types_.resize(inew);
+    keepEntries(lb_, kept);
+    keepEntries(ub_, kept);
   }
+  commitCntRemovals(cnt_exprs_, cnt_types_);
 }
 
 void qpOASESModel::setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper)
@@ -204,6 +154,9 @@ DblVec qpOASESModel::getVarValues(const VarVector& vars) const
 CvxOptStatus qpOASESModel::optimize()
 {
   update();
+  if (needsCompaction())
+    compactCnts(cnts_, cnt_exprs_, cnt_types_);
+  num_solved_cnts_ = cnts_.size();
   updateObjective();
   updateConstraints();
   updateSolver();
@@ -211,10 +164,14 @@ CvxOptStatus qpOASESModel::optimize()
 
   // Solve Problem
   int nWSR = 255;
+  // qpOASES reads the maximum cpu time from cputime and overwrites it with the time that was actually spent
+  const bool limited = std::isfinite(time_limit_);
+  double cputime = time_limit_;
   if (qpoases_problem_->isInitialised())
   {
     val = qpoases_problem_->hotstart(
-        &H_, g_.data(), &A_, lb_.data(), ub_.data(), lbA_.data(), ubA_.data(), nWSR, nullptr);
+        &H_, g_.data(), &A_, lb_.data(), ub_.data(), lbA_.data(), ubA_.data(), nWSR, limited ? &cputime : nullptr);
+    cputime = std::fmax(time_limit_ - cputime, 0.0);
   }
 
   if (val != qpOASES::SUCCESSFUL_RETURN)
@@ -224,14 +181,31 @@ CvxOptStatus qpOASESModel::optimize()
     //      tests pass.
     createSolver();
 
-    val = qpoases_problem_->init(&H_, g_.data(), &A_, lb_.data(), ub_.data(), lbA_.data(), ubA_.data(), nWSR, nullptr);
+    // A hotstart already continues from the previous active set, so the starting point only helps a cold start
+    const bool warm = warm_primal_.size() == vars_.size();
+    const bool warm_dual = warm && warm_dual_.size() == vars_.size() + lbA_.size();
+    val = qpoases_problem_->init(&H_,
+                                 g_.data(),
+                                 &A_,
+                                 lb_.data(),
+                                 ub_.data(),
+                                 lbA_.data(),
+                                 ubA_.data(),
+                                 nWSR,
+                                 limited ? &cputime : nullptr,
+                                 warm ? warm_primal_.data() : nullptr,
+                                 warm_dual ? warm_dual_.data() : nullptr);
   }
+  warm_primal_.clear();
+  warm_dual_.clear();
 
   if (val == qpOASES::SUCCESSFUL_RETURN)
   {
     // opt += m_objective.affexpr.constant;
     solution_.resize(vars_.size(), 0.);
     val = qpoases_problem_->getPrimalSolution(solution_.data());
+    dual_solution_.resize(vars_.size() + lbA_.size(), 0.);
+    qpoases_problem_->getDualSolution(dual_solution_.data());
     return CVX_SOLVED;
   }
   else if (val == qpOASES::RET_INIT_FAILED_INFEASIBILITY)
@@ -243,6 +217,13 @@ CvxOptStatus qpOASESModel::optimize()
     return CVX_FAILED;
   }
 }
+void qpOASESModel::setTimeLimit(double time_limit) { time_limit_ = time_limit; }
+void qpOASESModel::setWarmStart(const DblVec& primal, const DblVec& dual)
+{
+  warm_primal_ = primal;
+  warm_dual_ = dual;
+}
+DblVec qpOASESModel::getDualValues() const { return dual_solution_; }
 void qpOASESModel::setObjective(const AffExpr& expr) { objective_.affexpr = expr; }
 void qpOASESModel::setObjective(const QuadExpr& expr) { objective_ = expr; }
 void qpOASESModel::writeToFile(const std::string& /*fname*/) const
@@ -250,4 +231,61 @@ void qpOASESModel::writeToFile(const std::string& /*fname*/) const
   return;  // NOT IMPLEMENTED
 }
 VarVector qpOASESModel::getVars() const { return vars_; }
+
+ModelSize qpOASESModel::getSize() const
+{
+  ModelSize size;
+  size.num_vars = vars_.size();
+  size.num_cnts = cnts_.size() - free_cnt_slots_.size();
+  for (const AffExpr& expr : cnt_exprs_)
+    size.cnt_nonzeros += expr.size();
+  size.objective_nonzeros = objective_.size();
+  return size;
+}
+
+bool qpOASESModel::exportQP(QPData& qp) const
+{
+  // The multipliers of the variable bounds come before the ones of the constraints
+  toQPData(vars_, lb_, ub_, objective_, cnt_exprs_, cnt_types_, free_cnt_slots_, qp, warm_dual_, vars_.size());
+  qp.warm_primal = warm_primal_;
+  qp.dual_layout = ModelType::QPOASES;
+  return true;
+}
+
+Model::Ptr qpOASESModel::clone() const
+{
+  auto out = std::make_shared<qpOASESModel>();
+  out->vars_.reserve(vars_.size());
+  for (const Var& var : vars_)
+  {
+    out->vars_.push_back(out->var_arena_.create(var.var_rep->index, var.var_rep->name, out.get()));
+    out->vars_.back().var_rep->removed = var.var_rep->removed;
+  }
+  out->cnts_.reserve(cnts_.size());
+  out->cnt_exprs_.reserve(cnts_.size());
+  for (std::size_t i = 0; i < cnts_.size(); ++i)
+  {
+    out->cnts_.push_back(out->cnt_arena_.create(i, out.get()));
+    out->cnts_.back().cnt_rep->removed = cnts_[i].cnt_rep->removed;
+    out->cnt_exprs_.push_back(toAffExpr(CompactAffExpr(cnt_exprs_[i]), out->vars_));
+  }
+  for (const Var& var : removed_vars_)
+    out->removed_vars_.push_back(out->vars_[var.var_rep->index]);
+  for (const Cnt& cnt : removed_cnts_)
+    out->removed_cnts_.push_back(out->cnts_[cnt.cnt_rep->index]);
+  out->copyFreeAuxVars(*this, out->vars_);
+
+  out->lb_ = lb_;
+  out->ub_ = ub_;
+  out->cnt_types_ = cnt_types_;
+  out->free_cnt_slots_ = free_cnt_slots_;
+  out->solution_ = solution_;
+  out->dual_solution_ = dual_solution_;
+  out->warm_primal_ = warm_primal_;
+  out->warm_dual_ = warm_dual_;
+  out->objective_ = toQuadExpr(CompactQuadExpr(objective_), out->vars_);
+  out->qpoases_options_ = qpoases_options_;
+  out->time_limit_ = time_limit_;
+  return out;
+}
 }  // namespace sco
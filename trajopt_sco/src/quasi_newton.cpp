@@ -0,0 +1,93 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <Eigen/Eigenvalues>
+#include <cmath>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/quasi_newton.hpp>
+#include <trajopt_utils/eigen_conversions.hpp>
+
+namespace sco
+{
+/** Relative size below which a curvature term is considered zero */
+const double QUASI_NEWTON_TOLERANCE = 1e-8;
+
+bool QuasiNewtonHessian::update(const Eigen::VectorXd& s, const Eigen::VectorXd& y)
+{
+  assert(s.size() == y.size());
+  const double sy = s.dot(y);
+  switch (type_)
+  {
+    case NO_QUASI_NEWTON:
+      return false;
+    case DAMPED_BFGS:
+    {
+      if (empty())
+      {
+        // Scale the initial estimate like the curvature along the step (Nocedal & Wright, eq. 6.20)
+        if (sy <= QUASI_NEWTON_TOLERANCE * s.norm() * y.norm())
+          return false;
+        hessian_ = (y.squaredNorm() / sy) * Eigen::MatrixXd::Identity(s.size(), s.size());
+      }
+      const Eigen::VectorXd bs = hessian_ * s;
+      const double sbs = s.dot(bs);
+      if (sbs <= QUASI_NEWTON_TOLERANCE * s.squaredNorm() * hessian_.norm())
+        return false;
+      // Powell's damping mixes in the current estimate where the curvature along the step is too small
+      const double theta = (sy >= 0.2 * sbs) ? 1 : 0.8 * sbs / (sbs - sy);
+      const Eigen::VectorXd r = theta * y + (1 - theta) * bs;
+      hessian_ += r * r.transpose() / s.dot(r) - bs * bs.transpose() / sbs;
+      return true;
+    }
+    case SR1:
+    {
+      if (empty())
+        hessian_ = Eigen::MatrixXd::Zero(s.size(), s.size());
+      const Eigen::VectorXd r = y - hessian_ * s;
+      const double sr = s.dot(r);
+      if (std::abs(sr) <= QUASI_NEWTON_TOLERANCE * s.norm() * r.norm())
+        return false;
+      hessian_ += r * r.transpose() / sr;
+      return true;
+    }
+  }
+  return false;
+}
+
+QuadExpr QuasiNewtonHessian::quadExpr(const Eigen::VectorXd& x, const VarVector& vars) const
+{
+  QuadExpr quad;
+  if (empty())
+    return quad;
+  assert(x.size() == hessian_.rows() && vars.size() == static_cast<std::size_t>(x.size()));
+
+  Eigen::MatrixXd pos_hess = hessian_;
+  if (type_ != DAMPED_BFGS)
+  {
+    pos_hess.setZero();
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es(hessian_);
+    for (long int i = 0, end = x.size(); i != end; ++i)
+    {
+      if (es.eigenvalues()(i) > 0)
+        pos_hess += es.eigenvalues()(i) * es.eigenvectors().col(i) * es.eigenvectors().col(i).transpose();
+    }
+  }
+
+  quad.affexpr.constant = .5 * x.dot(pos_hess * x);
+  quad.affexpr.vars = vars;
+  quad.affexpr.coeffs = util::toDblVec(-pos_hess * x);
+  for (long int i = 0, end = x.size(); i != end; ++i)
+  {
+    quad.vars1.push_back(vars[static_cast<std::size_t>(i)]);
+    quad.vars2.push_back(vars[static_cast<std::size_t>(i)]);
+    quad.coeffs.push_back(pos_hess(i, i) / 2);
+    for (long int j = i + 1; j != end; ++j)
+    {
+      quad.vars1.push_back(vars[static_cast<std::size_t>(i)]);
+      quad.vars2.push_back(vars[static_cast<std::size_t>(j)]);
+      quad.coeffs.push_back(pos_hess(i, j));
+    }
+  }
+  return quad;
+}
+}  // namespace sco
@@ -1,5 +1,6 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
 #include <boost/format.hpp>
 #include <iostream>
 #include <map>
@@ -11,7 +12,9 @@ TRAJOPT_IGNORE_WARNINGS_POP
 
 namespace sco
 {
-const std::vector<std::string> ModelType::MODEL_NAMES_ = { "GUROBI", "BPMPD", "OSQP", "QPOASES", "AUTO_SOLVER" };
+const std::vector<std::string> ModelType::MODEL_NAMES_ = {
+  "GUROBI", "OSQP", "QPOASES", "BPMPD", "AUTO_SOLVER", "BANDED"
+};
 
 void vars2inds(const VarVector& vars, SizeTVec& inds)
 {
@@ -104,6 +107,165 @@ Var Model::addVar(const std::string& name, double lb, double ub)
   setVarBounds(v, lb, ub);
   return v;
 }
+Var Model::addAuxVar(const std::string& name, double lb, double ub)
+{
+  if (free_aux_vars_.empty())
+    return addVar(name, lb, ub);
+
+  if (!free_aux_vars_sorted_)
+  {
+    std::sort(free_aux_vars_.begin(), free_aux_vars_.end(), [](const Var& a, const Var& b) {
+      return a.var_rep->index > b.var_rep->index;
+    });
+    free_aux_vars_sorted_ = true;
+  }
+  Var v = free_aux_vars_.back();
+  free_aux_vars_.pop_back();
+  v.var_rep->name = name;
+  setVarBounds(v, lb, ub);
+  return v;
+}
+
+void Model::releaseAuxVars(const VarVector& vars)
+{
+  if (vars.empty())
+    return;
+  setVarBounds(vars, DblVec(vars.size(), 0), DblVec(vars.size(), 0));
+  free_aux_vars_.insert(free_aux_vars_.end(), vars.begin(), vars.end());
+  free_aux_vars_sorted_ = false;
+}
+
+void Model::copyFreeAuxVars(const Model& other, const VarVector& vars)
+{
+  free_aux_vars_.clear();
+  free_aux_vars_.reserve(other.free_aux_vars_.size());
+  for (const Var& var : other.free_aux_vars_)
+    free_aux_vars_.push_back(vars[var.var_rep->index]);
+  free_aux_vars_sorted_ = other.free_aux_vars_sorted_;
+}
+
+void Model::queueRemovals(const VarVector& vars)
+{
+  for (const Var& var : vars)
+  {
+    if (!var.var_rep->removed)
+      removed_vars_.push_back(var);
+    var.var_rep->removed = true;
+  }
+}
+
+void Model::queueRemovals(const CntVector& cnts)
+{
+  for (const Cnt& cnt : cnts)
+  {
+    if (!cnt.cnt_rep->removed)
+      removed_cnts_.push_back(cnt);
+    cnt.cnt_rep->removed = true;
+  }
+}
+
+Cnt Model::addCntSlot(CntVector& cnts,
+                      AffExprVector& cnt_exprs,
+                      ConstraintTypeVector& cnt_types,
+                      const AffExpr& expr,
+                      ConstraintType type)
+{
+  std::size_t i = cnts.size();
+  if (!removed_cnts_.empty())
+  {
+    i = removed_cnts_.back().cnt_rep->index;
+    removed_cnts_.pop_back();
+  }
+  else if (!free_cnt_slots_.empty())
+  {
+    i = free_cnt_slots_.back();
+    free_cnt_slots_.pop_back();
+  }
+  if (i < cnts.size())
+  {
+    cnt_arena_.release(cnts[i].cnt_rep);
+    cnts[i] = cnt_arena_.create(i, this);
+    cnt_exprs[i] = expr;
+    cnt_types[i] = type;
+    return cnts[i];
+  }
+  cnts.push_back(cnt_arena_.create(cnts.size(), this));
+  cnt_exprs.push_back(expr);
+  cnt_types.push_back(type);
+  return cnts.back();
+}
+
+bool Model::commitVarRemovals(VarVector& vars, SizeTVec& kept)
+{
+  kept.clear();
+  if (removed_vars_.empty())
+    return false;
+  removed_vars_.clear();
+
+  kept.reserve(vars.size());
+  for (std::size_t iold = 0; iold < vars.size(); ++iold)
+  {
+    const Var& var = vars[iold];
+    if (!var.var_rep->removed)
+    {
+      var.var_rep->index = kept.size();
+      vars[kept.size()] = var;
+      kept.push_back(iold);
+    }
+    else
+      var_arena_.release(var.var_rep);
+  }
+  vars.resize(kept.size());
+  return true;
+}
+
+bool Model::commitCntRemovals(AffExprVector& cnt_exprs, ConstraintTypeVector& cnt_types)
+{
+  if (removed_cnts_.empty())
+    return false;
+  for (const Cnt& cnt : removed_cnts_)
+  {
+    const std::size_t i = cnt.cnt_rep->index;
+    cnt_exprs[i] = AffExpr();
+    cnt_types[i] = INEQ;
+    free_cnt_slots_.push_back(i);
+  }
+  removed_cnts_.clear();
+  return true;
+}
+
+void Model::compactCnts(CntVector& cnts, AffExprVector& cnt_exprs, ConstraintTypeVector& cnt_types)
+{
+  std::size_t inew = 0;
+  for (std::size_t iold = 0; iold < cnts.size(); ++iold)
+  {
+    const Cnt& cnt = cnts[iold];
+    if (!cnt.cnt_rep->removed)
+    {
+      cnts[inew] = cnt;
+      if (inew != iold)
+        cnt_exprs[inew] = std::move(cnt_exprs[iold]);
+      cnt_types[inew] = cnt_types[iold];
+      cnt.cnt_rep->index = inew;
+      ++inew;
+    }
+    else
+      cnt_arena_.release(cnt.cnt_rep);
+  }
+  cnts.resize(inew);
+  cnt_exprs.resize(inew);
+  cnt_types.resize(inew);
+  free_cnt_slots_.clear();
+  ++num_compactions_;
+}
+
+ModelSize Model::getSize() const
+{
+  ModelSize size;
+  size.num_vars = getVars().size();
+  return size;
+}
+
 void Model::removeVar(const Var& var)
 {
   VarVector vars(1, var);
@@ -250,7 +412,8 @@ void ModelType::fromJson(const Json::Value& v)
 
 std::vector<ModelType> availableSolvers()
 {
-  std::vector<bool> has_solver(ModelType::AUTO_SOLVER, false);
+  // Backends added later are numbered after AUTO_SOLVER, so the values stored in QP captures stay valid
+  std::vector<bool> has_solver(ModelType::MODEL_NAMES_.size(), false);
 #ifdef HAVE_GUROBI
   has_solver[ModelType::GUROBI] = true;
 #endif
@@ -263,16 +426,17 @@ std::vector<ModelType> availableSolvers()
 #ifdef HAVE_QPOASES
   has_solver[ModelType::QPOASES] = true;
 #endif
+  has_solver[ModelType::BANDED] = true;
   size_t n_available_solvers = 0;
-  for (auto i = 0; i < ModelType::AUTO_SOLVER; ++i)
-    if (has_solver[static_cast<size_t>(i)])
+  for (std::size_t i = 0; i < has_solver.size(); ++i)
+    if (has_solver[i])
       ++n_available_solvers;
   std::vector<ModelType> available_solvers(n_available_solvers, ModelType::AUTO_SOLVER);
 
   size_t j = 0;
-  for (int i = 0; i < static_cast<int>(ModelType::AUTO_SOLVER); ++i)
-    if (has_solver[static_cast<size_t>(i)])
-      available_solvers[j++] = static_cast<ModelType>(i);
+  for (std::size_t i = 0; i < has_solver.size(); ++i)
+    if (has_solver[i])
+      available_solvers[j++] = ModelType(static_cast<int>(i));
   return available_solvers;
 }
 
@@ -290,6 +454,7 @@ Model::Ptr createModel(ModelType model_type)
 #ifdef HAVE_QPOASES
   extern Model::Ptr createqpOASESModel();
 #endif
+  extern Model::Ptr createBandedQPModel();
 
   char* solver_env = getenv("TRAJOPT_CONVEX_SOLVER");
 
@@ -347,6 +512,8 @@ Model::Ptr createModel(ModelType model_type)
   if (solver == ModelType::QPOASES)
     return createqpOASESModel();
 #endif
+  if (solver == ModelType::BANDED)
+    return createBandedQPModel();
   std::stringstream solver_instatiation_error;
   solver_instatiation_error << "Failed to create solver: unknown solver " << solver << std::endl;
   PRINT_AND_THROW(solver_instatiation_error.str());
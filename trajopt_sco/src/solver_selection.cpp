@@ -0,0 +1,194 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <boost/format.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/qp_capture.hpp>
+#include <trajopt_sco/solver_selection.hpp>
+#include <trajopt_utils/logging.hpp>
+
+namespace sco
+{
+namespace
+{
+std::mutex thresholds_mutex;
+bool thresholds_loaded = false;
+SolverSelectionThresholds thresholds;
+
+/** Loads the thresholds from TRAJOPT_SOLVER_SELECTION the first time. The caller holds thresholds_mutex. */
+void loadThresholdsOnce()
+{
+  if (thresholds_loaded)
+    return;
+  thresholds_loaded = true;
+  const char* path = std::getenv("TRAJOPT_SOLVER_SELECTION");
+  if (path == nullptr)
+    return;
+  try
+  {
+    thresholds = loadSolverSelectionThresholds(path);
+  }
+  catch (const std::exception& e)
+  {
+    LOG_ERROR("using the default solver selection: %s", e.what());
+  }
+}
+
+template <typename T>
+void childFromJson(const Json::Value& v, T& ref, const char* name);
+
+template <>
+void childFromJson(const Json::Value& v, std::size_t& ref, const char* name)
+{
+  if (v.isMember(name))
+    ref = static_cast<std::size_t>(v[name].asUInt64());
+}
+
+template <>
+void childFromJson(const Json::Value& v, double& ref, const char* name)
+{
+  if (v.isMember(name))
+    ref = v[name].asDouble();
+}
+}  // namespace
+
+double QPFeatures::density() const
+{
+  if (num_vars == 0 || numCnts() == 0)
+    return 0;
+  return static_cast<double>(cnt_nonzeros) / (static_cast<double>(num_vars) * static_cast<double>(numCnts()));
+}
+
+double QPFeatures::eqFraction() const
+{
+  if (numCnts() == 0)
+    return 1;
+  return static_cast<double>(num_eq_cnts) / static_cast<double>(numCnts());
+}
+
+QPFeatures qpFeatures(const QPData& qp)
+{
+  QPFeatures features;
+  features.num_vars = qp.numVars();
+  for (std::size_t i = 0; i < qp.numCnts(); ++i)
+    ++((qp.l[i] == qp.u[i]) ? features.num_eq_cnts : features.num_ineq_cnts);
+  features.cnt_nonzeros = qp.A_vals.size();
+  return features;
+}
+
+void SolverSelectionThresholds::fromJson(const Json::Value& v)
+{
+  if (!v.isObject())
+    PRINT_AND_THROW("solver selection thresholds must be a JSON object");
+  childFromJson(v, active_set_max_vars, "active_set_max_vars");
+  childFromJson(v, active_set_min_eq_fraction, "active_set_min_eq_fraction");
+  childFromJson(v, large_min_vars, "large_min_vars");
+  childFromJson(v, sparse_max_density, "sparse_max_density");
+}
+
+Json::Value SolverSelectionThresholds::toJson() const
+{
+  Json::Value v(Json::objectValue);
+  v["active_set_max_vars"] = static_cast<Json::UInt64>(active_set_max_vars);
+  v["active_set_min_eq_fraction"] = active_set_min_eq_fraction;
+  v["large_min_vars"] = static_cast<Json::UInt64>(large_min_vars);
+  v["sparse_max_density"] = sparse_max_density;
+  return v;
+}
+
+SolverSelectionThresholds solverSelectionThresholds()
+{
+  std::lock_guard<std::mutex> lock(thresholds_mutex);
+  loadThresholdsOnce();
+  return thresholds;
+}
+
+void setSolverSelectionThresholds(const SolverSelectionThresholds& new_thresholds)
+{
+  std::lock_guard<std::mutex> lock(thresholds_mutex);
+  thresholds_loaded = true;
+  thresholds = new_thresholds;
+}
+
+SolverSelectionThresholds loadSolverSelectionThresholds(const std::string& path)
+{
+  std::ifstream file(path);
+  if (!file)
+    PRINT_AND_THROW(boost::format("failed to open solver selection config %s") % path);
+  Json::Value root;
+  Json::CharReaderBuilder builder;
+  std::string errors;
+  if (!Json::parseFromStream(builder, file, &root, &errors))
+    PRINT_AND_THROW(boost::format("failed to parse solver selection config %s: %s") % path % errors);
+  SolverSelectionThresholds out;
+  out.fromJson(root);
+  return out;
+}
+
+void saveSolverSelectionThresholds(const std::string& path, const SolverSelectionThresholds& thresholds)
+{
+  std::ofstream file(path);
+  if (!file)
+    PRINT_AND_THROW(boost::format("failed to create solver selection config %s") % path);
+  file << thresholds.toJson() << std::endl;
+}
+
+ModelType selectModelType(const QPFeatures& features, const SolverSelectionThresholds& thresholds)
+{
+  const std::vector<ModelType> available = availableSolvers();
+  auto isAvailable = [&](ModelType type) {
+    return std::find(available.begin(), available.end(), type) != available.end();
+  };
+
+  if (features.num_vars <= thresholds.active_set_max_vars &&
+      features.eqFraction() >= thresholds.active_set_min_eq_fraction && isAvailable(ModelType::QPOASES))
+    return ModelType::QPOASES;
+  if (features.num_vars >= thresholds.large_min_vars)
+  {
+    const ModelType large = (features.density() <= thresholds.sparse_max_density) ? ModelType::OSQP : ModelType::BPMPD;
+    if (isAvailable(large))
+      return large;
+  }
+  return available.at(0);
+}
+
+ModelType resolveModelType(ModelType model_type, const QPFeatures& features)
+{
+  if (!(model_type == ModelType::AUTO_SOLVER))
+    return model_type;
+
+  const char* solver_env = std::getenv("TRAJOPT_CONVEX_SOLVER");
+  if (solver_env != nullptr && std::string(solver_env) != "AUTO_SOLVER")
+  {
+    try
+    {
+      return ModelType(std::string(solver_env));
+    }
+    catch (std::runtime_error&)
+    {
+      PRINT_AND_THROW(boost::format("invalid solver \"%s\" specified by TRAJOPT_CONVEX_SOLVER") % solver_env);
+    }
+  }
+
+  model_type = selectModelType(features);
+  std::stringstream name;
+  name << model_type;
+  LOG_DEBUG("AUTO_SOLVER chose %s for %zu variables, %zu equalities, %zu inequalities and density %.3f",
+            name.str().c_str(),
+            features.num_vars,
+            features.num_eq_cnts,
+            features.num_ineq_cnts,
+            features.density());
+  return model_type;
+}
+
+Model::Ptr createModel(ModelType model_type, const QPFeatures& features)
+{
+  return createModel(resolveModelType(model_type, features));
+}
+}  // namespace sco
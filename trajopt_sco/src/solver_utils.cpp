@@ -1,6 +1,7 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <algorithm>
+#include <cmath>
 #include <Eigen/SparseCore>
 #include <sstream>
 TRAJOPT_IGNORE_WARNINGS_POP
@@ -118,6 +119,73 @@ void exprToEigen(const AffExprVector& expr_vec,
   sparse_matrix.setFromTriplets(triplets.begin(), triplets.end());
 }
 
+namespace
+{
+/** Scaling of a norm as in OSQP: a norm that is about 0 is left as it is, a large one is only scaled partially */
+double limitScaling(double norm)
+{
+  const double MIN_SCALING = 1e-4;
+  const double MAX_SCALING = 1e4;
+  if (norm < MIN_SCALING)
+    return 1;
+  return std::min(norm, MAX_SCALING);
+}
+
+/** Adds the infinity norms of the columns of m to col_norm and, if row_norm is given, of its rows to row_norm */
+void infNorms(const Eigen::SparseMatrix<double>& m, Eigen::VectorXd& col_norm, Eigen::VectorXd* row_norm)
+{
+  for (Eigen::Index k = 0; k < m.outerSize(); ++k)
+  {
+    for (Eigen::SparseMatrix<double>::InnerIterator it(m, k); it; ++it)
+    {
+      const double v = std::abs(it.value());
+      col_norm[it.col()] = std::max(col_norm[it.col()], v);
+      if (row_norm != nullptr)
+        (*row_norm)[it.row()] = std::max((*row_norm)[it.row()], v);
+    }
+  }
+}
+}  // namespace
+
+void ruizEquilibration(Eigen::SparseMatrix<double> P,
+                       Eigen::VectorXd q,
+                       Eigen::SparseMatrix<double> A,
+                       int iterations,
+                       Eigen::VectorXd& col_scale,
+                       Eigen::VectorXd& row_scale,
+                       double& cost_scale)
+{
+  col_scale = Eigen::VectorXd::Ones(P.cols());
+  row_scale = Eigen::VectorXd::Ones(A.rows());
+  cost_scale = 1;
+  Eigen::VectorXd col_norm(P.cols());
+  Eigen::VectorXd row_norm(A.rows());
+  for (int i = 0; i < iterations; ++i)
+  {
+    col_norm.setZero();
+    row_norm.setZero();
+    infNorms(P, col_norm, nullptr);
+    infNorms(A, col_norm, &row_norm);
+    const Eigen::VectorXd col_step = col_norm.unaryExpr([](double v) { return 1 / std::sqrt(limitScaling(v)); });
+    const Eigen::VectorXd row_step = row_norm.unaryExpr([](double v) { return 1 / std::sqrt(limitScaling(v)); });
+    P = col_step.asDiagonal() * P * col_step.asDiagonal();
+    A = row_step.asDiagonal() * A * col_step.asDiagonal();
+    q = q.cwiseProduct(col_step);
+    col_scale = col_scale.cwiseProduct(col_step);
+    row_scale = row_scale.cwiseProduct(row_step);
+
+    // The objective as a whole is scaled to a mean column norm of 1
+    col_norm.setZero();
+    infNorms(P, col_norm, nullptr);
+    const double mean_norm = (P.cols() > 0) ? col_norm.mean() : 0;
+    const double q_norm = (q.size() > 0) ? q.cwiseAbs().maxCoeff() : 0;
+    const double cost_step = 1 / limitScaling(std::max(mean_norm, q_norm));
+    P *= cost_step;
+    q *= cost_step;
+    cost_scale *= cost_step;
+  }
+}
+
 void tripletsToEigen(const IntVec& rows_i,
                      const IntVec& cols_j,
                      const DblVec& values_ij,
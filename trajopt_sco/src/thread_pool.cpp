@@ -0,0 +1,117 @@
+#include <trajopt_sco/thread_pool.hpp>
+#include <trajopt_utils/logging.hpp>
+
+namespace sco
+{
+ThreadPool::ThreadPool(std::size_t num_threads)
+{
+  if (num_threads > 1)
+  {
+    workers_.reserve(num_threads - 1);
+    for (std::size_t i = 0; i + 1 < num_threads; ++i)
+      workers_.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (std::thread& worker : workers_)
+    worker.join();
+}
+
+void ThreadPool::parallelFor(std::size_t n, const std::function<void(std::size_t)>& func)
+{
+  if (n == 0)
+    return;
+
+  if (workers_.empty() || n == 1)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+      func(i);
+    return;
+  }
+
+  std::lock_guard<std::mutex> call_lock(call_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    func_ = &func;
+    n_items_ = n;
+    next_item_ = 0;
+    finished_items_ = 0;
+    error_ = nullptr;
+    log_level_ = util::gThreadLogLevel;
+    ++generation_;
+  }
+  work_cv_.notify_all();
+
+  runItems();
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return finished_items_ == n_items_; });
+    error = error_;
+    func_ = nullptr;
+    n_items_ = 0;
+    next_item_ = 0;
+    error_ = nullptr;
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void ThreadPool::workerLoop()
+{
+  std::size_t seen_generation = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [this, seen_generation]() { return stop_ || generation_ != seen_generation; });
+      if (stop_)
+        return;
+      seen_generation = generation_;
+    }
+    runItems();
+  }
+}
+
+void ThreadPool::runItems()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (next_item_ < n_items_)
+  {
+    std::size_t i = next_item_++;
+    const std::function<void(std::size_t)>* func = func_;
+    const int thread_log_level = util::gThreadLogLevel;
+    util::gThreadLogLevel = log_level_;
+    lock.unlock();
+
+    std::exception_ptr error;
+    try
+    {
+      (*func)(i);
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+    util::gThreadLogLevel = thread_log_level;
+
+    lock.lock();
+    if (error && (!error_ || i < error_index_))
+    {
+      error_ = error;
+      error_index_ = i;
+    }
+    if (++finished_items_ == n_items_)
+      done_cv_.notify_all();
+  }
+}
+}  // namespace sco
@@ -0,0 +1,64 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/qp_capture.hpp>
+#include <trajopt_sco/solver_interface.hpp>
+
+/**
+ * @brief Solves all captured QPs with one backend, each in a fresh model with its captured warm start
+ *
+ * Only optimize() is timed, building and destroying the models is not.
+ */
+static void BM_QP_REPLAY(benchmark::State& state, const std::vector<sco::QPData>& qps, sco::ModelType model_type)
+{
+  std::size_t n_failed = 0;
+  sco::Model::Ptr model;
+  for (auto _ : state)
+  {
+    for (const sco::QPData& qp : qps)
+    {
+      state.PauseTiming();
+      model = sco::createModel(qp, model_type);
+      state.ResumeTiming();
+      if (model->optimize() != sco::CVX_SOLVED)
+        ++n_failed;
+    }
+  }
+  model.reset();
+
+  state.counters["qps"] = static_cast<double>(qps.size());
+  state.counters["failed"] = benchmark::Counter(static_cast<double>(n_failed), benchmark::Counter::kAvgIterations);
+}
+
+int main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+  if (argc != 2)
+  {
+    std::cerr << "usage: " << argv[0] << " [benchmark options] <QP capture file>" << std::endl;
+    return 1;
+  }
+
+  std::vector<sco::QPData> qps;
+  {
+    sco::QPCaptureReader capture(argv[1]);
+    for (std::size_t i = 0; i < capture.size(); ++i)
+      qps.push_back(capture.get(i));
+  }
+
+  for (const sco::ModelType& model_type : sco::availableSolvers())
+  {
+    std::stringstream name;
+    name << "BM_QP_REPLAY/" << model_type;
+    benchmark::RegisterBenchmark(name.str().c_str(), &BM_QP_REPLAY, qps, model_type)
+        ->Unit(benchmark::TimeUnit::kMillisecond);
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
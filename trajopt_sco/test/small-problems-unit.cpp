@@ -1,16 +1,33 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <Eigen/Dense>
+#include <atomic>
 #include <boost/format.hpp>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <unistd.h>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+#include <trajopt_sco/banded_interface.hpp>
+#include <trajopt_sco/batch_optimizer.hpp>
 #include <trajopt_sco/expr_op_overloads.hpp>
+#include <trajopt_sco/iteration_log.hpp>
 #include <trajopt_sco/modeling_utils.hpp>
 #include <trajopt_sco/optimizers.hpp>
+#ifdef HAVE_OSQP
+#include <trajopt_sco/osqp_interface.hpp>
+#endif
+#include <trajopt_sco/presolve_model.hpp>
+#include <trajopt_sco/qp_capture.hpp>
+#include <trajopt_sco/quasi_newton.hpp>
 #include <trajopt_sco/sco_common.hpp>
 #include <trajopt_sco/solver_interface.hpp>
 #include <trajopt_utils/logging.hpp>
@@ -27,9 +44,9 @@ protected:
   SQP() = default;
 };
 
-void setupProblem(OptProb::Ptr& probptr, size_t nvars, ModelType convex_solver)
+void setupProblem(OptProb::Ptr& probptr, size_t nvars, ModelType convex_solver, bool presolve = false)
 {
-  probptr.reset(new OptProb(convex_solver));
+  probptr.reset(presolve ? new OptProb(convex_solver, QPFeatures(), true) : new OptProb(convex_solver));
   vector<string> var_names;
   for (size_t i = 0; i < nvars; ++i)
   {
@@ -84,12 +101,39 @@ TEST_P(SQP, QuadraticNonseparable)  // NOLINT
   // todo: checks on number of iterations and function evaluates
 }
 
-void testProblem(ScalarOfVector::Ptr f,
-                 VectorOfVector::Ptr g,
-                 ConstraintType cnt_type,
-                 const DblVec& init,
-                 const DblVec& sol,
-                 ModelType convex_solver)
+TEST_P(SQP, Presolve)  // NOLINT
+{
+  // x_0 is fixed by an equality and x_2 by its bounds, leaving a QP in x_1 alone
+  for (bool presolve : { false, true })
+  {
+    OptProb::Ptr prob;
+    setupProblem(prob, 3, GetParam(), presolve);
+    prob->addCost(
+        Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_QuadraticNonseparable), prob->getVars(), "f", true)));
+    prob->addLinearConstraint(exprAdd(AffExpr(prob->getVars()[0]), -0.5), EQ);
+    prob->setLowerBounds({ -INFINITY, -INFINITY, 2 });
+    prob->setUpperBounds({ INFINITY, INFINITY, 2 });
+    BasicTrustRegionSQP solver(prob);
+    solver.getParameters().trust_box_size = 100;
+    solver.initialize({ 0, 0, 2 });
+    ASSERT_EQ(solver.optimize(), OPT_CONVERGED);
+    expectAllNear(solver.x(), { 0.5, 6.5, 2 }, 1e-3);
+    if (presolve)
+    {
+      const auto& model = static_cast<const PresolveModel&>(*prob->getModel());
+      EXPECT_EQ(model.lastPresolve().num_fixed_vars, 2);
+      EXPECT_EQ(model.innerModel().getVars().size(), 1);
+    }
+  }
+}
+
+OptResults testProblem(ScalarOfVector::Ptr f,
+                       VectorOfVector::Ptr g,
+                       ConstraintType cnt_type,
+                       const DblVec& init,
+                       const DblVec& sol,
+                       ModelType convex_solver,
+                       const std::function<void(BasicTrustRegionSQPParameters&)>& setup = nullptr)
 {
   OptProb::Ptr prob;
   size_t n = init.size();
@@ -104,11 +148,14 @@ void testProblem(ScalarOfVector::Ptr f,
   params.min_trust_box_size = 1e-5;
   params.min_approx_improve = 1e-10;
   params.initial_merit_error_coeff = 1;
+  if (setup)
+    setup(params);
 
   solver.initialize(init);
   OptStatus status = solver.optimize();
   EXPECT_EQ(status, OPT_CONVERGED);
   expectAllNear(solver.x(), sol, .01);
+  return solver.results();
 }
 // http://www.ai7.uni-bayreuth.de/test_problem_coll.pdf
 
@@ -173,7 +220,698 @@ TEST_P(SQP, TP7)  // NOLINT
               GetParam());
 }
 
-auto getAvailableSolvers = []() {
+void addMixedTerms(OptProb& prob)
+{
+  prob.addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_TP7), prob.getVars(), "f", true)));
+  prob.addCost(Cost::Ptr(
+      new CostFromErrFunc(VectorOfVector::construct(&g_TP1), prob.getVars(), VectorXd(), ABS, "abs")));
+  prob.addConstraint(Constraint::Ptr(
+      new ConstraintFromErrFunc(VectorOfVector::construct(&g_TP7), prob.getVars(), VectorXd(), EQ, "g7")));
+  prob.addConstraint(Constraint::Ptr(
+      new ConstraintFromErrFunc(VectorOfVector::construct(&g_TP3), prob.getVars(), VectorXd(), INEQ, "g3")));
+}
+
+OptProb::Ptr createMixedProblem(ModelType convex_solver, bool presolve = false)
+{
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, convex_solver, presolve);
+  addMixedTerms(*prob);
+  return prob;
+}
+
+void setMixedParameters(BasicTrustRegionSQPParameters& params)
+{
+  params.max_iter = 1000;
+  params.min_trust_box_size = 1e-5;
+  params.min_approx_improve = 1e-10;
+  params.initial_merit_error_coeff = 1;
+}
+
+OptResults solveMixedProblem(ModelType convex_solver, const std::function<void(BasicTrustRegionSQPParameters&)>& setup)
+{
+  BasicTrustRegionSQP solver(createMixedProblem(convex_solver));
+  BasicTrustRegionSQPParameters& params = solver.getParameters();
+  setMixedParameters(params);
+  setup(params);
+
+  solver.initialize({ 2, 2 });
+  solver.optimize();
+  return solver.results();
+}
+
+TEST_P(SQP, ParallelConvexification)  // NOLINT
+{
+  // Convexifying on a thread pool must reproduce the serial iterates exactly
+  OptResults serial = solveMixedProblem(GetParam(), [](BasicTrustRegionSQPParameters& p) { p.num_threads = 1; });
+  OptResults parallel = solveMixedProblem(GetParam(), [](BasicTrustRegionSQPParameters& p) { p.num_threads = 4; });
+  EXPECT_EQ(serial.status, parallel.status);
+  EXPECT_EQ(serial.n_qp_solves, parallel.n_qp_solves);
+  EXPECT_EQ(serial.x, parallel.x);
+  EXPECT_EQ(serial.cost_vals, parallel.cost_vals);
+  EXPECT_EQ(serial.cnt_viols, parallel.cnt_viols);
+}
+
+TEST_P(SQP, ParallelEvaluation)  // NOLINT
+{
+  // Evaluating the exact terms on a thread pool must be bit-identical to the serial evaluation
+  OptResults serial = solveMixedProblem(GetParam(), [](BasicTrustRegionSQPParameters& p) { p.num_eval_threads = 1; });
+  OptResults parallel =
+      solveMixedProblem(GetParam(), [](BasicTrustRegionSQPParameters& p) { p.num_eval_threads = 3; });
+  EXPECT_EQ(serial.status, parallel.status);
+  EXPECT_EQ(serial.n_func_evals, parallel.n_func_evals);
+  EXPECT_EQ(serial.x, parallel.x);
+  EXPECT_EQ(serial.cost_vals, parallel.cost_vals);
+  EXPECT_EQ(serial.cnt_viols, parallel.cnt_viols);
+}
+
+TEST_P(SQP, SpeculativeTrustRegion)  // NOLINT
+{
+  // Trying several trust region sizes at once must still find the solution of the serial loop
+  OptResults serial =
+      solveMixedProblem(GetParam(), [](BasicTrustRegionSQPParameters& p) { p.num_trust_box_candidates = 1; });
+  OptResults speculative =
+      solveMixedProblem(GetParam(), [](BasicTrustRegionSQPParameters& p) { p.num_trust_box_candidates = 3; });
+  EXPECT_EQ(serial.status, speculative.status);
+  expectAllNear(serial.x, speculative.x, 1e-3);
+  expectAllNear(serial.cnt_viols, speculative.cnt_viols, 1e-4);
+  EXPECT_NEAR(vecSum(serial.cost_vals), vecSum(speculative.cost_vals), 1e-3);
+  // Only the candidates up to the first accepted one are evaluated, which are the steps the serial loop evaluates
+  EXPECT_EQ(serial.n_func_evals, speculative.n_func_evals);
+}
+
+TEST_P(SQP, SpeculativeTrustRegionEvaluatesSerially)  // NOLINT
+{
+  // The QPs of the candidates are solved concurrently, but a term is never evaluated by two threads at once
+  std::atomic<int> in_flight{ 0 };
+  std::atomic<int> max_in_flight{ 0 };
+  auto f = [&](const VectorXd& x) {
+    const int n = ++in_flight;
+    if (n > max_in_flight)
+      max_in_flight = n;
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+    --in_flight;
+    return f_TP7(x);
+  };
+  OptProb::Ptr prob = createMixedProblem(GetParam());
+  prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(f), prob->getVars(), "counted", true)));
+  BasicTrustRegionSQP solver(prob);
+  setMixedParameters(solver.getParameters());
+  solver.getParameters().num_trust_box_candidates = 3;
+  solver.initialize({ 2, 2 });
+  solver.optimize();
+  EXPECT_GT(solver.results().n_func_evals, 3);
+  EXPECT_EQ(max_in_flight, 1);
+}
+
+TEST_P(SQP, ConstraintsAreReused)  // NOLINT
+{
+  // The convexified constraints of one iteration take the places of the previous ones instead of being compacted
+  for (bool presolve : { false, true })
+  {
+    OptProb::Ptr prob = createMixedProblem(GetParam(), presolve);
+    BasicTrustRegionSQP solver(prob);
+    setMixedParameters(solver.getParameters());
+    // The solver gets the live constraints only, never the places they left free
+    std::size_t n_checked = 0;
+    solver.addCallback([&](OptProb* p, OptResults&) {
+      const Model& model = presolve ? static_cast<const PresolveModel&>(*p->getModel()).innerModel() : *p->getModel();
+      EXPECT_EQ(model.numSolvedCnts(), model.getSize().num_cnts);
+      if (model.numSolvedCnts() > 0)
+        ++n_checked;
+    });
+    solver.initialize({ 2, 2 });
+    solver.optimize();
+    EXPECT_GT(solver.results().n_qp_solves, 3);
+    if (!(GetParam() == ModelType::GUROBI))  // Gurobi keeps its constraints itself
+    {
+      EXPECT_GT(n_checked, 3);
+    }
+    EXPECT_EQ(prob->getModel()->numCompactions(), 0);
+    if (presolve)
+    {
+      EXPECT_EQ(static_cast<const PresolveModel&>(*prob->getModel()).innerModel().numCompactions(), 0);
+    }
+  }
+}
+
+TEST_P(SQP, InexactQP)  // NOLINT
+{
+  // Loose QP tolerances in early iterations must not change the solution, neither serially nor with candidates
+  for (int candidates : { 1, 3 })
+  {
+    OptResults exact = solveMixedProblem(
+        GetParam(), [&](BasicTrustRegionSQPParameters& p) { p.num_trust_box_candidates = candidates; });
+    OptResults inexact = solveMixedProblem(GetParam(), [&](BasicTrustRegionSQPParameters& p) {
+      p.num_trust_box_candidates = candidates;
+      p.inexact_qp = true;
+    });
+    EXPECT_EQ(exact.status, inexact.status);
+    expectAllNear(exact.x, inexact.x, 1e-3);
+    expectAllNear(exact.cnt_viols, inexact.cnt_viols, 1e-4);
+    EXPECT_NEAR(vecSum(exact.cost_vals), vecSum(inexact.cost_vals), 1e-3);
+  }
+}
+
+/** Records the tolerance hint of every solve of its backend */
+template <typename Backend>
+class ToleranceRecorder : public Backend
+{
+public:
+  void setToleranceHint(double tolerance) override
+  {
+    hint_ = tolerance;
+    Backend::setToleranceHint(tolerance);
+  }
+  CvxOptStatus optimize() override
+  {
+    hints.push_back(hint_);
+    record(*this);
+    return Backend::optimize();
+  }
+
+  DblVec hints;
+  /** Called before every solve, to look at the settings of the backend */
+  std::function<void(const Backend&)> record = [](const Backend&) {};
+
+private:
+  double hint_{ 0 };
+};
+
+/** An OptProb whose convex subproblems are solved by the given model */
+class ModelProb : public OptProb
+{
+public:
+  explicit ModelProb(Model::Ptr model) { model_ = std::move(model); }
+};
+
+/** Solves the mixed problem with inexact QPs on model */
+OptResults solveInexactMixedProblem(const Model::Ptr& model, BasicTrustRegionSQPParameters& params)
+{
+  auto prob = std::make_shared<ModelProb>(model);
+  prob->createVariables({ "x_0", "x_1" });
+  addMixedTerms(*prob);
+  BasicTrustRegionSQP solver(prob);
+  setMixedParameters(solver.getParameters());
+  solver.getParameters().inexact_qp = true;
+  solver.initialize({ 2, 2 });
+  solver.optimize();
+  params = solver.getParameters();
+  return solver.results();
+}
+
+TEST(SQP, InexactQPTolerances)  // NOLINT
+{
+  // The first QP is solved with the loosest tolerance and the SQP converges on one solved with the tightest
+  auto model = std::make_shared<ToleranceRecorder<BandedQPModel>>();
+  BasicTrustRegionSQPParameters params;
+  OptResults inexact = solveInexactMixedProblem(model, params);
+  OptResults exact = solveMixedProblem(ModelType::BANDED, [](BasicTrustRegionSQPParameters&) {});
+  EXPECT_EQ(exact.status, inexact.status);
+  expectAllNear(exact.x, inexact.x, 1e-3);
+  ASSERT_GT(model->hints.size(), 2);
+  EXPECT_EQ(model->hints.front(), params.max_qp_tolerance);
+  EXPECT_EQ(model->hints.back(), params.min_qp_tolerance);
+  EXPECT_LT(params.min_qp_tolerance, params.max_qp_tolerance);
+
+#ifdef HAVE_OSQP
+  // OSQP relaxes eps_rel and skips polishing until the tolerance is back at its default
+  auto osqp = std::make_shared<ToleranceRecorder<OSQPModel>>();
+  std::vector<OSQPSettings> settings;
+  osqp->record = [&](const OSQPModel& m) { settings.push_back(m.osqpSettings()); };
+  OptResults osqp_inexact = solveInexactMixedProblem(osqp, params);
+  OptResults osqp_exact = solveMixedProblem(ModelType::OSQP, [](BasicTrustRegionSQPParameters&) {});
+  EXPECT_EQ(osqp_exact.status, osqp_inexact.status);
+  expectAllNear(osqp_exact.x, osqp_inexact.x, 1e-3);
+  ASSERT_GT(settings.size(), 2);
+  EXPECT_EQ(settings.front().eps_rel, params.max_qp_tolerance);
+  EXPECT_EQ(settings.front().polish, 0);
+  EXPECT_LT(settings.back().eps_rel, settings.front().eps_rel);
+  EXPECT_EQ(settings.back().polish, 1);
+  EXPECT_EQ(settings.back().eps_abs, settings.front().eps_abs);
+#endif
+}
+
+/** Counts how often it is copied and solved */
+class CloneCounter : public BandedQPModel
+{
+public:
+  Model::Ptr clone() const override
+  {
+    ++clones;
+    return BandedQPModel::clone();
+  }
+  CvxOptStatus optimize() override
+  {
+    ++solves;
+    return BandedQPModel::optimize();
+  }
+
+  mutable int clones{ 0 };
+  int solves{ 0 };
+};
+
+TEST(SQP, CandidateModelsAreKept)  // NOLINT
+{
+  // The copies for the trust region candidates are kept from one round to the next, so they are solved more often
+  // than they are made
+  auto model = std::make_shared<CloneCounter>();
+  auto prob = std::make_shared<ModelProb>(model);
+  prob->createVariables({ "x_0", "x_1" });
+  addMixedTerms(*prob);
+  BasicTrustRegionSQP solver(prob);
+  setMixedParameters(solver.getParameters());
+  // A large first box is rejected for all 3 candidates, so the first iteration takes several rounds
+  auto setup = [](BasicTrustRegionSQPParameters& p) {
+    p.num_trust_box_candidates = 3;
+    p.trust_box_size = 1e4;
+  };
+  setup(solver.getParameters());
+  solver.initialize({ 2, 2 });
+  solver.optimize();
+
+  OptResults serial = solveMixedProblem(ModelType::BANDED, [&](BasicTrustRegionSQPParameters& p) {
+    setup(p);
+    p.num_trust_box_candidates = 1;
+  });
+  EXPECT_EQ(serial.status, solver.results().status);
+  expectAllNear(serial.x, solver.results().x, 1e-3);
+  const int copy_solves = solver.results().n_qp_solves - model->solves;
+  LOG_INFO("%i copies solved %i QPs", model->clones, copy_solves);
+  EXPECT_GT(model->clones, 0);
+  EXPECT_LT(model->clones, copy_solves);
+}
+
+TEST_P(SQP, FilterAcceptance)  // NOLINT
+{
+  // The filter accepts every step the merit function does, and more, so it never needs more QP solves here
+  auto merit = [](BasicTrustRegionSQPParameters& p) { p.use_filter = false; };
+  auto filter = [](BasicTrustRegionSQPParameters& p) { p.use_filter = true; };
+  OptResults tp1_merit = testProblem(ScalarOfVector::construct(&f_TP1),
+                                     VectorOfVector::construct(&g_TP1),
+                                     INEQ,
+                                     { -2, 1 },
+                                     { 1, 1 },
+                                     GetParam(),
+                                     merit);
+  OptResults tp1_filter = testProblem(ScalarOfVector::construct(&f_TP1),
+                                      VectorOfVector::construct(&g_TP1),
+                                      INEQ,
+                                      { -2, 1 },
+                                      { 1, 1 },
+                                      GetParam(),
+                                      filter);
+  EXPECT_LE(tp1_filter.n_qp_solves, tp1_merit.n_qp_solves);
+
+  OptResults tp7_merit = testProblem(ScalarOfVector::construct(&f_TP7),
+                                     VectorOfVector::construct(&g_TP7),
+                                     EQ,
+                                     { 2, 2 },
+                                     { 0., sqrtf(3.) },
+                                     GetParam(),
+                                     merit);
+  OptResults tp7_filter = testProblem(ScalarOfVector::construct(&f_TP7),
+                                      VectorOfVector::construct(&g_TP7),
+                                      EQ,
+                                      { 2, 2 },
+                                      { 0., sqrtf(3.) },
+                                      GetParam(),
+                                      filter);
+  // On TP7 the merit function rejects some of the steps the filter takes
+  EXPECT_LT(tp7_filter.n_qp_solves, tp7_merit.n_qp_solves);
+
+  // An envelope that admits no violation leaves the filter no steps to take on the equality constraint of TP7
+  OptResults tp7_enveloped = testProblem(ScalarOfVector::construct(&f_TP7),
+                                         VectorOfVector::construct(&g_TP7),
+                                         EQ,
+                                         { 2, 2 },
+                                         { 0., sqrtf(3.) },
+                                         GetParam(),
+                                         [](BasicTrustRegionSQPParameters& p) {
+                                           p.use_filter = true;
+                                           p.filter_max_violation = 0;
+                                           p.filter_violation_ratio = 0;
+                                         });
+  EXPECT_EQ(tp7_enveloped.n_qp_solves, tp7_merit.n_qp_solves);
+  EXPECT_EQ(tp7_enveloped.x, tp7_merit.x);
+
+  OptResults mixed_merit = solveMixedProblem(GetParam(), merit);
+  OptResults mixed_filter = solveMixedProblem(GetParam(), filter);
+  EXPECT_EQ(mixed_merit.status, mixed_filter.status);
+  EXPECT_LE(mixed_filter.n_qp_solves, mixed_merit.n_qp_solves);
+  expectAllNear(mixed_merit.x, mixed_filter.x, 1e-3);
+}
+
+TEST_P(SQP, QuasiNewton)  // NOLINT
+{
+  // The diagonal Hessian of CostFromFunc does not capture the curved valley of the Rosenbrock function (TP2)
+  for (QuasiNewtonType type : { DAMPED_BFGS, SR1 })
+  {
+    OptProb::Ptr prob;
+    setupProblem(prob, 2, GetParam());
+    auto cost = std::make_shared<CostFromFunc>(ScalarOfVector::construct(&f_TP2), prob->getVars(), "f");
+    cost->setQuasiNewton(type);
+    prob->addCost(cost);
+    BasicTrustRegionSQP solver(prob);
+    BasicTrustRegionSQPParameters& params = solver.getParameters();
+    params.max_iter = 1000;
+    params.min_trust_box_size = 1e-5;
+    params.min_approx_improve = 1e-10;
+    solver.initialize({ -1.2, 1 });
+    EXPECT_EQ(solver.optimize(), OPT_CONVERGED);
+    expectAllNear(solver.x(), { 1, 1 }, .01);
+  }
+
+  // The curvature of the error function of an abs cost, whose error ends up at the kink of the penalty
+  OptResults linearized = solveMixedProblem(GetParam(), [](BasicTrustRegionSQPParameters&) {});
+  for (QuasiNewtonType type : { DAMPED_BFGS, SR1 })
+  {
+    OptProb::Ptr prob = createMixedProblem(GetParam());
+    auto cost = std::dynamic_pointer_cast<CostFromErrFunc>(prob->getCosts()[1]);
+    ASSERT_TRUE(cost != nullptr);
+    cost->setQuasiNewton(type);
+    BasicTrustRegionSQP solver(prob);
+    setMixedParameters(solver.getParameters());
+    solver.initialize({ 2, 2 });
+    EXPECT_EQ(solver.optimize(), linearized.status);
+    expectAllNear(solver.x(), linearized.x, 1e-3);
+    EXPECT_LE(solver.results().n_qp_solves, linearized.n_qp_solves);
+  }
+}
+
+TEST_P(SQP, BatchOptimizer)  // NOLINT
+{
+  // Optimizing problems concurrently gives the same results as one after the other
+  OptResults serial = solveMixedProblem(GetParam(), [](BasicTrustRegionSQPParameters&) {});
+
+  BasicTrustRegionSQPParameters params;
+  setMixedParameters(params);
+  BatchOptimizer batch(3);
+  for (int i = 0; i < 5; ++i)
+    EXPECT_EQ(batch.addProblem(createMixedProblem(GetParam()), { 2, 2 }, params), i);
+  // A problem that fails does not affect the others
+  std::size_t failing = batch.addProblem(createMixedProblem(GetParam()), { 2, 2, 2 }, params);
+
+  std::vector<BatchOptResults> results = batch.optimize();
+  ASSERT_EQ(results.size(), batch.size());
+  for (std::size_t i = 0; i < results.size(); ++i)
+  {
+    if (i == failing)
+    {
+      EXPECT_EQ(results[i].results.status, OPT_FAILED);
+      EXPECT_FALSE(results[i].error.empty());
+      continue;
+    }
+    EXPECT_TRUE(results[i].error.empty());
+    EXPECT_EQ(results[i].results.status, serial.status);
+    EXPECT_EQ(results[i].results.x, serial.x);
+    EXPECT_EQ(results[i].results.cost_vals, serial.cost_vals);
+    EXPECT_GT(results[i].solve_time, 0);
+    EXPECT_GE(results[i].wait_time, 0);
+  }
+}
+
+TEST_P(SQP, BatchQPCapture)  // NOLINT
+{
+  // Problems that share a capture file or an iteration log each write their QPs and iterations to their own
+  char path_template[] = "/tmp/trajopt_sco_qpsXXXXXX";
+  const int fd = mkstemp(path_template);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  const std::string path = path_template;
+  char dir_template[] = "/tmp/trajopt_sco_logXXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  const std::string dir = dir_template;
+  BasicTrustRegionSQPParameters params;
+  setMixedParameters(params);
+  params.qp_capture_file = path;
+  params.log_results = true;
+  params.log_dir = dir;
+  BatchOptimizer batch(2);
+  for (int i = 0; i < 2; ++i)
+    batch.addProblem(createMixedProblem(GetParam()), { 2, 2 }, params);
+
+  std::vector<BatchOptResults> results = batch.optimize();
+  ASSERT_EQ(results.size(), 2);
+  for (std::size_t i = 0; i < results.size(); ++i)
+  {
+    const std::string problem_path = path + "." + std::to_string(i);
+    QPCaptureReader capture(problem_path);
+    EXPECT_EQ(capture.size(), results[i].results.n_qp_solves);
+    std::remove(problem_path.c_str());
+
+    const std::string log_path = dir + "/trajopt_iterations.bin." + std::to_string(i);
+    IterationLogReader reader(log_path);
+    BasicTrustRegionSQPResults record(reader.varNames(), reader.costNames(), reader.cntNames());
+    int n_records = 0;
+    while (reader.next(record))
+      ++n_records;
+    EXPECT_EQ(n_records, results[i].results.n_func_evals - 1);
+    std::remove(log_path.c_str());
+  }
+  std::remove(path.c_str());
+  rmdir(dir.c_str());
+}
+
+double f_slow(const VectorXd& x)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  return f_TP7(x);
+}
+
+TEST_P(SQP, TimeLimit)  // NOLINT
+{
+  // A zero budget returns the initial point
+  OptResults none = solveMixedProblem(GetParam(), [](BasicTrustRegionSQPParameters& p) { p.max_time = 0; });
+  EXPECT_EQ(none.status, OPT_TIME_LIMIT);
+  EXPECT_EQ(statusToString(none.status), "TIME_LIMIT");
+  EXPECT_EQ(none.x, DblVec({ 2, 2 }));
+
+  // A slow cost is interrupted close to the deadline and the last accepted iterate is returned
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, GetParam());
+  prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_slow), prob->getVars(), "slow", true)));
+  prob->addConstraint(Constraint::Ptr(
+      new ConstraintFromErrFunc(VectorOfVector::construct(&g_TP7), prob->getVars(), VectorXd(), EQ, "g7")));
+  BasicTrustRegionSQP solver(prob);
+  BasicTrustRegionSQPParameters& params = solver.getParameters();
+  params.max_iter = 1000;
+  params.min_trust_box_size = 1e-9;
+  params.min_approx_improve = 1e-14;
+  params.max_time = 0.05;
+  solver.initialize({ 2, 2 });
+
+  auto start = std::chrono::steady_clock::now();
+  OptStatus status = solver.optimize();
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_EQ(status, OPT_TIME_LIMIT);
+  EXPECT_LT(elapsed, 0.5);
+  ASSERT_EQ(solver.results().cost_vals.size(), 1);
+  EXPECT_EQ(solver.results().cost_vals[0], f_TP7(Eigen::Map<const VectorXd>(solver.x().data(), 2)));
+}
+
+/** Records the points a constraint is convexified at */
+class RecordingConstraint : public ConstraintFromErrFunc
+{
+public:
+  using ConstraintFromErrFunc::ConstraintFromErrFunc;
+  ConvexConstraints::Ptr convex(const DblVec& x, Model* model) override
+  {
+    convexified_at.push_back(x);
+    return ConstraintFromErrFunc::convex(x, model);
+  }
+  std::vector<DblVec> convexified_at;
+};
+
+TEST_P(SQP, PenaltyIncreaseReusesConvexification)  // NOLINT
+{
+  // A tiny initial penalty forces several penalty increases. None of them may convexify the same point twice.
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, GetParam());
+  prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_TP7), prob->getVars(), "f", true)));
+  auto cnt = std::make_shared<RecordingConstraint>(
+      VectorOfVector::construct(&g_TP7), prob->getVars(), VectorXd(), EQ, "g7");
+  prob->addConstraint(cnt);
+  BasicTrustRegionSQP solver(prob);
+  BasicTrustRegionSQPParameters& params = solver.getParameters();
+  params.initial_merit_error_coeff = 1e-3;
+  params.max_merit_coeff_increases = 10;
+  solver.initialize({ 2, 2 });
+  OptStatus status = solver.optimize();
+
+  EXPECT_EQ(status, OPT_CONVERGED);
+  EXPECT_LT(vecMax(solver.results().cnt_viols), params.cnt_tolerance);
+  ASSERT_FALSE(cnt->convexified_at.empty());
+  for (std::size_t i = 1; i < cnt->convexified_at.size(); ++i)
+    EXPECT_NE(cnt->convexified_at[i - 1], cnt->convexified_at[i]);
+}
+
+/** Counts every evaluation as a cache hit, after one miss on construction */
+class CachingConstraint : public ConstraintFromErrFunc
+{
+public:
+  using ConstraintFromErrFunc::ConstraintFromErrFunc;
+  DblVec value(const DblVec& x) override
+  {
+    ++hits;
+    return ConstraintFromErrFunc::value(x);
+  }
+  CacheStats getCacheStats() override { return { hits, 1 }; }
+  std::size_t hits{ 0 };
+};
+
+TEST_P(SQP, Profile)  // NOLINT
+{
+  std::shared_ptr<CachingConstraint> cnt;
+  auto solve = [&](bool profile) {
+    OptProb::Ptr prob = createMixedProblem(GetParam());
+    cnt = std::make_shared<CachingConstraint>(
+        VectorOfVector::construct(&g_TP3), prob->getVars(), VectorXd(), INEQ, "cached");
+    prob->addConstraint(cnt);
+    BasicTrustRegionSQP solver(prob);
+    setMixedParameters(solver.getParameters());
+    solver.getParameters().profile = profile;
+    solver.initialize({ 2, 2 });
+    solver.optimize();
+    return solver.results();
+  };
+
+  OptResults plain = solve(false);
+  EXPECT_TRUE(plain.profile.iterations.empty());
+  EXPECT_TRUE(plain.profile.terms.empty());
+  EXPECT_EQ(plain.profile.total.sum(), 0);
+
+  // Profiling must not change the optimization
+  OptResults profiled = solve(true);
+  EXPECT_EQ(profiled.n_qp_solves, plain.n_qp_solves);
+  EXPECT_EQ(profiled.x, plain.x);
+
+  const OptProfile& profile = profiled.profile;
+  ASSERT_FALSE(profile.iterations.empty());
+  EXPECT_GT(profile.total.convexify, 0);
+  EXPECT_GT(profile.total.model_build, 0);
+  EXPECT_GT(profile.total.qp_solve, 0);
+  EXPECT_GT(profile.total.evaluate, 0);
+  OptProfile::PhaseTimes iterations;
+  for (const OptProfile::PhaseTimes& times : profile.iterations)
+    iterations += times;
+  EXPECT_LE(iterations.sum(), profile.total.sum());
+
+  for (const char* name : { "f", "abs", "g7", "g3", "cached" })
+  {
+    ASSERT_EQ(profile.terms.count(name), 1) << name;
+    EXPECT_GT(profile.terms.at(name).convexify_time, 0) << name;
+    EXPECT_GT(profile.terms.at(name).evaluate_time, 0) << name;
+  }
+  EXPECT_EQ(profile.terms.at("cached").cache.hits, cnt->hits);
+  EXPECT_EQ(profile.terms.at("cached").cache.misses, 0);
+  EXPECT_EQ(profile.terms.at("f").cache.hits + profile.terms.at("f").cache.misses, 0);
+  EXPECT_GE(profile.peak_qp_size.num_vars, 2);
+  EXPECT_GT(profile.peak_qp_size.num_cnts, 0);
+}
+
+TEST_P(SQP, IterationLog)  // NOLINT
+{
+  char dir_template[] = "/tmp/trajopt_sco_logXXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  const std::string dir = dir_template;
+  OptResults results = solveMixedProblem(GetParam(), [&](BasicTrustRegionSQPParameters& p) {
+    p.log_results = true;
+    p.log_dir = dir;
+  });
+
+  // Every iteration after the evaluation of the initial point is logged
+  IterationLogReader reader(dir + "/trajopt_iterations.bin");
+  EXPECT_EQ(reader.varNames().size(), 2);
+  EXPECT_EQ(reader.costNames(), std::vector<std::string>({ "f", "abs" }));
+  EXPECT_EQ(reader.cntNames(), std::vector<std::string>({ "g7", "g3" }));
+  BasicTrustRegionSQPResults record(reader.varNames(), reader.costNames(), reader.cntNames());
+  int n_records = 0;
+  bool found_x = false;
+  while (reader.next(record))
+  {
+    ++n_records;
+    EXPECT_EQ(record.merit_error_coeffs.size(), 2);
+    found_x = found_x || (record.new_x == results.x);
+  }
+  EXPECT_EQ(n_records, results.n_func_evals - 1);
+  EXPECT_TRUE(found_x);
+
+  EXPECT_EQ(iterationLogToCsv(dir + "/trajopt_iterations.bin", dir), n_records);
+  std::ifstream vars(dir + "/trajopt_vars.log");
+  std::string line;
+  ASSERT_TRUE(std::getline(vars, line));
+  EXPECT_EQ(line.substr(0, 6), "NAMES,");
+  int n_lines = 1;
+  while (std::getline(vars, line))
+    ++n_lines;
+  EXPECT_EQ(n_lines, n_records + 1);
+
+  // A writer that can not keep up drops records instead of blocking
+  {
+    IterationLogWriter writer(dir + "/flood.bin", reader.varNames(), reader.costNames(), reader.cntNames(), 2);
+    int n_pushed = 0;
+    for (int i = 0; i < 1000; ++i)
+      n_pushed += writer.push(record) ? 1 : 0;
+    EXPECT_EQ(writer.dropped(), 1000 - n_pushed);
+    n_records = n_pushed;
+  }
+  IterationLogReader flood(dir + "/flood.bin");
+  int n_read = 0;
+  while (flood.next(record))
+    ++n_read;
+  EXPECT_EQ(n_read, n_records);
+
+  for (const char* file : { "trajopt_iterations.bin",
+                            "flood.bin",
+                            "trajopt_solver.log",
+                            "trajopt_vars.log",
+                            "trajopt_costs.log",
+                            "trajopt_constraints.log" })
+    std::remove((dir + "/" + file).c_str());
+  rmdir(dir.c_str());
+}
+
+TEST_P(SQP, QPCapture)  // NOLINT
+{
+  char path_template[] = "/tmp/trajopt_sco_qpsXXXXXX";
+  const int fd = mkstemp(path_template);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  const std::string path = path_template;
+  OptResults results = solveMixedProblem(GetParam(), [&](BasicTrustRegionSQPParameters& p) {
+    p.qp_capture_file = path;
+    p.num_trust_box_candidates = 2;
+  });
+
+  // Every QP is captured, and replaying one builds a model that exports the same QP
+  QPCaptureReader capture(path);
+  EXPECT_EQ(capture.size(), results.n_qp_solves);
+  for (std::size_t i = 0; i < capture.size(); ++i)
+  {
+    const QPData qp = capture.get(i);
+    EXPECT_EQ(qp.numVars(), qp.ub.size());
+    Model::Ptr model = createModel(qp, GetParam());
+    EXPECT_EQ(model->optimize(), CVX_SOLVED);
+
+    QPData replayed;
+    ASSERT_TRUE(model->exportQP(replayed));
+    EXPECT_EQ(replayed.lb, qp.lb);
+    EXPECT_EQ(replayed.ub, qp.ub);
+    EXPECT_EQ(replayed.q, qp.q);
+    EXPECT_EQ(replayed.objective_constant, qp.objective_constant);
+    EXPECT_EQ(replayed.P_rows, qp.P_rows);
+    EXPECT_EQ(replayed.P_cols, qp.P_cols);
+    EXPECT_EQ(replayed.P_vals, qp.P_vals);
+    EXPECT_EQ(replayed.A_rows, qp.A_rows);
+    EXPECT_EQ(replayed.A_cols, qp.A_cols);
+    EXPECT_EQ(replayed.A_vals, qp.A_vals);
+    EXPECT_EQ(replayed.l, qp.l);
+    EXPECT_EQ(replayed.u, qp.u);
+  }
+  std::remove(path.c_str());
+}
+
+static auto getAvailableSolvers = []() {
   std::vector<ModelType> solvers = availableSolvers();
   auto it = std::find(solvers.begin(), solvers.end(), ModelType::OSQP);
   if (it != solvers.end())
@@ -1,12 +1,28 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cmath>
+#include <csignal>
 #include <cstdio>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <utility>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+#include <trajopt_sco/auto_solver_model.hpp>
+#include <trajopt_sco/banded_interface.hpp>
+#include <trajopt_sco/bpmpd_interface.hpp>
+#include <trajopt_sco/compact_expr.hpp>
+#include <trajopt_sco/expr_accumulator.hpp>
 #include <trajopt_sco/expr_ops.hpp>
+#include <trajopt_sco/presolve_model.hpp>
+#include <trajopt_sco/qp_capture.hpp>
 #include <trajopt_sco/solver_interface.hpp>
+#include <trajopt_sco/solver_selection.hpp>
 #include <trajopt_utils/logging.hpp>
 #include <trajopt_utils/stl_to_string.hpp>
 
@@ -30,6 +46,269 @@ TEST(SolverInterface, simplify2)  // NOLINT
   EXPECT_TRUE((values == DblVec{ 1e-7, 1e3 }));
 }
 
+TEST(SolverInterface, ExprAccumulator)  // NOLINT
+{
+  std::vector<VarRep::Ptr> reps;
+  VarVector x;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    reps.push_back(std::make_shared<VarRep>(i, "x", nullptr));
+    x.emplace_back(reps.back().get());
+  }
+
+  // 2*x0*x1 + x1*x0 + x2^2 + 3*x0 - x0 + x2 + 1
+  QuadExpr a;
+  a.vars1 = { x[0], x[1] };
+  a.vars2 = { x[1], x[0] };
+  a.coeffs = { 2, 1 };
+  a.affexpr.vars = { x[0], x[2] };
+  a.affexpr.coeffs = { 3, 1 };
+  a.affexpr.constant = 1;
+  QuadExpr b;
+  b.vars1 = { x[2] };
+  b.vars2 = { x[2] };
+  b.coeffs = { 1 };
+  b.affexpr.vars = { x[0] };
+  b.affexpr.coeffs = { -1 };
+
+  ExprAccumulator acc;
+  acc.add(a);
+  acc.add(b);
+  const QuadExpr merged = acc.expr();
+  ASSERT_EQ(merged.size(), 2);
+  ASSERT_EQ(merged.affexpr.size(), 2);
+  EXPECT_EQ(merged.vars1[0].var_rep, x[0].var_rep);
+  EXPECT_EQ(merged.vars2[0].var_rep, x[1].var_rep);
+  EXPECT_EQ(merged.coeffs[0], 3);
+  EXPECT_EQ(merged.affexpr.coeffs[0], 2);
+  EXPECT_EQ(merged.affexpr.constant, 1);
+
+  QuadExpr appended = a;
+  exprInc(appended, b);
+  const DblVec vals{ 0.5, -2, 3 };
+  EXPECT_DOUBLE_EQ(merged.value(vals), appended.value(vals));
+
+  // Accumulating again after clear() gives the same expression
+  acc.clear();
+  EXPECT_EQ(acc.expr().size(), 0);
+  acc.add(a);
+  acc.add(b);
+  EXPECT_EQ(acc.expr().coeffs, merged.coeffs);
+}
+
+TEST(SolverInterface, CompactExpr)  // NOLINT
+{
+  std::vector<VarRep::Ptr> reps;
+  VarVector x;
+  for (std::size_t i = 0; i < 7; ++i)
+  {
+    reps.push_back(std::make_shared<VarRep>(i, "x", nullptr));
+    x.emplace_back(reps.back().get());
+  }
+
+  QuadExpr quad;
+  quad.affexpr.constant = 0.5;
+  for (std::size_t i = 0; i < x.size(); ++i)
+  {
+    quad.affexpr.vars.push_back(x[(3 * i) % x.size()]);
+    quad.affexpr.coeffs.push_back(static_cast<double>(i) - 2.);
+    quad.vars1.push_back(x[i]);
+    quad.vars2.push_back(x[(i + 2) % x.size()]);
+    quad.coeffs.push_back(0.25 * static_cast<double>(i));
+  }
+
+  const DblVec vals{ 1, -2, 0.5, 3, -1.5, 2, 4 };
+  CompactQuadExpr compact(quad);
+  EXPECT_NEAR(compact.affexpr.value(vals), quad.affexpr.value(vals), 1e-12);
+  EXPECT_NEAR(compact.value(vals), quad.value(vals), 1e-12);
+
+  QuadExpr round_trip = toQuadExpr(compact, x);
+  ASSERT_EQ(round_trip.size(), quad.size());
+  for (std::size_t i = 0; i < quad.size(); ++i)
+  {
+    EXPECT_EQ(round_trip.vars1[i].var_rep, quad.vars1[i].var_rep);
+    EXPECT_EQ(round_trip.vars2[i].var_rep, quad.vars2[i].var_rep);
+  }
+  EXPECT_EQ(round_trip.value(vals), quad.value(vals));
+
+  exprInc(compact.affexpr, CompactAffExpr(AffExpr(x[6])));
+  EXPECT_NEAR(compact.affexpr.value(vals), quad.affexpr.value(vals) + vals[6], 1e-12);
+}
+
+TEST(SolverInterface, ModelTypeValues)  // NOLINT
+{
+  // The values are stored in QP captures, so backends are only ever appended
+  EXPECT_EQ(static_cast<int>(ModelType(ModelType::AUTO_SOLVER)), 4);
+  for (std::size_t i = 0; i < ModelType::MODEL_NAMES_.size(); ++i)
+    EXPECT_EQ(static_cast<int>(ModelType(ModelType::MODEL_NAMES_[i])), static_cast<int>(i));
+  for (const ModelType& type : availableSolvers())
+    EXPECT_FALSE(type == ModelType::AUTO_SOLVER);
+}
+
+TEST(SolverInterface, ModelTypeNames)  // NOLINT
+{
+  // Names are looked up by value, e.g. for TRAJOPT_CONVEX_SOLVER and the solver of a JSON problem
+  const std::vector<std::pair<ModelType::Value, std::string>> names = {
+    { ModelType::GUROBI, "GUROBI" },
+    { ModelType::OSQP, "OSQP" },
+    { ModelType::QPOASES, "QPOASES" },
+    { ModelType::BPMPD, "BPMPD" },
+    { ModelType::AUTO_SOLVER, "AUTO_SOLVER" },
+    { ModelType::BANDED, "BANDED" },
+  };
+  EXPECT_EQ(names.size(), ModelType::MODEL_NAMES_.size());
+  for (const auto& name : names)
+  {
+    std::stringstream printed;
+    printed << ModelType(name.first);
+    EXPECT_EQ(printed.str(), name.second);
+    EXPECT_TRUE(ModelType(name.second) == name.first) << name.second;
+
+    ModelType from_json;
+    from_json.fromJson(Json::Value(name.second));
+    EXPECT_TRUE(from_json == name.first) << name.second;
+  }
+}
+
+TEST(SolverInterface, SolverSelection)  // NOLINT
+{
+  QPFeatures small;
+  small.num_vars = 20;
+  small.num_eq_cnts = 5;
+  small.num_ineq_cnts = 5;
+  small.cnt_nonzeros = 40;
+  EXPECT_DOUBLE_EQ(small.eqFraction(), 0.5);
+  EXPECT_DOUBLE_EQ(small.density(), 0.2);
+
+  QPFeatures large_sparse = small;
+  large_sparse.num_vars = 1000;
+  QPFeatures large_dense = large_sparse;
+  large_dense.cnt_nonzeros = 5000;
+
+  const std::vector<ModelType> available = availableSolvers();
+  auto expected = [&](ModelType preferred) {
+    return (std::find(available.begin(), available.end(), preferred) != available.end()) ? preferred : available[0];
+  };
+  SolverSelectionThresholds thresholds;
+  EXPECT_EQ(selectModelType(small, thresholds), expected(ModelType::QPOASES));
+  EXPECT_EQ(selectModelType(large_sparse, thresholds), expected(ModelType::OSQP));
+  EXPECT_EQ(selectModelType(large_dense, thresholds), expected(ModelType::BPMPD));
+
+  // Too few equalities for the active set solver
+  thresholds.active_set_min_eq_fraction = 0.75;
+  EXPECT_EQ(selectModelType(small, thresholds), available[0]);
+
+  char path[] = "/tmp/trajopt_solver_selection_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_NE(fd, -1);
+  close(fd);
+  thresholds.large_min_vars = 1234;
+  saveSolverSelectionThresholds(path, thresholds);
+  const SolverSelectionThresholds loaded = loadSolverSelectionThresholds(path);
+  std::remove(path);
+  EXPECT_EQ(loaded.active_set_max_vars, thresholds.active_set_max_vars);
+  EXPECT_DOUBLE_EQ(loaded.active_set_min_eq_fraction, thresholds.active_set_min_eq_fraction);
+  EXPECT_EQ(loaded.large_min_vars, thresholds.large_min_vars);
+  EXPECT_DOUBLE_EQ(loaded.sparse_max_density, thresholds.sparse_max_density);
+
+  EXPECT_TRUE(createModel(ModelType::AUTO_SOLVER, large_dense) != nullptr);
+}
+
+TEST(SolverInterface, SolverSelectionOnOptimize)  // NOLINT
+{
+  // With AUTO_SOLVER the backend is chosen by the size of the first QP, not by what is known when the model is made
+  AutoSolverModel auto_solver;
+  Model& model = auto_solver;
+  VarVector x;
+  for (int i = 0; i < 3; ++i)
+    x.push_back(model.addVar("x", -10, 10));
+  model.setVarBounds(x[2], 1, 1);
+  Cnt eq = model.addEqCnt(exprSub(exprAdd(AffExpr(x[0]), x[1]), 1), "");
+  QuadExpr obj;
+  for (const Var& v : x)
+    exprInc(obj, exprSquare(v));
+  model.setObjective(obj);
+  model.update();
+
+  QPData qp;
+  ASSERT_TRUE(model.exportQP(qp));
+  EXPECT_EQ(qp.dual_layout, ModelType::AUTO_SOLVER);
+
+  ASSERT_EQ(model.optimize(), CVX_SOLVED);
+  EXPECT_NEAR(model.getVarValue(x[0]), 0.5, 1e-4);
+  EXPECT_NEAR(model.getVarValue(x[1]), 0.5, 1e-4);
+  EXPECT_NEAR(model.getVarValue(x[2]), 1, 1e-6);
+  ASSERT_TRUE(auto_solver.backend() != nullptr);
+  EXPECT_EQ(auto_solver.backend()->getSize().num_vars, 3);
+  EXPECT_EQ(auto_solver.backend()->getSize().num_cnts, 1);
+
+  QPFeatures features;
+  features.num_vars = 3;
+  features.num_eq_cnts = 1;
+  features.cnt_nonzeros = 2;
+  EXPECT_EQ(auto_solver.backendType(), resolveModelType(ModelType::AUTO_SOLVER, features));
+  ASSERT_TRUE(model.exportQP(qp));
+  EXPECT_EQ(qp.dual_layout, auto_solver.backendType());
+
+  // From then on the calls go to the backend, with the handles from before the choice as well as new ones
+  const Model* backend = auto_solver.backend();
+  Var y = model.addVar("y", -10, 10);
+  Cnt c = model.addIneqCnt(exprSub(AffExpr(y), AffExpr(x[0])), "");
+  exprInc(obj, exprSquare(exprSub(AffExpr(y), 2)));
+  model.setObjective(obj);
+  model.update();
+  ASSERT_EQ(model.optimize(), CVX_SOLVED);
+  EXPECT_EQ(auto_solver.backend(), backend);
+  EXPECT_EQ(model.getVars().size(), 4);
+  EXPECT_NEAR(model.getVarValue(x[0]), model.getVarValue(y), 1e-4);
+  model.removeCnt(c);
+  model.setVarBounds(x[2], 2, 2);
+  model.update();
+  ASSERT_EQ(model.optimize(), CVX_SOLVED);
+  EXPECT_NEAR(model.getVarValue(x[2]), 2, 1e-6);
+  EXPECT_NEAR(model.getVarValue(y), 2, 1e-4);
+  EXPECT_EQ(backend->getSize().num_cnts, 1);
+
+  // Removing a variable after the choice renumbers the backend, the handles still find their own variables
+  model.removeCnt(eq);
+  model.removeVars({ x[0], y });
+  obj = QuadExpr();
+  for (int i = 1; i < 3; ++i)
+    exprInc(obj, exprSquare(exprSub(AffExpr(x[static_cast<std::size_t>(i)]), i + 1)));
+  model.setObjective(obj);
+  model.update();
+  ASSERT_EQ(model.optimize(), CVX_SOLVED);
+  EXPECT_EQ(model.getVars().size(), 2);
+  EXPECT_NEAR(model.getVarValue(x[1]), 2, 1e-4);
+  EXPECT_NEAR(model.getVarValue(x[2]), 2, 1e-6);
+  model.setVarBounds(x[2], 3, 3);
+  ASSERT_EQ(model.optimize(), CVX_SOLVED);
+  EXPECT_NEAR(model.getVarValue(x[1]), 2, 1e-4);
+  EXPECT_NEAR(model.getVarValue(x[2]), 3, 1e-6);
+}
+
+TEST(SolverInterface, QPDataSkipsFreeSlots)  // NOLINT
+{
+  // A free constraint slot is left out of the rows and of the multipliers of the warm start alike
+  AutoSolverModel model;
+  VarVector x;
+  for (int i = 0; i < 2; ++i)
+    x.push_back(model.addVar("x"));
+  const AffExprVector cnt_exprs = { AffExpr(x[0]), AffExpr(x[1]), exprAdd(AffExpr(x[0]), x[1]) };
+  const ConstraintTypeVector cnt_types = { EQ, INEQ, INEQ };
+  const DblVec bounds(2, 0);
+  QPData qp;
+  toQPData(x, bounds, bounds, QuadExpr(), cnt_exprs, cnt_types, { 1 }, qp, { 1, 2, 3, 4, 5 }, 0);
+  EXPECT_EQ(qp.numCnts(), 2);
+  EXPECT_EQ(qp.warm_dual, DblVec({ 1, 3, 4, 5 }));
+  toQPData(x, bounds, bounds, QuadExpr(), cnt_exprs, cnt_types, { 1 }, qp, { 1, 2, 3, 4, 5 }, 2);
+  EXPECT_EQ(qp.warm_dual, DblVec({ 1, 2, 3, 5 }));
+
+  // Multipliers of another layout are left out
+  toQPData(x, bounds, bounds, QuadExpr(), cnt_exprs, cnt_types, { 1 }, qp, { 1, 2, 3, 4 }, 0);
+  EXPECT_TRUE(qp.warm_dual.empty());
+}
+
 TEST_P(SolverInterface, setup_problem)  // NOLINT
 {
   Model::Ptr solver = createModel(GetParam());
@@ -72,6 +351,501 @@ TEST_P(SolverInterface, setup_problem)  // NOLINT
   EXPECT_EQ(solver->getVars().size(), 2);
 }
 
+TEST_P(SolverInterface, AuxVarPool)  // NOLINT
+{
+  Model::Ptr solver = createModel(GetParam());
+  Var x = solver->addVar("x", -10, 10);
+  VarVector aux;
+  for (int i = 0; i < 3; ++i)
+    aux.push_back(solver->addAuxVar("hinge", 0, INFINITY));
+  solver->update();
+  EXPECT_EQ(solver->getVars().size(), 4);
+
+  // Released variables are reused lowest index first, without changing the layout of the model
+  solver->releaseAuxVars({ aux[2], aux[0], aux[1] });
+  solver->update();
+  EXPECT_EQ(solver->numFreeAuxVars(), 3);
+  EXPECT_EQ(solver->getVars().size(), 4);
+  Var reused = solver->addAuxVar("abs", 0, INFINITY);
+  EXPECT_EQ(reused.var_rep, aux[0].var_rep);
+  EXPECT_EQ(solver->numFreeAuxVars(), 2);
+
+  // Free variables are fixed to zero and do not affect the solution
+  AffExpr cost(reused);
+  exprDec(cost, x);
+  solver->setObjective(cost);
+  AffExpr x_le_one(x);
+  x_le_one.constant = -1;
+  solver->addIneqCnt(x_le_one, "");
+  solver->update();
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(solver->getVarValue(x), 1, 1e-4);
+  EXPECT_NEAR(solver->getVarValue(aux[1]), 0, 1e-6);
+  EXPECT_NEAR(solver->getVarValue(aux[2]), 0, 1e-6);
+}
+
+TEST_P(SolverInterface, RepRecycling)  // NOLINT
+{
+  Model::Ptr solver = createModel(GetParam());
+  VarVector vars;
+  for (int i = 0; i < 20; ++i)
+    vars.push_back(solver->addVar("x", -1, 1));
+  solver->update();
+  const std::size_t avoided = solver->numRepAllocationsAvoided();
+  EXPECT_GT(avoided, 0);
+
+  // Removed reps are recycled for the next addition
+  VarRep* removed = vars.back().var_rep;
+  solver->removeVar(vars.back());
+  solver->update();
+  Var added = solver->addVar("y", -1, 1);
+  solver->update();
+  EXPECT_EQ(added.var_rep, removed);
+  EXPECT_EQ(added.var_rep->name, "y");
+  EXPECT_EQ(added.var_rep->index, 19);
+  EXPECT_EQ(solver->numRepAllocationsAvoided(), avoided + 1);
+}
+
+TEST_P(SolverInterface, RemovedEntriesAreReused)  // NOLINT
+{
+  Model::Ptr solver = createModel(GetParam());
+  VarVector x;
+  for (int i = 0; i < 4; ++i)
+    x.push_back(solver->addVar("x", -10, 10));
+  // min sum((x_i - 1)^2) over the first three variables s.t. x_0 <= 0, x_1 <= 0
+  QuadExpr obj;
+  for (int i = 0; i < 3; ++i)
+    exprInc(obj, exprSquare(exprAdd(AffExpr(x[static_cast<std::size_t>(i)]), -1)));
+  solver->setObjective(obj);
+  Cnt c0 = solver->addIneqCnt(AffExpr(x[0]), "");
+  solver->addIneqCnt(AffExpr(x[1]), "");
+  solver->update();
+
+  // A removed constraint keeps its place for the next addition, removed variables are dropped right away
+  const std::size_t c0_index = c0.cnt_rep->index;
+  solver->removeCnt(c0);
+  solver->removeVar(x[3]);
+  solver->update();
+  EXPECT_EQ(solver->getVars().size(), 3);
+  Cnt c2 = solver->addIneqCnt(AffExpr(x[2]), "");
+  solver->update();
+  EXPECT_EQ(c2.cnt_rep->index, c0_index);
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(solver->getVarValue(x[0]), 1, 1e-4);
+  EXPECT_NEAR(solver->getVarValue(x[1]), 0, 1e-4);
+  EXPECT_NEAR(solver->getVarValue(x[2]), 0, 1e-4);
+
+  // A removal that is not committed yet hands its place over as well
+  solver->removeCnt(c2);
+  Cnt c3 = solver->addIneqCnt(AffExpr(x[0]), "");
+  EXPECT_EQ(c3.cnt_rep->index, c0_index);
+
+  // A place that is still free when the model is solved is dropped, the solver only gets the live constraints
+  solver->removeCnt(c3);
+  Var y = solver->addVar("y", 2, 3);
+  solver->update();
+  EXPECT_EQ(y.var_rep->index, 3);
+  EXPECT_EQ(solver->getVars().size(), 4);
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(solver->getVarValue(x[0]), 1, 1e-4);
+  EXPECT_NEAR(solver->getVarValue(x[1]), 0, 1e-4);
+  EXPECT_NEAR(solver->getVarValue(x[2]), 1, 1e-4);
+  EXPECT_NEAR(solver->getVarValue(y), 2, 1e-4);
+  if (!(GetParam() == ModelType::GUROBI))  // Gurobi keeps its constraints itself
+  {
+    EXPECT_EQ(solver->numCompactions(), 1);
+    EXPECT_EQ(solver->numSolvedCnts(), 1);
+  }
+}
+
+TEST_P(SolverInterface, Clone)  // NOLINT
+{
+  Model::Ptr solver = createModel(GetParam());
+  VarVector x;
+  for (int i = 0; i < 3; ++i)
+    x.push_back(solver->addVar("x", -10, 10));
+  QuadExpr obj;
+  for (const Var& var : x)
+    exprInc(obj, exprSquare(exprAdd(AffExpr(var), -1)));
+  solver->setObjective(obj);
+  Cnt c0 = solver->addIneqCnt(AffExpr(x[0]), "");
+  solver->addIneqCnt(AffExpr(x[1]), "");
+  solver->update();
+  const std::size_t c0_index = c0.cnt_rep->index;
+  solver->removeCnt(c0);
+  solver->update();
+
+  Model::Ptr copy = solver->clone();
+  if (!copy)
+    return;  // not supported by this backend
+  VarVector copy_vars = copy->getVars();
+  ASSERT_EQ(copy_vars.size(), x.size());
+  for (std::size_t i = 0; i < x.size(); ++i)
+    EXPECT_EQ(copy_vars[i].var_rep->index, i);
+
+  // The removed constraint is reused in the copy as in the original
+  Cnt c2 = copy->addIneqCnt(AffExpr(copy_vars[0]), "");
+  copy->update();
+  EXPECT_EQ(c2.cnt_rep->index, c0_index);
+
+  // Changing the copy does not change the original
+  copy->setVarBounds(copy_vars[2], -10, 0);
+  ASSERT_EQ(copy->optimize(), CVX_SOLVED);
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(copy->getVarValue(copy_vars[0]), 0, 1e-4);
+  EXPECT_NEAR(copy->getVarValue(copy_vars[1]), 0, 1e-4);
+  EXPECT_NEAR(copy->getVarValue(copy_vars[2]), 0, 1e-4);
+  EXPECT_NEAR(solver->getVarValue(x[0]), 1, 1e-4);
+  EXPECT_NEAR(solver->getVarValue(x[2]), 1, 1e-4);
+}
+
+TEST_P(SolverInterface, WarmStart)  // NOLINT
+{
+  Model::Ptr solver = createModel(GetParam());
+  VarVector vars;
+  for (int i = 0; i < 2; ++i)
+    vars.push_back(solver->addVar("v" + std::to_string(i), -10, 10));
+  solver->update();
+
+  AffExpr aff(vars[0]);
+  exprInc(aff, vars[1]);
+  aff.constant = -3;
+  solver->setObjective(exprSquare(aff));
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(aff.value(solver->getVarValues(vars)), 0, 1e-4);
+
+  // Shrinking the bounds and starting from the previous solution must give the new optimum
+  DblVec primal = solver->getVarValues(solver->getVars());
+  solver->setVarBounds(vars, DblVec(2, -1), DblVec(2, 1));
+  solver->setWarmStart(primal, solver->getDualValues());
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(solver->getVarValue(vars[0]), 1, 1e-3);
+  EXPECT_NEAR(solver->getVarValue(vars[1]), 1, 1e-3);
+}
+
+/**
+ * A trajectory of n_steps x n_dof variables with velocity and acceleration costs, fixed start, a goal constraint and
+ * a hinge cost per step whose auxiliary variables are created after the trajectory, as trajopt does
+ */
+static Model::Ptr trajectoryModel(Model::Ptr model, int n_steps, int n_dof, QuadExpr& objective)
+{
+  std::vector<VarVector> x(static_cast<std::size_t>(n_steps));
+  for (int t = 0; t < n_steps; ++t)
+    for (int j = 0; j < n_dof; ++j)
+      x[static_cast<std::size_t>(t)].push_back(model->addVar("x", (t == 0) ? 0 : -2, (t == 0) ? 0 : 2));
+  VarVector hinge;
+  for (int t = 0; t < n_steps; ++t)
+    hinge.push_back(model->addVar("h", 0, 10));
+  model->update();
+
+  objective = QuadExpr();
+  for (std::size_t t = 0; t < x.size(); ++t)
+  {
+    for (std::size_t j = 0; j < x[t].size(); ++j)
+    {
+      if (t + 1 < x.size())
+        exprInc(objective, exprSquare(exprSub(AffExpr(x[t + 1][j]), AffExpr(x[t][j]))));
+      if (t + 2 < x.size())
+      {
+        AffExpr acc(x[t + 2][j]);
+        exprInc(acc, exprMult(AffExpr(x[t + 1][j]), -2));
+        exprInc(acc, x[t][j]);
+        exprInc(objective, exprSquare(acc));
+      }
+    }
+    // h_t >= x_t0 - 0.5, penalized linearly
+    AffExpr hinge_cnt(x[t][0]);
+    exprDec(hinge_cnt, hinge[t]);
+    hinge_cnt.constant = -0.5;
+    model->addIneqCnt(hinge_cnt, "");
+    exprInc(objective, exprMult(AffExpr(hinge[t]), 10));
+  }
+  for (const Var& var : x.back())
+    model->addEqCnt(exprAdd(AffExpr(var), -1), "");
+  model->setObjective(objective);
+  model->update();
+  return model;
+}
+
+static Model::Ptr trajectoryModel(ModelType model_type, int n_steps, int n_dof, QuadExpr& objective)
+{
+  return trajectoryModel(createModel(model_type), n_steps, n_dof, objective);
+}
+
+TEST(SolverInterface, BandedTrajectory)  // NOLINT
+{
+  const int n_dof = 3;
+  std::vector<std::size_t> bandwidths;
+  for (int n_steps : { 30, 120 })
+  {
+    QuadExpr objective;
+    Model::Ptr model = trajectoryModel(ModelType::BANDED, n_steps, n_dof, objective);
+    ASSERT_EQ(model->optimize(), CVX_SOLVED);
+    const double value = objective.value(model->getVarValues(model->getVars()));
+    bandwidths.push_back(std::static_pointer_cast<BandedQPModel>(model)->lastResult().bandwidth);
+
+    QuadExpr reference_objective;
+    Model::Ptr reference = trajectoryModel(availableSolvers()[0], n_steps, n_dof, reference_objective);
+    ASSERT_EQ(reference->optimize(), CVX_SOLVED);
+    EXPECT_NEAR(value, reference_objective.value(reference->getVarValues(reference->getVars())), 1e-4);
+  }
+
+  // The appended auxiliary variables are ordered next to their time step, so the bandwidth does not grow with it
+  EXPECT_EQ(bandwidths[0], bandwidths[1]);
+  EXPECT_LT(bandwidths[1], 4 * (n_dof + 1));
+}
+
+TEST(SolverInterface, BandedInfeasibility)  // NOLINT
+{
+  // Contradicting inequalities are reported as infeasible, by a certificate from the diverging multipliers
+  Model::Ptr model = createModel(ModelType::BANDED);
+  Var x = model->addVar("x", -10, 10);
+  model->addIneqCnt(AffExpr(x), "");
+  model->addIneqCnt(exprSub(AffExpr(1), AffExpr(x)), "");
+  model->setObjective(exprSquare(x));
+  model->update();
+  EXPECT_EQ(model->optimize(), CVX_INFEASIBLE);
+
+  // A feasible QP that is not solved within the iterations has failed, it is not infeasible
+  auto slow = std::make_shared<BandedQPModel>();
+  Var v = slow->Model::addVar("v", -10, 10);
+  slow->addIneqCnt(exprSub(AffExpr(1), AffExpr(v)), "");
+  slow->setObjective(exprSquare(v));
+  slow->update();
+  slow->settings.max_iterations = 1;
+  EXPECT_EQ(slow->optimize(), CVX_FAILED);
+  slow->settings.max_iterations = 100;
+  ASSERT_EQ(slow->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(slow->getVarValue(v), 1, 1e-4);
+}
+
+TEST_P(SolverInterface, Presolve)  // NOLINT
+{
+  const int n_steps = 10;
+  const int n_dof = 2;
+  QuadExpr objective;
+  Model::Ptr model = trajectoryModel(createPresolveModel(GetParam()), n_steps, n_dof, objective);
+  const auto& presolve = static_cast<const PresolveModel&>(*model);
+  QuadExpr reference_objective;
+  Model::Ptr reference = trajectoryModel(GetParam(), n_steps, n_dof, reference_objective);
+  ASSERT_EQ(reference->optimize(), CVX_SOLVED);
+  const double reference_value = reference_objective.value(reference->getVarValues(reference->getVars()));
+
+  // The start is fixed by its bounds and the goal by equalities, which are dropped
+  ASSERT_EQ(model->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(objective.value(model->getVarValues(model->getVars())), reference_value, 1e-4);
+  EXPECT_EQ(presolve.lastPresolve().num_fixed_vars, 2 * n_dof);
+  EXPECT_EQ(presolve.lastPresolve().num_dropped_cnts, n_dof);
+  EXPECT_EQ(presolve.innerModel().getVars().size(), model->getVars().size() - 2 * n_dof);
+  const VarVector vars = model->getVars();
+  for (int j = 0; j < n_dof; ++j)
+  {
+    EXPECT_EQ(model->getVarValue(vars[static_cast<std::size_t>(j)]), 0);
+    EXPECT_NEAR(model->getVarValue(vars[static_cast<std::size_t>((n_steps - 1) * n_dof + j)]), 1, 1e-9);
+  }
+
+  // Solving again from the previous solution, and on a copy, gives the same optimum
+  model->setWarmStart(model->getVarValues(vars), model->getDualValues());
+  ASSERT_EQ(model->optimize(), CVX_SOLVED);
+  EXPECT_TRUE(presolve.lastPresolve().reused);
+  EXPECT_NEAR(objective.value(model->getVarValues(vars)), reference_value, 1e-4);
+  Model::Ptr copy = model->clone();
+  ASSERT_TRUE(copy != nullptr);
+  ASSERT_EQ(copy->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(model->getVarValue(vars[n_dof]), copy->getVarValue(copy->getVars()[n_dof]), 1e-4);
+
+  // Shrinking the bounds of a free variable only updates the bounds of the backend
+  const Var& middle = vars[static_cast<std::size_t>(n_steps / 2 * n_dof)];
+  model->setVarBounds(middle, -0.1, 0.1);
+  ASSERT_EQ(model->optimize(), CVX_SOLVED);
+  EXPECT_TRUE(presolve.lastPresolve().reused);
+  EXPECT_EQ(presolve.lastPresolve().num_fixed_vars, 2 * n_dof);
+  EXPECT_LE(model->getVarValue(middle), 0.1 + 1e-6);
+  model->setVarBounds(middle, -10, 10);
+
+  // Unfixing the start hands its variables back to the backend
+  model->setVarBounds({ vars[0], vars[1] }, { -0.5, -0.5 }, { 0.5, 0.5 });
+  ASSERT_EQ(model->optimize(), CVX_SOLVED);
+  EXPECT_FALSE(presolve.lastPresolve().reused);
+  EXPECT_EQ(presolve.lastPresolve().num_fixed_vars, n_dof);
+  EXPECT_EQ(presolve.innerModel().getVars().size(), model->getVars().size() - n_dof);
+
+  // A second equality on a goal variable contradicts the first one once both are substituted
+  const Var& goal = vars[static_cast<std::size_t>(n_steps * n_dof - 1)];
+  Cnt contradiction = model->addEqCnt(exprAdd(AffExpr(goal), -0.5), "");
+  model->update();
+  EXPECT_EQ(model->optimize(), CVX_INFEASIBLE);
+  model->removeCnt(contradiction);
+  model->update();
+  EXPECT_EQ(model->optimize(), CVX_SOLVED);
+}
+
+TEST_P(SolverInterface, Equilibration)  // NOLINT
+{
+  // min 1e4 (x0 - 1)^2 + 1e-2 (x1 - 2)^2  s.t.  1e3 (x0 + x1 - 2) <= 0,  1e-3 (x0 - x1) <= 0
+  auto build = [](Model& model) {
+    VarVector x;
+    for (int i = 0; i < 2; ++i)
+      x.push_back(model.addVar("x", -10, 10));
+    model.update();
+    QuadExpr obj = exprMult(exprSquare(exprAdd(AffExpr(x[0]), -1)), 1e4);
+    exprInc(obj, exprMult(exprSquare(exprAdd(AffExpr(x[1]), -2)), 1e-2));
+    model.setObjective(obj);
+    AffExpr sum(x[0]);
+    exprInc(sum, x[1]);
+    sum.constant = -2;
+    model.addIneqCnt(exprMult(sum, 1e3), "");
+    model.addIneqCnt(exprMult(exprSub(AffExpr(x[0]), AffExpr(x[1])), 1e-3), "");
+    model.update();
+  };
+  Model::Ptr reference = createModel(GetParam());
+  build(*reference);
+  ASSERT_EQ(reference->optimize(), CVX_SOLVED);
+  Model::Ptr model = createPresolveModel(GetParam());
+  build(*model);
+  ASSERT_EQ(model->optimize(), CVX_SOLVED);
+
+  // The solution is in the original units
+  const DblVec x = model->getVarValues(model->getVars());
+  const DblVec reference_x = reference->getVarValues(reference->getVars());
+  EXPECT_NEAR(x[0], reference_x[0], 1e-3);
+  EXPECT_NEAR(x[1], reference_x[1], 1e-3);
+  EXPECT_NEAR(x[0] + x[1], 2, 1e-3);
+
+  // So are the multipliers, which are laid out like the ones of the backend as the problem has no fixed variables
+  const DblVec dual = model->getDualValues();
+  const DblVec reference_dual = reference->getDualValues();
+  ASSERT_EQ(dual.size(), reference_dual.size());
+  for (std::size_t i = 0; i < dual.size(); ++i)
+    EXPECT_NEAR(dual[i], reference_dual[i], 1e-3 * (1 + std::abs(reference_dual[i])));
+
+  // And they are scaled again for a warm start
+  model->setWarmStart(x, dual);
+  ASSERT_EQ(model->optimize(), CVX_SOLVED);
+  const DblVec warm_x = model->getVarValues(model->getVars());
+  EXPECT_NEAR(warm_x[0], x[0], 1e-3);
+  EXPECT_NEAR(warm_x[1], x[1], 1e-3);
+
+  const auto& presolve = static_cast<const PresolveModel&>(*model);
+  EXPECT_LT(presolve.lastPresolve().cost_scale, 1);
+  EXPECT_LT(presolve.lastPresolve().min_col_scale, presolve.lastPresolve().max_col_scale);
+  QPData qp;
+  if (!presolve.innerModel().exportQP(qp))
+    return;  // not supported by this backend
+  DblVec row_norms(qp.numCnts(), 0);
+  for (std::size_t k = 0; k < qp.A_vals.size(); ++k)
+  {
+    double& norm = row_norms[static_cast<std::size_t>(qp.A_rows[k])];
+    norm = std::max(norm, std::abs(qp.A_vals[k]));
+  }
+  for (double norm : row_norms)
+  {
+    EXPECT_GT(norm, 0.5);
+    EXPECT_LT(norm, 2);
+  }
+}
+
+#ifdef HAVE_BPMPD
+/** Solves min (x0 + x1 - target)^2 on [-10, 10]^2 with BPMPD and returns x0 + x1 */
+static double solveBPMPD(double target)
+{
+  Model::Ptr solver = createModel(ModelType::BPMPD);
+  VarVector vars;
+  for (int i = 0; i < 2; ++i)
+    vars.push_back(solver->addVar("v" + std::to_string(i), -10, 10));
+  solver->update();
+
+  AffExpr aff(vars[0]);
+  exprInc(aff, vars[1]);
+  aff.constant = -target;
+  solver->setObjective(exprSquare(aff));
+  if (solver->optimize() != CVX_SOLVED)
+    return std::numeric_limits<double>::quiet_NaN();
+  DblVec x = solver->getVarValues(vars);
+  return x[0] + x[1];
+}
+
+TEST(SolverInterface, BPMPDWorkerRestart)  // NOLINT
+{
+  EXPECT_NEAR(solveBPMPD(3), 3, 1e-4);
+  const std::vector<int> workers = idleBPMPDWorkers();
+  ASSERT_FALSE(workers.empty());
+  for (int pid : workers)
+    kill(pid, SIGKILL);
+
+  // The dead workers are replaced, whether that is noticed at checkout or during the solve
+  EXPECT_NEAR(solveBPMPD(4), 4, 1e-4);
+  for (int pid : idleBPMPDWorkers())
+    EXPECT_TRUE(std::find(workers.begin(), workers.end(), pid) == workers.end());
+}
+
+TEST(SolverInterface, BPMPDConcurrentSolves)  // NOLINT
+{
+  const int n_threads = 4;
+  const int n_solves = 10;
+  std::vector<int> n_correct(n_threads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_threads; ++t)
+  {
+    threads.emplace_back([t, &n_correct]() {
+      for (int i = 0; i < n_solves; ++i)
+      {
+        const double target = t + 0.1 * i;
+        if (std::abs(solveBPMPD(target) - target) < 1e-4)
+          ++n_correct[static_cast<std::size_t>(t)];
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+  for (int t = 0; t < n_threads; ++t)
+    EXPECT_EQ(n_correct[static_cast<std::size_t>(t)], n_solves);
+  EXPECT_LE(idleBPMPDWorkers().size(), static_cast<std::size_t>(n_threads));
+}
+#endif
+
+TEST_P(SolverInterface, Reoptimize)  // NOLINT
+{
+  // Every kind of change between solves must be picked up by backends that update their workspace in place
+  Model::Ptr solver = createModel(GetParam());
+  Var x = solver->addVar("x", -10, 10);
+  Var y = solver->addVar("y", -10, 10);
+  solver->update();
+
+  QuadExpr objective = exprSquare(AffExpr(x));
+  exprInc(objective, exprSquare(AffExpr(y)));
+  solver->setObjective(objective);
+  AffExpr x_ge(x);
+  x_ge.coeffs[0] = -1;
+  x_ge.constant = 1;  // x >= 1
+  Cnt cnt = solver->addIneqCnt(x_ge, "");
+  solver->update();
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(solver->getVarValue(x), 1, 1e-3);
+  EXPECT_NEAR(solver->getVarValue(y), 0, 1e-3);
+
+  // Bounds only
+  solver->setVarBounds(y, 2, 10);
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(solver->getVarValue(y), 2, 1e-3);
+
+  // Linear part of the objective only
+  QuadExpr shifted = objective;
+  exprInc(shifted.affexpr, exprMult(AffExpr(y), -8.0));  // minimum at y = 4
+  solver->setObjective(shifted);
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(solver->getVarValue(y), 4, 1e-3);
+
+  // Constraint replaced by one with the same pattern but different values
+  solver->removeCnt(cnt);
+  x_ge.constant = 3;  // x >= 3
+  solver->addIneqCnt(x_ge, "");
+  solver->update();
+  ASSERT_EQ(solver->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(solver->getVarValue(x), 3, 1e-3);
+  EXPECT_NEAR(solver->getVarValue(y), 4, 1e-3);
+}
+
 // Tests multiplying larger terms
 TEST_P(SolverInterface, DISABLED_ExprMult_test1)  // NOLINT // QuadExpr not PSD
 {
@@ -236,7 +1010,7 @@ TEST_P(SolverInterface, ExprMult_test3)  // NOLINT
   EXPECT_NEAR(aff12.value(soln), answer, 1e-6);
 }
 
-auto getAvailableSolvers = []() {
+static auto getAvailableSolvers = []() {
   std::vector<ModelType> solvers = availableSolvers();
   auto it = std::find(solvers.begin(), solvers.end(), ModelType::OSQP);
   if (it != solvers.end())
@@ -3,6 +3,7 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <cstdio>
 #include <gtest/gtest.h>
 #include <Eigen/Core>
+#include <Eigen/Dense>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -261,3 +262,42 @@ TEST(solver_utils, eigenToCSC_upper_triangular)  // NOLINT
                                                 << "CRC form:\n"
                                                 << CSTR(cols_p);
 }
+
+TEST(solver_utils, ruizEquilibration)  // NOLINT
+{
+  // Costs and constraint rows that differ by orders of magnitude, as collision rows and joint velocity costs do
+  Eigen::SparseMatrix<double> P(3, 3), A(3, 3);
+  P.insert(0, 0) = 1e4;
+  P.insert(1, 1) = 1e-2;
+  P.insert(1, 2) = 1;
+  P.insert(2, 1) = 1;
+  P.insert(2, 2) = 1e2;
+  A.insert(0, 0) = 1e3;
+  A.insert(0, 1) = 1e3;
+  A.insert(1, 1) = 1e-3;
+  A.insert(1, 2) = -1e-3;
+  A.insert(2, 2) = 5;
+  Eigen::VectorXd q(3);
+  q << 1, -1e3, 0;
+
+  Eigen::VectorXd col_scale, row_scale;
+  double cost_scale = 0;
+  ruizEquilibration(P, q, A, 10, col_scale, row_scale, cost_scale);
+  ASSERT_EQ(col_scale.size(), 3);
+  ASSERT_EQ(row_scale.size(), 3);
+  EXPECT_GT(cost_scale, 0);
+
+  Eigen::MatrixXd scaled_A = row_scale.asDiagonal() * Eigen::MatrixXd(A) * col_scale.asDiagonal();
+  Eigen::MatrixXd scaled_P = cost_scale * col_scale.asDiagonal() * Eigen::MatrixXd(P) * col_scale.asDiagonal();
+  Eigen::VectorXd row_norms = scaled_A.cwiseAbs().rowwise().maxCoeff();
+  Eigen::VectorXd col_norms = scaled_A.cwiseAbs().colwise().maxCoeff().transpose();
+  col_norms = col_norms.cwiseMax(scaled_P.cwiseAbs().colwise().maxCoeff().transpose());
+  for (Eigen::Index i = 0; i < 3; ++i)
+  {
+    EXPECT_GT(row_norms[i], 0.5);
+    EXPECT_LT(row_norms[i], 2);
+    EXPECT_GT(col_norms[i], 0.5);
+    EXPECT_LT(col_norms[i], 2);
+  }
+  EXPECT_LE(scaled_P.cwiseAbs().colwise().maxCoeff().mean(), 1 + 1e-9);
+}
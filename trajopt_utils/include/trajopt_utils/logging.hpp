@@ -1,6 +1,7 @@
 #pragma once
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <atomic>
 #include <cstdio>
 TRAJOPT_IGNORE_WARNINGS_POP
 
@@ -16,8 +17,35 @@ enum LogLevel
   LevelTrace = 5
 };
 
-extern LogLevel gLogLevel;
-inline LogLevel GetLogLevel() { return gLogLevel; }
+/** @brief Log level of all threads that have not set their own with a ScopedLogLevel */
+extern std::atomic<LogLevel> gLogLevel;
+/** @brief Log level of the calling thread, or -1 if it uses gLogLevel */
+extern thread_local int gThreadLogLevel;
+inline LogLevel GetLogLevel()
+{
+  return gThreadLogLevel >= 0 ? static_cast<LogLevel>(gThreadLogLevel) : gLogLevel.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sets the log level of the calling thread for the lifetime of the object
+ *
+ * Changes of gLogLevel do not affect the thread in the meantime, and the thread does not affect others, so
+ * independent optimizations running on different threads can log at their own level.
+ */
+class ScopedLogLevel
+{
+public:
+  explicit ScopedLogLevel(LogLevel level) : previous_(gThreadLogLevel) { gThreadLogLevel = level; }
+  ~ScopedLogLevel() { gThreadLogLevel = previous_; }
+  ScopedLogLevel(const ScopedLogLevel&) = delete;
+  ScopedLogLevel& operator=(const ScopedLogLevel&) = delete;
+  ScopedLogLevel(ScopedLogLevel&&) = delete;
+  ScopedLogLevel& operator=(ScopedLogLevel&&) = delete;
+
+private:
+  int previous_;
+};
+
 #define FATAL_PREFIX "\x1b[31m[FATAL] "
 #define ERROR_PREFIX "\x1b[31m[ERROR] "
 #define WARN_PREFIX "\x1b[33m[WARN] "
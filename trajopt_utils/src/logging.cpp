@@ -9,7 +9,8 @@ TRAJOPT_IGNORE_WARNINGS_POP
 
 namespace util
 {
-LogLevel gLogLevel;
+std::atomic<LogLevel> gLogLevel{ LevelError };
+thread_local int gThreadLogLevel = -1;
 
 int LoggingInit()
 {